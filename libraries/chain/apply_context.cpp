@@ -37,11 +37,12 @@ apply_context::apply_context(controller& con, transaction_context& trx_ctx, uint
 ,recurse_depth(depth)
 ,first_receiver_action_ordinal(action_ordinal)
 ,action_ordinal(action_ordinal)
-,idx64(*this)
-,idx128(*this)
-,idx256(*this)
-,idx_double(*this)
-,idx_long_double(*this)
+,idx64(*this, trx_ctx.itr_cache_arena)
+,idx128(*this, trx_ctx.itr_cache_arena)
+,idx256(*this, trx_ctx.itr_cache_arena)
+,idx_double(*this, trx_ctx.itr_cache_arena)
+,idx_long_double(*this, trx_ctx.itr_cache_arena)
+,keyval_cache(trx_ctx.itr_cache_arena)
 {
    action_trace& trace = trx_ctx.get_action_trace(action_ordinal);
    act = &trace.act;
@@ -59,11 +60,16 @@ void apply_context::exec_one()
 
    const auto& cfg = control.get_global_properties().configuration;
    const account_metadata_object* receiver_account = nullptr;
+   record_action_reads();
    try {
       try {
          receiver_account = &db.get<account_metadata_object,by_name>( receiver );
          privileged = receiver_account->is_privileged();
          auto native = control.find_apply_handler( receiver, act->account, act->name );
+         // native handlers and privileged contracts modify state that is not tracked per table or account
+         if( native || privileged ) {
+            record_global_write();
+         }
          if( native ) {
             if( trx_context.enforce_whiteblacklist && control.is_producing_block() ) {
                control.check_contract_list( receiver );
@@ -126,6 +132,7 @@ void apply_context::exec_one()
 
    r.global_sequence  = next_global_sequence();
    r.recv_sequence    = next_recv_sequence( *receiver_account );
+   record_account_write( receiver );
 
    const account_metadata_object* first_receiver_account = nullptr;
    if( act->account == receiver ) {
@@ -139,6 +146,7 @@ void apply_context::exec_one()
 
    for( const auto& auth : act->authorization ) {
       r.auth_sequence[auth.actor] = next_auth_sequence( auth.actor );
+      record_account_write( auth.actor );
    }
 
    action_trace& trace = trx_context.get_action_trace( action_ordinal );
@@ -189,6 +197,9 @@ void apply_context::exec()
 } /// exec()
 
 bool apply_context::is_account( const account_name& account )const {
+   if( trx_context.access_set ) {
+      trx_context.access_set->read_account( account );
+   }
    return nullptr != db.find<account_object,by_name>( account );
 }
 
@@ -347,6 +358,7 @@ void apply_context::execute_context_free_inline( action&& a ) {
 
 void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, account_name payer, transaction&& trx, bool replace_existing ) {
    EOS_ASSERT( trx.context_free_actions.size() == 0, cfa_inside_generated_tx, "context free actions are not currently allowed in generated transactions" );
+   record_global_write();
 
    bool enforce_actor_whitelist_blacklist = trx_context.enforce_whiteblacklist && control.is_producing_block()
                                              && !control.sender_avoids_whitelist_blacklist_enforcement( receiver );
@@ -524,6 +536,7 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
 }
 
 bool apply_context::cancel_deferred_transaction( const uint128_t& sender_id, account_name sender ) {
+   record_global_write();
    auto& generated_transaction_idx = db.get_mutable_index<generated_transaction_multi_index>();
    const auto* gto = db.find<generated_transaction_object,by_sender_id>(boost::make_tuple(sender, sender_id));
    if ( gto ) {
@@ -554,10 +567,16 @@ uint32_t apply_context::schedule_action( action&& act_to_schedule, account_name
 }
 
 const table_id_object* apply_context::find_table( name code, name scope, name table ) {
+   if( trx_context.access_set ) {
+      trx_context.access_set->read_table( code, scope, table );
+   }
    return db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
 }
 
 const table_id_object& apply_context::find_or_create_table( name code, name scope, name table, const account_name &payer ) {
+   if( trx_context.access_set ) {
+      trx_context.access_set->write_table( code, scope, table );
+   }
    const auto* existing_tid =  db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
    if (existing_tid != nullptr) {
       return *existing_tid;
@@ -578,6 +597,49 @@ void apply_context::remove_table( const table_id_object& tid ) {
    db.remove(tid);
 }
 
+void apply_context::record_action_reads() {
+   if( trx_context.access_set ) {
+      // the action was validated against its code account and the permissions it carries
+      trx_context.access_set->read_account( act->account );
+      for( const auto& auth : act->authorization ) {
+         trx_context.access_set->read_permission( auth );
+      }
+   }
+}
+
+void apply_context::record_table_write( const table_id_object& tid ) {
+   if( trx_context.access_set ) {
+      trx_context.access_set->write_table( tid.code, tid.scope, tid.table );
+   }
+}
+
+void apply_context::record_table_delta( const table_id_object& tid, const key_value_object& obj, bool removed ) {
+   if( recorded_table_deltas ) {
+      table_delta d;
+      d.code        = tid.code;
+      d.scope       = tid.scope;
+      d.table       = tid.table;
+      d.primary_key = obj.primary_key;
+      d.payer       = obj.payer;
+      d.removed     = removed;
+      if( !removed )
+         d.value.assign( obj.value.data(), obj.value.data() + obj.value.size() );
+      recorded_table_deltas->emplace_back( std::move(d) );
+   }
+}
+
+void apply_context::record_account_write( account_name account ) {
+   if( trx_context.access_set ) {
+      trx_context.access_set->write_account( account );
+   }
+}
+
+void apply_context::record_global_write() {
+   if( trx_context.access_set ) {
+      trx_context.access_set->global_write = true;
+   }
+}
+
 vector<account_name> apply_context::get_active_producers() const {
    const auto& ap = control.active_producers();
    vector<account_name> accounts; accounts.reserve( ap.producers.size() );
@@ -673,6 +735,8 @@ int apply_context::db_store_i64( uint64_t code, uint64_t scope, uint64_t table,
    int64_t billable_size = (int64_t)(buffer_size + config::billable_size_v<key_value_object>);
    update_db_usage( payer, billable_size);
 
+   record_table_delta( tab, obj, false );
+
    keyval_cache.cache_table( tab );
    return keyval_cache.add( obj );
 }
@@ -683,7 +747,7 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
    const auto& table_obj = keyval_cache.get_table( obj.t_id );
    EOS_ASSERT( table_obj.code == receiver, table_access_violation, "db access violation" );
 
-//   require_write_lock( table_obj.scope );
+   record_table_write( table_obj );
 
    const int64_t overhead = config::billable_size_v<key_value_object>;
    int64_t old_size = (int64_t)(obj.value.size() + overhead);
@@ -705,6 +769,8 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
      o.value.assign( buffer, buffer_size );
      o.payer = payer;
    });
+
+   record_table_delta( table_obj, obj, false );
 }
 
 void apply_context::db_remove_i64( int iterator ) {
@@ -713,10 +779,12 @@ void apply_context::db_remove_i64( int iterator ) {
    const auto& table_obj = keyval_cache.get_table( obj.t_id );
    EOS_ASSERT( table_obj.code == receiver, table_access_violation, "db access violation" );
 
-//   require_write_lock( table_obj.scope );
+   record_table_write( table_obj );
 
    update_db_usage( obj.payer,  -(obj.value.size() + config::billable_size_v<key_value_object>) );
 
+   record_table_delta( table_obj, obj, true );
+
    db.modify( table_obj, [&]( auto& t ) {
       --t.count;
    });
@@ -741,6 +809,43 @@ int apply_context::db_get_i64( int iterator, char* buffer, size_t buffer_size )
    return copy_size;
 }
 
+/**
+ * Copies up to max_rows rows of the table of iterator, starting with its row, into buffer. Each row is written as its
+ * primary key (8 bytes), the size of its value (4 bytes) and the value. Stops at the end of the table, or before the
+ * first row that does not fit the rest of the buffer. Returns the number of rows copied and sets next to the iterator
+ * of the row following them, or to the end iterator of the table.
+ */
+int apply_context::db_get_rows_i64( int iterator, char* buffer, size_t buffer_size, uint32_t max_rows, int& next ) {
+   if( iterator < -1 ) { // nothing to read past the end of a table
+      next = iterator;
+      return 0;
+   }
+
+   const auto& first = keyval_cache.get( iterator ); // Check for iterator != -1 happens in this call
+   const auto& idx = db.get_index<key_value_index, by_scope_primary>();
+   constexpr size_t row_header_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+   auto itr = idx.iterator_to( first );
+   uint32_t rows = 0;
+   size_t pos = 0;
+   for( ; rows < max_rows && itr != idx.end() && itr->t_id == first.t_id; ++itr, ++rows ) {
+      const uint32_t value_size = itr->value.size();
+      if( row_header_size + value_size > buffer_size - pos ) break;
+
+      trx_context.checktime();
+      memcpy( buffer + pos, &itr->primary_key, sizeof(uint64_t) );
+      memcpy( buffer + pos + sizeof(uint64_t), &value_size, sizeof(uint32_t) );
+      memcpy( buffer + pos + row_header_size, itr->value.data(), value_size );
+      pos += row_header_size + value_size;
+   }
+
+   if( itr == idx.end() || itr->t_id != first.t_id )
+      next = keyval_cache.get_end_iterator_by_table_id( first.t_id );
+   else
+      next = keyval_cache.add( *itr );
+   return rows;
+}
+
 int apply_context::db_next_i64( int iterator, uint64_t& primary ) {
    if( iterator < -1 ) return -1; // cannot increment past end iterator of table
 
@@ -874,6 +979,53 @@ void apply_context::add_ram_usage( account_name account, int64_t ram_delta ) {
    }
 }
 
+apply_context::checkpoint apply_context::make_checkpoint()const {
+   checkpoint cp;
+   keyval_cache.get_ids( cp.iterator_caches[0] );
+   idx64.cache().get_ids( cp.iterator_caches[1] );
+   idx128.cache().get_ids( cp.iterator_caches[2] );
+   idx256.cache().get_ids( cp.iterator_caches[3] );
+   idx_double.cache().get_ids( cp.iterator_caches[4] );
+   idx_long_double.cache().get_ids( cp.iterator_caches[5] );
+   cp.notified           = _notified.size();
+   cp.account_ram_deltas = _account_ram_deltas;
+   cp.validate_ram_usage = trx_context.validate_ram_usage;
+   cp.access_set         = trx_context.access_set;
+   return cp;
+}
+
+void apply_context::restore_checkpoint( checkpoint&& cp ) {
+   keyval_cache.rebind( db, cp.iterator_caches[0] );
+   idx64.cache().rebind( db, cp.iterator_caches[1] );
+   idx128.cache().rebind( db, cp.iterator_caches[2] );
+   idx256.cache().rebind( db, cp.iterator_caches[3] );
+   idx_double.cache().rebind( db, cp.iterator_caches[4] );
+   idx_long_double.cache().rebind( db, cp.iterator_caches[5] );
+   EOS_ASSERT( _notified.size() == cp.notified, transaction_exception, "notifications cannot be undone" );
+   _account_ram_deltas             = std::move( cp.account_ram_deltas );
+   trx_context.validate_ram_usage  = std::move( cp.validate_ram_usage );
+   trx_context.access_set          = std::move( cp.access_set );
+}
+
+apply_context::isolated_iterator_caches::isolated_iterator_caches( apply_context& context )
+:_context(context)
+{
+   swap_all();
+}
+
+apply_context::isolated_iterator_caches::~isolated_iterator_caches() {
+   swap_all();
+}
+
+void apply_context::isolated_iterator_caches::swap_all() {
+   _context.keyval_cache.swap_storage( _saved[0] );
+   _context.idx64.cache().swap_storage( _saved[1] );
+   _context.idx128.cache().swap_storage( _saved[2] );
+   _context.idx256.cache().swap_storage( _saved[3] );
+   _context.idx_double.cache().swap_storage( _saved[4] );
+   _context.idx_long_double.cache().swap_storage( _saved[5] );
+}
+
 action_name apply_context::get_sender() const {
    const action_trace& trace = trx_context.get_action_trace( action_ordinal );
    if (trace.creator_action_ordinal > 0) {
@@ -4,8 +4,32 @@
  */
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <fstream>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fc/io/raw.hpp>
+#include <fc/log/logger_config.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <cstdio>
+#include <map>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
 
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
@@ -20,22 +44,350 @@ namespace eosio { namespace chain {
     * Version 1: complete block log from genesis
     * Version 2: adds optional partial block log, cannot be used for replay without snapshot
     *            this is in the form of an first_block_num that is written immediately after the version
+    * Version 3: adds a flags word immediately after first_block_num. With the compressed_blocks flag set every
+    *            block is stored as an independent zlib frame (a packed vector<char> holding the compressed
+    *            packed signed_block), so the index and trailers still give O(1) access to any block.
+    *            Logs without flags are still written as version 2.
     */
-   const uint32_t block_log::max_supported_version = 2;
+   const uint32_t block_log::max_supported_version = 3;
+
+   namespace {
+      const uint32_t compressed_blocks_flag = 1;
+   }
 
    namespace detail {
+      namespace bip = boost::interprocess;
+      namespace bio = boost::iostreams;
+
+      static bytes zlib_compress_block( const bytes& packed_block ) {
+         bytes out;
+         bio::filtering_ostream comp;
+         comp.push( bio::zlib_compressor( bio::zlib::default_compression ) );
+         comp.push( bio::back_inserter( out ) );
+         bio::write( comp, packed_block.data(), packed_block.size() );
+         bio::close( comp );
+         return out;
+      }
+
+      static bytes zlib_decompress_block( const char* data, size_t size ) {
+         try {
+            bytes out;
+            bio::filtering_ostream decomp;
+            decomp.push( bio::zlib_decompressor() );
+            decomp.push( bio::back_inserter( out ) );
+            bio::write( decomp, data, size );
+            bio::close( decomp );
+            return out;
+         } catch( fc::exception& ) {
+            throw;
+         } catch( ... ) {
+            EOS_THROW( block_log_exception, "unable to decompress block from block log" );
+         }
+      }
+
+      /// deserialize a block log entry from a stream positioned at its start, optionally keeping the compressed frame
+      template<typename Stream>
+      static void unpack_block_entry( Stream& ds, signed_block& b, bool compressed, bytes* frame_out = nullptr ) {
+         if( !compressed ) {
+            fc::raw::unpack( ds, b );
+            return;
+         }
+         bytes local_frame;
+         bytes& frame = frame_out ? *frame_out : local_frame;
+         fc::raw::unpack( ds, frame );
+         auto data = zlib_decompress_block( frame.data(), frame.size() );
+         fc::datastream<const char*> bds( data.data(), data.size() );
+         fc::raw::unpack( bds, b );
+      }
+
+      /// decode only the header of a block log entry; a compressed entry still has to be inflated
+      static block_header unpack_block_entry_header( const char* data, uint64_t size, bool compressed ) {
+         block_header h;
+         fc::datastream<const char*> ds( data, size );
+         if( !compressed ) {
+            fc::raw::unpack( ds, h );
+            return h;
+         }
+         fc::unsigned_int frame_size;
+         fc::raw::unpack( ds, frame_size );
+         EOS_ASSERT( ds.remaining() >= frame_size.value, block_log_exception, "Compressed block frame is truncated" );
+         auto block_data = zlib_decompress_block( data + ds.tellp(), frame_size.value );
+         fc::datastream<const char*> bds( block_data.data(), block_data.size() );
+         fc::raw::unpack( bds, h );
+         return h;
+      }
+
+      static bool is_compressed( uint32_t version, uint32_t flags ) {
+         return version > 2 && (flags & compressed_blocks_flag);
+      }
+
+      /**
+       * Read-only memory mapping of a block log file and its index. A view is never modified after it is created,
+       * so any number of threads may read blocks through it at the same time without seeking a shared stream.
+       * When the log grows past the mapped range a new view is created to replace it.
+       */
+      class block_log_view {
+         public:
+            block_log_view( const fc::path& block_file, const fc::path& index_file, uint32_t first_block_num )
+            :first_block_num( first_block_num ) {
+               // map the index first: an index entry is only flushed after its block, so any block referenced
+               // by the mapped index is guaranteed to be covered by the block mapping created afterwards
+               if( fc::file_size( index_file ) > 0 ) {
+                  index_mapping = bip::file_mapping( index_file.generic_string().c_str(), bip::read_only );
+                  index_region  = bip::mapped_region( index_mapping, bip::read_only );
+               }
+               if( fc::file_size( block_file ) > 0 ) {
+                  block_mapping = bip::file_mapping( block_file.generic_string().c_str(), bip::read_only );
+                  block_region  = bip::mapped_region( block_mapping, bip::read_only );
+               }
+               uint32_t version = 0, flags = 0;
+               if( block_size() >= 3 * sizeof(uint32_t) ) {
+                  memcpy( &version, block_data(), sizeof(version) );
+                  memcpy( &flags, block_data() + 2 * sizeof(uint32_t), sizeof(flags) );
+               }
+               compressed = is_compressed( version, flags );
+            }
+
+            const char* block_data()const { return static_cast<const char*>( block_region.get_address() ); }
+            uint64_t    block_size()const { return block_region.get_size(); }
+            uint64_t    index_size()const { return index_region.get_size(); }
+
+            static uint64_t index_offset( uint32_t block_num, uint32_t first_block_num ) {
+               return sizeof(uint64_t) * (block_num - first_block_num);
+            }
+
+            bool contains_block( uint32_t block_num )const {
+               return block_num >= first_block_num &&
+                      index_offset( block_num, first_block_num ) + sizeof(uint64_t) <= index_size();
+            }
+
+            /// @pre contains_block( block_num )
+            uint64_t get_block_pos( uint32_t block_num )const {
+               uint64_t pos;
+               memcpy( &pos, static_cast<const char*>( index_region.get_address() ) + index_offset( block_num, first_block_num ),
+                       sizeof(pos) );
+               return pos;
+            }
+
+            const uint32_t      first_block_num;
+            bool                compressed = false; ///< blocks are stored as zlib frames
+
+         private:
+            bip::file_mapping   block_mapping;
+            bip::mapped_region  block_region;
+            bip::file_mapping   index_mapping;
+            bip::mapped_region  index_region;
+      };
+
+      using block_log_view_ptr = std::shared_ptr<const block_log_view>;
+
+      /**
+       * A view of blocks.log together with a shared lock on the files, so that they cannot be truncated or replaced
+       * while the view is read. Do not hold one while calling into anything that modifies the log.
+       */
+      struct locked_block_log_view {
+         std::shared_lock<std::shared_mutex>   lock;
+         block_log_view_ptr                    view;
+
+         const block_log_view& operator*()const { return *view; }
+         const block_log_view* operator->()const { return view.get(); }
+      };
+
+      /// Fields stored at the start of every block log file, ahead of the first block.
+      struct block_log_header {
+         uint32_t       version = 0;
+         uint32_t       first_block_num = 0;
+         uint32_t       flags = 0;
+         genesis_state  gs;
+         uint64_t       first_block_pos = 0; ///< offset just past the header (and the totem since version 2)
+      };
+
+      static block_log_header read_log_header( const char* data, uint64_t size ) {
+         block_log_header header;
+         fc::datastream<const char*> ds( data, size );
+         fc::raw::unpack( ds, header.version );
+         EOS_ASSERT( header.version > 0, block_log_exception, "Block log was not setup properly" );
+         EOS_ASSERT( header.version >= block_log::min_supported_version && header.version <= block_log::max_supported_version,
+                     block_log_unsupported_version,
+                     "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
+                     ("version", header.version)("min", block_log::min_supported_version)("max", block_log::max_supported_version) );
+         header.first_block_num = 1;
+         if( header.version > 1 )
+            fc::raw::unpack( ds, header.first_block_num );
+         if( header.version > 2 )
+            fc::raw::unpack( ds, header.flags );
+         fc::raw::unpack( ds, header.gs );
+         if( header.version > 1 )
+            ds.skip( sizeof(uint64_t) );
+         header.first_block_pos = ds.tellp();
+         return header;
+      }
+
+      static std::pair<signed_block_ptr, uint64_t> read_block_from_view( const block_log_view& v, uint64_t pos ) {
+         EOS_ASSERT( pos < v.block_size(), block_log_exception,
+                     "Block position ${pos} is beyond the end of the block log", ("pos", pos)("size", v.block_size()) );
+         fc::datastream<const char*> ds( v.block_data() + pos, v.block_size() - pos );
+         std::pair<signed_block_ptr,uint64_t> result;
+         result.first = std::make_shared<signed_block>();
+         unpack_block_entry( ds, *result.first, v.compressed );
+         result.second = pos + ds.tellp() + sizeof(uint64_t);
+         return result;
+      }
+
+      /**
+       * Build index_file for block_file by walking the back-pointer chain from the head block: the 8 bytes preceding
+       * block N hold the position of block N-1. Only trailers are read, block bodies are never deserialized. The
+       * result is then verified in parallel by decoding just the header of every indexed block.
+       */
+      static void construct_index( const fc::path& block_file, const fc::path& index_file ) {
+         ilog( "Reconstructing Block Log Index for ${f}...", ("f", block_file.generic_string()) );
+         fc::remove_all( index_file );
+         std::ofstream( index_file.generic_string().c_str(), LOG_WRITE );
+
+         const auto start = fc::time_point::now();
+
+         bip::file_mapping log_mapping( block_file.generic_string().c_str(), bip::read_only );
+         bip::mapped_region log_region( log_mapping, bip::read_only );
+         const char* const log_data = static_cast<const char*>( log_region.get_address() );
+         const uint64_t log_size = log_region.get_size();
+
+         const auto header = read_log_header( log_data, log_size );
+
+         uint64_t end_pos = block_log::npos;
+         if( log_size >= header.first_block_pos + sizeof(end_pos) )
+            memcpy( &end_pos, log_data + log_size - sizeof(end_pos), sizeof(end_pos) );
+         if( end_pos == block_log::npos ) {
+            ilog( "Block log contains no blocks. No need to construct index." );
+            return;
+         }
+
+         // the number of the head block tells how many entries the index needs; only its header is decoded
+         EOS_ASSERT( end_pos >= header.first_block_pos && end_pos < log_size, block_log_exception,
+                     "Block log trailer points outside of the block log", ("pos", end_pos)("size", log_size) );
+         const bool compressed = is_compressed( header.version, header.flags );
+         const uint32_t head_num = unpack_block_entry_header( log_data + end_pos, log_size - end_pos, compressed ).block_num();
+         const uint32_t first_block_num = header.first_block_num;
+         EOS_ASSERT( head_num >= first_block_num, block_log_exception,
+                     "Head block ${n} of block log precedes its first block ${f}", ("n", head_num)("f", first_block_num) );
+         const uint64_t num_blocks = head_num - first_block_num + 1;
+
+         boost::filesystem::resize_file( index_file.generic_string(), num_blocks * sizeof(uint64_t) );
+         bip::file_mapping index_mapping( index_file.generic_string().c_str(), bip::read_write );
+         bip::mapped_region index_region( index_mapping, bip::read_write );
+         uint64_t* const index_data = static_cast<uint64_t*>( index_region.get_address() );
+
+         uint64_t pos = end_pos;
+         for( uint64_t i = num_blocks; i > 0; --i ) {
+            index_data[i - 1] = pos;
+            if( i == 1 ) break;
+            EOS_ASSERT( pos >= header.first_block_pos + sizeof(uint64_t), block_log_exception,
+                        "Block log trailer chain ended early at block ${n}", ("n", first_block_num + i - 1) );
+            uint64_t prev_pos;
+            memcpy( &prev_pos, log_data + pos - sizeof(uint64_t), sizeof(prev_pos) );
+            EOS_ASSERT( prev_pos < pos, block_log_exception,
+                        "Block log trailer chain is not monotonic at block ${n}", ("n", first_block_num + i - 1) );
+            pos = prev_pos;
+         }
+         EOS_ASSERT( pos == header.first_block_pos, block_log_exception,
+                     "Block log trailer chain does not lead back to the first block",
+                     ("found", pos)("expected", header.first_block_pos) );
+
+         // The trailer walk is a dependent pointer chase and cannot be split, but verifying it can.
+         const size_t num_threads = std::max<size_t>( 1, std::min<size_t>( std::thread::hardware_concurrency(), 16 ) );
+         const uint64_t chunk_size = (num_blocks + num_threads - 1) / num_threads;
+         {
+            named_thread_pool verify_pool( "blklog", num_threads );
+            vector<std::future<void>> verified;
+            for( uint64_t chunk_start = 0; chunk_start < num_blocks; chunk_start += chunk_size ) {
+               const uint64_t chunk_end = std::min( chunk_start + chunk_size, num_blocks );
+               verified.emplace_back( async_thread_pool( verify_pool.get_executor(),
+                     [log_data, log_size, index_data, chunk_start, chunk_end, first_block_num, compressed]() {
+                  for( uint64_t i = chunk_start; i < chunk_end; ++i ) {
+                     const uint64_t p = index_data[i];
+                     const block_header h = unpack_block_entry_header( log_data + p, log_size - p, compressed );
+                     EOS_ASSERT( h.block_num() == first_block_num + i, block_log_exception,
+                                 "Block log entry at position ${pos} holds block ${actual} but ${expected} was expected",
+                                 ("pos", p)("actual", h.block_num())("expected", first_block_num + i) );
+                  }
+               } ) );
+            }
+            for( auto& f : verified ) f.get();
+         }
+
+         index_region.flush();
+
+         const auto elapsed = std::max<int64_t>( (fc::time_point::now() - start).count(), 1 );
+         ilog( "Block log index reconstructed for ${n} blocks (${mb} MiB) in ${ms} ms: ${bps} blocks/s, ${mbps} MiB/s using ${t} threads",
+               ("n", num_blocks)("mb", end_pos / (1024*1024))("ms", elapsed / 1000)
+               ("bps", num_blocks * 1000000 / elapsed)("mbps", end_pos * 1000000 / elapsed / (1024*1024))("t", num_threads) );
+      }
+
+      /// A closed blocks-<first>-<last>.log file and its index. Segments are immutable once created.
+      class block_log_segment {
+         public:
+            block_log_segment( uint32_t first_block_num, uint32_t last_block_num, const fc::path& dir )
+            :first_block_num( first_block_num )
+            ,last_block_num( last_block_num )
+            ,block_file( dir / segment_name( first_block_num, last_block_num, ".log" ) )
+            ,index_file( dir / segment_name( first_block_num, last_block_num, ".index" ) )
+            {}
+
+            static std::string segment_name( uint32_t first, uint32_t last, const char* ext ) {
+               return "blocks-" + std::to_string( first ) + "-" + std::to_string( last ) + ext;
+            }
+
+            /// parse a segment file name, returns false if name is not exactly blocks-<first>-<last>.log
+            static bool parse_name( const std::string& name, uint32_t& first, uint32_t& last ) {
+               return sscanf( name.c_str(), "blocks-%u-%u.log", &first, &last ) == 2 &&
+                      name == segment_name( first, last, ".log" ) && first <= last;
+            }
+
+            block_log_view_ptr get_view()const {
+               std::lock_guard<std::mutex> g( mtx );
+               if( !view )
+                  view = std::make_shared<const block_log_view>( block_file, index_file, first_block_num );
+               return view;
+            }
+
+            const uint32_t   first_block_num;
+            const uint32_t   last_block_num;
+            const fc::path   block_file;
+            const fc::path   index_file;
+
+         private:
+            mutable std::mutex          mtx;
+            mutable block_log_view_ptr  view;
+      };
+
+      using block_log_segment_ptr = std::shared_ptr<const block_log_segment>;
+
+      /// a block handed to the writer thread, readable from the queue until it has been written and flushed
+      struct pending_block {
+         signed_block_ptr  block;
+         packed_block_ptr  packed;
+      };
+
       class block_log_impl {
          public:
+            /// when the writer falls this far behind, append waits for it to catch up
+            static constexpr size_t  max_pending_blocks = 1024;
+
             signed_block_ptr         head;
             block_id_type            head_id;
             std::fstream             block_stream;
             std::fstream             index_stream;
+            fc::path                 data_dir;
             fc::path                 block_file;
             fc::path                 index_file;
             bool                     open_files = false;
             bool                     genesis_written_to_block_log = false;
             uint32_t                 version = 0;
-            uint32_t                 first_block_num = 0;
+            uint32_t                 first_block_num = 0; ///< first block of blocks.log, earlier blocks live in segments
+            bool                     compressed = false;  ///< blocks.log stores blocks as zlib frames
+            block_log_config         config;
+
+            /// number of the last appended block, it is either flushed or in the pending queue; readable from any thread
+            std::atomic<uint32_t>    head_block_num{0};
 
             inline void check_open_files() {
                if( !open_files ) {
@@ -50,7 +402,155 @@ namespace eosio { namespace chain {
                if( index_stream.is_open() )
                   index_stream.close();
                open_files = false;
+               invalidate_view();
+            }
+
+            void set_head( const signed_block_ptr& b ) {
+               head = b;
+               if( head ) {
+                  head_id = head->id();
+                  head_block_num.store( head->block_num(), std::memory_order_release );
+               } else {
+                  head_id = {};
+                  head_block_num.store( 0, std::memory_order_release );
+               }
+            }
+
+            /**
+             * Write a header with an invalid version of 0, finish_header marks it valid once the file is consistent.
+             * New files are compressed according to config.compress_blocks.
+             */
+            void write_header( const genesis_state& gs, uint32_t first_block ) {
+               auto data = fc::raw::pack(gs);
+               version = 0; // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
+               first_block_num = first_block;
+               compressed = config.compress_blocks;
+               block_stream.seekp(0, std::ios::end);
+               block_stream.write((char*)&version, sizeof(version));
+               block_stream.write((char*)&first_block_num, sizeof(first_block_num));
+               if( compressed ) {
+                  uint32_t flags = compressed_blocks_flag;
+                  block_stream.write((char*)&flags, sizeof(flags));
+               }
+               block_stream.write(data.data(), data.size());
+               genesis_written_to_block_log = true;
+
+               // append a totem to indicate the division between blocks and header
+               auto totem = block_log::npos;
+               block_stream.write((char*)&totem, sizeof(totem));
+            }
+
+            void finish_header() {
+               auto pos = block_stream.tellp();
+
+               static_assert( block_log::max_supported_version >= 3, "compressed block logs are written as version 3" );
+               version = compressed ? 3 : 2;
+               block_stream.seekp( 0 );
+               block_stream.write( (char*)&version, sizeof(version) );
+               block_stream.seekp( pos );
+               block_stream.flush();
+               index_stream.flush();
+               // a view mapped before the version was written does not know whether blocks are compressed
+               invalidate_view();
+            }
+
+            /**
+             * Returns a view of blocks.log that contains block_num if the block is in blocks.log, remapping the files
+             * if the current view was created before that block was written. Blocks preceding the view's
+             * first_block_num are in segments. Safe to call from any thread.
+             */
+            locked_block_log_view get_view( uint32_t block_num )const {
+               locked_block_log_view result{ std::shared_lock<std::shared_mutex>( files_mtx ), std::atomic_load( &view ) };
+               if( !result.view || (block_num >= result.view->first_block_num && !result.view->contains_block( block_num )) ) {
+                  // readers racing here each map the files; the last one to store its view keeps it current
+                  result.view = std::make_shared<const block_log_view>( block_file, index_file, first_block_num );
+                  std::atomic_store( &view, result.view );
+               }
+               return result;
+            }
+
+            /// Returns a view that covers at least file_pos in blocks.log. Safe to call from any thread.
+            locked_block_log_view get_view_for_pos( uint64_t file_pos )const {
+               locked_block_log_view result{ std::shared_lock<std::shared_mutex>( files_mtx ), std::atomic_load( &view ) };
+               if( !result.view || file_pos >= result.view->block_size() ) {
+                  result.view = std::make_shared<const block_log_view>( block_file, index_file, first_block_num );
+                  std::atomic_store( &view, result.view );
+               }
+               return result;
             }
+
+            /**
+             * Waits for the readers of blocks.log to finish and keeps new ones out while the lock is held. Must be held
+             * whenever blocks.log or blocks.index is truncated, replaced or renamed, the current mapping is dropped.
+             */
+            std::unique_lock<std::shared_mutex> lock_files() {
+               std::unique_lock<std::shared_mutex> g( files_mtx );
+               invalidate_view();
+               return g;
+            }
+
+            /// drop the current mapping so the next reader maps the files again
+            void invalidate_view() {
+               std::atomic_store( &view, block_log_view_ptr() );
+            }
+
+            block_log_segment_ptr find_segment( uint32_t block_num )const {
+               std::lock_guard<std::mutex> g( segments_mtx );
+               auto itr = segments.lower_bound( block_num );
+               if( itr == segments.end() || itr->second->first_block_num > block_num )
+                  return {};
+               return itr->second;
+            }
+
+            uint32_t first_segment_block_num()const {
+               std::lock_guard<std::mutex> g( segments_mtx );
+               return segments.empty() ? 0 : segments.begin()->second->first_block_num;
+            }
+
+            block_log_segment_ptr last_segment()const {
+               std::lock_guard<std::mutex> g( segments_mtx );
+               return segments.empty() ? block_log_segment_ptr() : segments.rbegin()->second;
+            }
+
+            /// stop reading from segments without touching their files
+            void forget_segments() {
+               std::lock_guard<std::mutex> g( segments_mtx );
+               segments.clear();
+            }
+
+            void load_segments();
+            void split_log( uint32_t last );
+            void retire_segments();
+            void remove_segments();
+
+            uint64_t write_block( const signed_block& b, const bytes& packed );
+
+            bool async_writes()const { return config.write_interval_ms > 0; }
+            bool writer_running()const { return writer_thread.joinable(); }
+            void start_writer();
+            void stop_writer();
+            void enqueue( const signed_block_ptr& b, packed_block_ptr packed );
+            void drain();
+            signed_block_ptr find_pending( uint32_t block_num )const;
+
+         private:
+            void write_pending();
+
+            std::thread                 writer_thread;
+            mutable std::mutex          pending_mtx;
+            std::condition_variable     pending_cv;   ///< wakes the writer
+            std::condition_variable     written_cv;   ///< wakes threads waiting for the queue to drain
+            std::deque<pending_block>   pending;      ///< ordered by block number, written from the front
+            bool                        writer_stop = false;
+            bool                        drain_requested = false;
+            std::exception_ptr          writer_error;
+
+            mutable std::shared_mutex   files_mtx;
+            mutable block_log_view_ptr  view;     ///< only accessed through std::atomic_load and std::atomic_store
+
+            mutable std::mutex          segments_mtx;
+            /// segments keyed by their last block number so lower_bound finds the segment containing a block
+            std::map<uint32_t, block_log_segment_ptr> segments;
       };
 
       void block_log_impl::reopen() {
@@ -68,13 +568,259 @@ namespace eosio { namespace chain {
 
          open_files = true;
       }
+
+      void block_log_impl::load_segments() {
+         using boost::filesystem::directory_iterator;
+
+         std::map<uint32_t, block_log_segment_ptr> found;
+         for( directory_iterator enditr, itr{data_dir}; itr != enditr; ++itr ) {
+            uint32_t first = 0, last = 0;
+            if( !block_log_segment::parse_name( itr->path().filename().generic_string(), first, last ) )
+               continue;
+            auto seg = std::make_shared<const block_log_segment>( first, last, data_dir );
+            if( !fc::exists( seg->index_file ) || fc::file_size( seg->index_file ) != sizeof(uint64_t) * (last - first + 1) )
+               construct_index( seg->block_file, seg->index_file );
+            found[last] = seg;
+         }
+
+         // only keep the contiguous run of segments ending with the newest one; older segments may have been retired
+         for( auto itr = found.rbegin(); itr != found.rend(); ++itr ) {
+            auto older = std::next( itr );
+            if( older != found.rend() && older->second->last_block_num + 1 != itr->second->first_block_num ) {
+               wlog( "Ignoring block log segments up to block ${n} because block ${b} is missing",
+                     ("n", older->first)("b", older->first + 1) );
+               found.erase( found.begin(), found.upper_bound( older->first ) );
+               break;
+            }
+         }
+
+         std::lock_guard<std::mutex> g( segments_mtx );
+         segments = std::move( found );
+         if( !segments.empty() ) {
+            ilog( "Found block log segments with blocks ${first} through ${last}",
+                  ("first", segments.begin()->second->first_block_num)("last", segments.rbegin()->second->last_block_num) );
+         }
+      }
+
+      /**
+       * Move the blocks written so far into blocks-<first>-<last>.log/.index and start a new blocks.log following them.
+       * The files are swapped while holding the view mutex so that no reader can map an index and a log that
+       * belong to different generations.
+       */
+      void block_log_impl::split_log( uint32_t last ) {
+         if( last < first_block_num ) return; // nothing written to blocks.log yet
+
+         block_stream.flush();
+         index_stream.flush();
+
+         auto seg = std::make_shared<const block_log_segment>( first_block_num, last, data_dir );
+         genesis_state gs;
+         {
+            bip::file_mapping log_mapping( block_file.generic_string().c_str(), bip::read_only );
+            bip::mapped_region log_region( log_mapping, bip::read_only );
+            gs = read_log_header( static_cast<const char*>( log_region.get_address() ), log_region.get_size() ).gs;
+         }
+
+         {
+            auto g = lock_files();
+            if( block_stream.is_open() ) block_stream.close();
+            if( index_stream.is_open() ) index_stream.close();
+            open_files = false;
+
+            fc::rename( index_file, seg->index_file );
+            fc::rename( block_file, seg->block_file );
+            {
+               std::lock_guard<std::mutex> sg( segments_mtx );
+               segments[last] = seg;
+            }
+
+            block_stream.open( block_file.generic_string().c_str(), LOG_WRITE );
+            index_stream.open( index_file.generic_string().c_str(), LOG_WRITE );
+            block_stream.close();
+            index_stream.close();
+            block_stream.open( block_file.generic_string().c_str(), LOG_RW );
+            index_stream.open( index_file.generic_string().c_str(), LOG_RW );
+            open_files = true;
+
+            write_header( gs, last + 1 );
+            finish_header();
+         }
+
+         ilog( "Moved blocks ${first} through ${last} of the block log into ${f}",
+               ("first", seg->first_block_num)("last", last)("f", seg->block_file.filename().generic_string()) );
+
+         retire_segments();
+      }
+
+      /// enforce config.max_retained_segments by archiving or deleting the oldest segments
+      void block_log_impl::retire_segments() {
+         if( config.max_retained_segments == 0 ) return;
+
+         vector<block_log_segment_ptr> retired;
+         {
+            std::lock_guard<std::mutex> g( segments_mtx );
+            while( segments.size() > config.max_retained_segments ) {
+               retired.push_back( segments.begin()->second );
+               segments.erase( segments.begin() );
+            }
+         }
+
+         // readers still holding a view of a retired segment keep their mapping until they release it
+         for( const auto& seg : retired ) {
+            if( config.archive_dir.empty() ) {
+               ilog( "Removing block log segment ${f}", ("f", seg->block_file.generic_string()) );
+               fc::remove( seg->block_file );
+               fc::remove( seg->index_file );
+            } else {
+               if( !fc::is_directory( config.archive_dir ) )
+                  fc::create_directories( config.archive_dir );
+               ilog( "Archiving block log segment ${f} to ${d}",
+                     ("f", seg->block_file.generic_string())("d", config.archive_dir.generic_string()) );
+               fc::rename( seg->block_file, config.archive_dir / seg->block_file.filename() );
+               fc::rename( seg->index_file, config.archive_dir / seg->index_file.filename() );
+            }
+         }
+      }
+
+      /// write one block entry, its trailer and its index entry to the end of blocks.log without flushing
+      uint64_t block_log_impl::write_block( const signed_block& b, const bytes& packed ) {
+         block_stream.seekp(0, std::ios::end);
+         index_stream.seekp(0, std::ios::end);
+         uint64_t pos = block_stream.tellp();
+         EOS_ASSERT(index_stream.tellp() == sizeof(uint64_t) * (b.block_num() - first_block_num),
+                   block_log_append_fail,
+                   "Append to index file occuring at wrong position.",
+                   ("position", (uint64_t) index_stream.tellp())
+                   ("expected", (b.block_num() - first_block_num) * sizeof(uint64_t)));
+         if( compressed ) {
+            auto data = fc::raw::pack( zlib_compress_block( packed ) );
+            block_stream.write(data.data(), data.size());
+         } else {
+            block_stream.write(packed.data(), packed.size());
+         }
+         block_stream.write((char*)&pos, sizeof(pos));
+         index_stream.write((char*)&pos, sizeof(pos));
+         return pos;
+      }
+
+      void block_log_impl::start_writer() {
+         if( !async_writes() || writer_thread.joinable() ) return;
+         writer_stop = false;
+         writer_thread = std::thread( [this]() {
+            fc::set_os_thread_name( "blklog" );
+            write_pending();
+         } );
+      }
+
+      /// write everything still queued and join the writer; errors are logged since this runs on shutdown
+      void block_log_impl::stop_writer() {
+         if( !writer_thread.joinable() ) return;
+         {
+            std::lock_guard<std::mutex> g( pending_mtx );
+            writer_stop = true;
+         }
+         pending_cv.notify_one();
+         writer_thread.join();
+         if( writer_error ) {
+            try {
+               std::rethrow_exception( writer_error );
+            } catch( const fc::exception& e ) {
+               elog( "Block log writer failed, ${n} blocks were not written: ${e}", ("n", pending.size())("e", e.to_detail_string()) );
+            } catch( const std::exception& e ) {
+               elog( "Block log writer failed, ${n} blocks were not written: ${e}", ("n", pending.size())("e", e.what()) );
+            }
+         }
+      }
+
+      void block_log_impl::enqueue( const signed_block_ptr& b, packed_block_ptr packed ) {
+         std::unique_lock<std::mutex> g( pending_mtx );
+         if( writer_error ) std::rethrow_exception( writer_error );
+         if( pending.size() >= max_pending_blocks ) {
+            drain_requested = true;
+            pending_cv.notify_one();
+            written_cv.wait( g, [this]() { return pending.size() < max_pending_blocks || writer_error; } );
+            if( writer_error ) std::rethrow_exception( writer_error );
+         }
+         pending.push_back( pending_block{ b, std::move(packed) } );
+      }
+
+      /// wait until every queued block is written and flushed; afterwards the streams are only used by the caller
+      void block_log_impl::drain() {
+         if( !writer_thread.joinable() ) return;
+         std::unique_lock<std::mutex> g( pending_mtx );
+         if( !pending.empty() && !writer_error ) {
+            drain_requested = true;
+            pending_cv.notify_one();
+            written_cv.wait( g, [this]() { return pending.empty() || writer_error; } );
+         }
+         if( writer_error ) std::rethrow_exception( writer_error );
+      }
+
+      signed_block_ptr block_log_impl::find_pending( uint32_t block_num )const {
+         if( !async_writes() ) return {};
+         std::lock_guard<std::mutex> g( pending_mtx );
+         if( pending.empty() ) return {};
+         const uint32_t front_num = pending.front().block->block_num();
+         if( block_num < front_num || block_num - front_num >= pending.size() ) return {};
+         return pending[block_num - front_num].block;
+      }
+
+      /**
+       * Writer thread loop. Blocks stay at the front of the queue, and therefore readable, until they have been
+       * written and flushed; only then are they popped so readers fall through to the files.
+       */
+      void block_log_impl::write_pending() {
+         const auto interval = std::chrono::milliseconds( config.write_interval_ms );
+         std::unique_lock<std::mutex> g( pending_mtx );
+         while( true ) {
+            pending_cv.wait_for( g, interval, [this]() { return writer_stop || drain_requested; } );
+            drain_requested = false;
+            if( pending.empty() ) {
+               if( writer_stop ) break;
+               continue;
+            }
+
+            vector<pending_block> batch( pending.begin(), pending.end() );
+            g.unlock();
+            try {
+               for( const auto& pb : batch ) {
+                  write_block( *pb.block, *pb.packed );
+                  const uint32_t num = pb.block->block_num();
+                  if( config.stride > 0 && num % config.stride == 0 ) {
+                     split_log( num );
+                  }
+               }
+               block_stream.flush();
+               index_stream.flush();
+            } catch( ... ) {
+               g.lock();
+               writer_error = std::current_exception();
+               written_cv.notify_all();
+               break;
+            }
+            g.lock();
+            pending.erase( pending.begin(), pending.begin() + batch.size() );
+            written_cv.notify_all();
+         }
+      }
+
+      void block_log_impl::remove_segments() {
+         std::lock_guard<std::mutex> g( segments_mtx );
+         for( const auto& s : segments ) {
+            fc::remove( s.second->block_file );
+            fc::remove( s.second->index_file );
+         }
+         segments.clear();
+      }
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, const block_log_config& config)
    :my(new detail::block_log_impl()) {
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->config = config;
       open(data_dir);
+      my->start_writer();
    }
 
    block_log::block_log(block_log&& other) {
@@ -83,6 +829,7 @@ namespace eosio { namespace chain {
 
    block_log::~block_log() {
       if (my) {
+         my->stop_writer();
          flush();
          my->close();
          my.reset();
@@ -90,14 +837,18 @@ namespace eosio { namespace chain {
    }
 
    void block_log::open(const fc::path& data_dir) {
+      my->drain();
       my->close();
 
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
 
+      my->data_dir = data_dir;
       my->block_file = data_dir / "blocks.log";
       my->index_file = data_dir / "blocks.index";
 
+      my->load_segments();
+
       my->reopen();
 
       /* On startup of the block log, there are several states the log file and the index file can be
@@ -121,6 +872,22 @@ namespace eosio { namespace chain {
       auto log_size = fc::file_size(my->block_file);
       auto index_size = fc::file_size(my->index_file);
 
+      auto last_segment = my->last_segment();
+      if (!log_size && last_segment) {
+         // interrupted while splitting the log: start a new blocks.log right after the newest segment
+         ilog("Block log is empty, continuing after segment ${f}", ("f", last_segment->block_file.generic_string()));
+         auto view = last_segment->get_view();
+         auto header = detail::read_log_header( view->block_data(), view->block_size() );
+         auto g = my->lock_files();
+         my->close();
+         fc::remove_all(my->index_file);
+         my->reopen();
+         my->write_header( header.gs, last_segment->last_block_num + 1 );
+         my->finish_header();
+         log_size = fc::file_size(my->block_file);
+         index_size = 0;
+      }
+
       if (log_size) {
          ilog("Log is nonempty");
          my->block_stream.seekg( 0 );
@@ -141,11 +908,27 @@ namespace eosio { namespace chain {
             my->first_block_num = 1;
          }
 
-         my->head = read_head();
-         if( my->head ) {
-            my->head_id = my->head->id();
-         } else {
-            my->head_id = {};
+         uint32_t flags = 0;
+         if (my->version > 2) {
+            my->block_stream.read( (char*)&flags, sizeof(flags) );
+         }
+         my->compressed = detail::is_compressed( my->version, flags );
+         if( my->compressed != my->config.compress_blocks ) {
+            ilog( "Existing blocks.log is ${c}; the configured compression applies to block log files created from now on",
+                  ("c", my->compressed ? "compressed" : "not compressed") );
+         }
+
+         if( last_segment && last_segment->last_block_num + 1 != my->first_block_num ) {
+            wlog( "Ignoring block log segments because the newest one ends at block ${last} but blocks.log starts at block ${first}",
+                  ("last", last_segment->last_block_num)("first", my->first_block_num) );
+            my->forget_segments();
+            last_segment.reset();
+         }
+
+         my->set_head( read_head() );
+         if( !my->head && last_segment ) {
+            auto view = last_segment->get_view();
+            my->set_head( detail::read_block_from_view( *view, view->get_block_pos( last_segment->last_block_num ) ).first );
          }
 
          if (index_size) {
@@ -171,34 +954,44 @@ namespace eosio { namespace chain {
          }
       } else if (index_size) {
          ilog("Index is nonempty, remove and recreate it");
+         auto g = my->lock_files();
          my->close();
          fc::remove_all(my->index_file);
          my->reopen();
       }
+
+      // the retention limit may have been lowered, or the node stopped before retiring a segment it had just split off
+      my->retire_segments();
    }
 
    uint64_t block_log::append(const signed_block_ptr& b) {
+      return append( b, std::make_shared<const bytes>( fc::raw::pack(*b) ) );
+   }
+
+   uint64_t block_log::append(const signed_block_ptr& b, const packed_block_ptr& packed) {
       try {
          EOS_ASSERT( my->genesis_written_to_block_log, block_log_append_fail, "Cannot append to block log until the genesis is first written" );
 
-         my->check_open_files();
+         // the streams belong to the writer thread while it is running
+         if( my->writer_running() ) {
+            EOS_ASSERT( !my->head || b->block_num() == my->head->block_num() + 1, block_log_append_fail,
+                        "Append to block log out of order", ("block_num", b->block_num())("head", my->head->block_num()) );
+            // queue before publishing the new head so readers on other threads always find the block
+            my->enqueue( b, packed );
+            my->set_head( b );
+            return npos;
+         }
 
-         my->block_stream.seekp(0, std::ios::end);
-         my->index_stream.seekp(0, std::ios::end);
-         uint64_t pos = my->block_stream.tellp();
-         EOS_ASSERT(my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - my->first_block_num),
-                   block_log_append_fail,
-                   "Append to index file occuring at wrong position.",
-                   ("position", (uint64_t) my->index_stream.tellp())
-                   ("expected", (b->block_num() - my->first_block_num) * sizeof(uint64_t)));
-         auto data = fc::raw::pack(*b);
-         my->block_stream.write(data.data(), data.size());
-         my->block_stream.write((char*)&pos, sizeof(pos));
-         my->index_stream.write((char*)&pos, sizeof(pos));
-         my->head = b;
-         my->head_id = b->id();
+         my->check_open_files();
+         uint64_t pos = my->write_block( *b, *packed );
 
+         // flush before publishing the new head so readers on other threads never see a partially written block
          flush();
+         my->set_head( b );
+
+         if( my->config.stride > 0 && b->block_num() % my->config.stride == 0 ) {
+            my->split_log( b->block_num() );
+         }
 
          return pos;
       }
@@ -206,80 +999,77 @@ namespace eosio { namespace chain {
    }
 
    void block_log::flush() {
+      my->drain();
       my->block_stream.flush();
       my->index_stream.flush();
    }
 
    void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block, uint32_t first_block_num ) {
+      my->drain();
+      auto g = my->lock_files();
       my->close();
 
+      my->remove_segments();
       fc::remove_all(my->block_file);
       fc::remove_all(my->index_file);
 
       my->reopen();
 
-      auto data = fc::raw::pack(gs);
-      my->version = 0; // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
-      my->first_block_num = first_block_num;
-      my->block_stream.seekp(0, std::ios::end);
-      my->block_stream.write((char*)&my->version, sizeof(my->version));
-      my->block_stream.write((char*)&my->first_block_num, sizeof(my->first_block_num));
-      my->block_stream.write(data.data(), data.size());
-      my->genesis_written_to_block_log = true;
-
-      // append a totem to indicate the division between blocks and header
-      auto totem = npos;
-      my->block_stream.write((char*)&totem, sizeof(totem));
+      my->write_header( gs, first_block_num );
 
+      // the first block is always written directly, the header cannot be completed while it is queued
       if (first_block) {
-         append(first_block);
-      } else {
-         my->head.reset();
-         my->head_id = {};
+         my->write_block( *first_block, fc::raw::pack(*first_block) );
       }
 
-      auto pos = my->block_stream.tellp();
-
-      static_assert( block_log::max_supported_version > 0, "a version number of zero is not supported" );
-      my->version = block_log::max_supported_version;
-      my->block_stream.seekp( 0 );
-      my->block_stream.write( (char*)&my->version, sizeof(my->version) );
-      my->block_stream.seekp( pos );
-      flush();
+      my->finish_header();
+      my->set_head( first_block );
    }
 
    std::pair<signed_block_ptr, uint64_t> block_log::read_block(uint64_t pos)const {
-      my->check_open_files();
-
-      my->block_stream.seekg(pos);
-      std::pair<signed_block_ptr,uint64_t> result;
-      result.first = std::make_shared<signed_block>();
-      fc::raw::unpack(my->block_stream, *result.first);
-      result.second = uint64_t(my->block_stream.tellg()) + 8;
-      return result;
+      auto view = my->get_view_for_pos( pos );
+      return detail::read_block_from_view( *view, pos );
    }
 
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
          signed_block_ptr b;
-         uint64_t pos = get_block_pos(block_num);
-         if (pos != npos) {
-            b = read_block(pos).first;
-            EOS_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
-                      "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
+         if( block_num == 0 || block_num > my->head_block_num.load( std::memory_order_acquire ) )
+            return b;
+
+         // blocks still queued for the writer thread are served from the queue
+         if( (b = my->find_pending( block_num )) )
+            return b;
+
+         auto view = my->get_view( block_num );
+         if( block_num < view->first_block_num ) {
+            auto seg = my->find_segment( block_num );
+            if( !seg ) return b;
+            view.view = seg->get_view(); // segments are never truncated, the lock is just held a little longer
          }
+         if( !view->contains_block( block_num ) )
+            return b;
+
+         b = detail::read_block_from_view( *view, view->get_block_pos( block_num ) ).first;
+         EOS_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
+                   "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
          return b;
       } FC_LOG_AND_RETHROW()
    }
 
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
-      my->check_open_files();
-      if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
+      if( block_num == 0 || block_num > my->head_block_num.load( std::memory_order_acquire ) )
          return npos;
-      my->index_stream.seekg(sizeof(uint64_t) * (block_num - my->first_block_num));
-      uint64_t pos;
-      my->index_stream.read((char*)&pos, sizeof(pos));
-      return pos;
+      // a position only exists once the block is in the file, so wait for the writer to get that far
+      if( my->find_pending( block_num ) )
+         my->drain();
+      auto view = my->get_view( block_num );
+      if( block_num < view->first_block_num ) {
+         auto seg = my->find_segment( block_num );
+         if( !seg ) return npos;
+         view.view = seg->get_view();
+      }
+      return view->contains_block( block_num ) ? view->get_block_pos( block_num ) : npos;
    }
 
    signed_block_ptr block_log::read_head()const {
@@ -306,54 +1096,16 @@ namespace eosio { namespace chain {
    }
 
    uint32_t block_log::first_block_num() const {
-      return my->first_block_num;
+      auto first_segment_block_num = my->first_segment_block_num();
+      return first_segment_block_num ? first_segment_block_num : my->first_block_num;
    }
 
    void block_log::construct_index() {
-      ilog("Reconstructing Block Log Index...");
+      my->drain();
+      auto g = my->lock_files();
       my->close();
-
-      fc::remove_all(my->index_file);
-
+      detail::construct_index( my->block_file, my->index_file );
       my->reopen();
-
-      uint64_t end_pos;
-
-      my->block_stream.seekg(-sizeof( uint64_t), std::ios::end);
-      my->block_stream.read((char*)&end_pos, sizeof(end_pos));
-
-      if( end_pos == npos ) {
-         ilog( "Block log contains no blocks. No need to construct index." );
-         return;
-      }
-
-      signed_block tmp;
-
-      uint64_t pos = 0;
-      if (my->version == 1) {
-         pos = 4; // Skip version which should have already been checked.
-      } else {
-         pos = 8; // Skip version and first block offset which should have already been checked
-      }
-      my->block_stream.seekg(pos);
-
-      genesis_state gs;
-      fc::raw::unpack(my->block_stream, gs);
-
-      // skip the totem
-      if (my->version > 1) {
-         uint64_t totem;
-         my->block_stream.read((char*) &totem, sizeof(totem));
-      }
-
-      my->index_stream.seekp(0, std::ios::end);
-      while( pos < end_pos ) {
-         fc::raw::unpack(my->block_stream, tmp);
-         my->block_stream.read((char*)&pos, sizeof(pos));
-         if(tmp.block_num() % 1000 == 0)
-            ilog( "Block log index reconstructed for block ${n}", ("n", tmp.block_num()));
-         my->index_stream.write((char*)&pos, sizeof(pos));
-      }
    } // construct_index
 
    fc::path block_log::repair_log( const fc::path& data_dir, uint32_t truncate_at_block ) {
@@ -382,6 +1134,20 @@ namespace eosio { namespace chain {
       fc::create_directories(blocks_dir);
       auto block_log_path = blocks_dir / "blocks.log";
 
+      // segments are immutable, so hard link them back instead of copying; the backup keeps its own links
+      for( boost::filesystem::directory_iterator enditr, itr{backup_dir}; itr != enditr; ++itr ) {
+         uint32_t first = 0, last = 0;
+         if( !detail::block_log_segment::parse_name( itr->path().filename().generic_string(), first, last ) )
+            continue;
+         EOS_ASSERT( truncate_at_block == 0 || truncate_at_block > last, block_log_exception,
+                     "Cannot truncate at block ${t} which is in segment ${f}; remove the later segments manually",
+                     ("t", truncate_at_block)("f", itr->path().filename().generic_string()) );
+         detail::block_log_segment seg( first, last, backup_dir );
+         boost::filesystem::create_hard_link( seg.block_file, blocks_dir / seg.block_file.filename() );
+         if( fc::exists( seg.index_file ) )
+            boost::filesystem::create_hard_link( seg.index_file, blocks_dir / seg.index_file.filename() );
+      }
+
       ilog( "Reconstructing '${new_block_log}' from backed up block log", ("new_block_log", block_log_path) );
 
       std::fstream  old_block_stream;
@@ -409,6 +1175,13 @@ namespace eosio { namespace chain {
          new_block_stream.write( (char*)&first_block_num, sizeof(first_block_num) );
       }
 
+      uint32_t flags = 0;
+      if (version > 2) {
+         old_block_stream.read ( (char*)&flags, sizeof(flags) );
+         new_block_stream.write( (char*)&flags, sizeof(flags) );
+      }
+      const bool compressed = detail::is_compressed( version, flags );
+
       genesis_state gs;
       fc::raw::unpack(old_block_stream, gs);
 
@@ -437,9 +1210,10 @@ namespace eosio { namespace chain {
       uint64_t pos = old_block_stream.tellg();
       while( pos < end_pos ) {
          signed_block tmp;
+         bytes        frame;
 
          try {
-            fc::raw::unpack(old_block_stream, tmp);
+            detail::unpack_block_entry(old_block_stream, tmp, compressed, &frame);
          } catch( ... ) {
             except_ptr = std::current_exception();
             incomplete_block_data.resize( end_pos - pos );
@@ -469,7 +1243,8 @@ namespace eosio { namespace chain {
             break;
          }
 
-         auto data = fc::raw::pack(tmp);
+         // compressed frames are copied as stored rather than re-encoded
+         auto data = compressed ? fc::raw::pack(frame) : fc::raw::pack(tmp);
          new_block_stream.write( data.data(), data.size() );
          new_block_stream.write( reinterpret_cast<char*>(&pos), sizeof(pos) );
          block_num = tmp.block_num();
@@ -538,177 +1313,211 @@ namespace eosio { namespace chain {
          block_stream.read ( (char*)&first_block_num, sizeof(first_block_num) );
       }
 
+      uint32_t flags = 0;
+      if (version > 2) {
+         block_stream.read ( (char*)&flags, sizeof(flags) );
+      }
+
       genesis_state gs;
       fc::raw::unpack(block_stream, gs);
       return gs;
    }
-#if 1 
-void block_log::backup_log( const fc::path& data_dir) {
-      ilog("Backuping Block Log...");
+   namespace detail {
+      /// read the 8-byte block position stored at offset of an open file descriptor
+      static uint64_t read_trailer_at( int fd, uint64_t offset ) {
+         uint64_t pos = block_log::npos;
+         EOS_ASSERT( ::pread( fd, &pos, sizeof(pos), offset ) == sizeof(pos), block_log_exception,
+                     "Unable to read block log trailer at offset ${o}", ("o", offset) );
+         return pos;
+      }
+
+      /// returns true if [offset, offset + len) holds the same bytes in both files
+      static bool ranges_equal( int fd_a, int fd_b, uint64_t offset, uint64_t len ) {
+         std::vector<char> a( std::min<uint64_t>( len, 1024*1024 ) ), b( a.size() );
+         while( len > 0 ) {
+            const size_t n = std::min<uint64_t>( len, a.size() );
+            if( ::pread( fd_a, a.data(), n, offset ) != ssize_t(n) ) return false;
+            if( ::pread( fd_b, b.data(), n, offset ) != ssize_t(n) ) return false;
+            if( memcmp( a.data(), b.data(), n ) != 0 ) return false;
+            offset += n;
+            len -= n;
+         }
+         return true;
+      }
+
+      /**
+       * Copy [offset, offset + len) of src_fd to the same offset of dst_fd. On Linux the data stays in the kernel:
+       * copy_file_range is tried first, then sendfile when the filesystems do not support it, and only then a
+       * buffered read/write loop.
+       */
+      static void copy_file_range_to( int src_fd, int dst_fd, uint64_t offset, uint64_t len ) {
+         uint64_t done = 0;
+#if defined(__linux__) && defined(__NR_copy_file_range)
+         while( done < len ) {
+            loff_t in_off = offset + done, out_off = offset + done;
+            ssize_t r = ::syscall( __NR_copy_file_range, src_fd, &in_off, dst_fd, &out_off, size_t(len - done), 0u );
+            if( r <= 0 ) break;
+            done += r;
+         }
+#endif
+#if defined(__linux__)
+         if( done < len && ::lseek( dst_fd, offset + done, SEEK_SET ) >= 0 ) {
+            while( done < len ) {
+               off_t in_off = offset + done;
+               ssize_t r = ::sendfile( dst_fd, src_fd, &in_off, std::min<uint64_t>( len - done, 0x7ffff000 ) );
+               if( r <= 0 ) break;
+               done += r;
+            }
+         }
+#endif
+         std::vector<char> buffer( 4*1024*1024 );
+         while( done < len ) {
+            const size_t n = std::min<uint64_t>( len - done, buffer.size() );
+            ssize_t r = ::pread( src_fd, buffer.data(), n, offset + done );
+            EOS_ASSERT( r > 0, block_log_exception, "Unable to read block log at offset ${o}", ("o", offset + done) );
+            EOS_ASSERT( ::pwrite( dst_fd, buffer.data(), r, offset + done ) == r, block_log_exception,
+                        "Unable to write block log backup at offset ${o}", ("o", offset + done) );
+            done += r;
+         }
+      }
+
+      struct scoped_fd {
+         explicit scoped_fd( int fd ) : fd(fd) {}
+         ~scoped_fd() { if( fd >= 0 ) ::close( fd ); }
+         scoped_fd( const scoped_fd& ) = delete;
+         scoped_fd& operator=( const scoped_fd& ) = delete;
+         int fd;
+      };
+
+      /// first block number recorded in the header of a block log file, 0 if the header cannot be read
+      static uint32_t read_first_block_num( const fc::path& path ) {
+         scoped_fd fd( ::open( path.generic_string().c_str(), O_RDONLY ) );
+         uint32_t version = 0, first_block_num = 0;
+         if( fd.fd < 0 || ::pread( fd.fd, &version, sizeof(version), 0 ) != sizeof(version) ) return 0;
+         if( version == 1 ) return 1;
+         if( ::pread( fd.fd, &first_block_num, sizeof(first_block_num), sizeof(version) ) != sizeof(first_block_num) ) return 0;
+         return first_block_num;
+      }
+
+      /**
+       * Bring backup_path up to date with the block log file at log_path, appending only what the backup is missing
+       * when it is a prefix of the log and recreating it otherwise.
+       * @return the number of bytes copied
+       */
+      static uint64_t backup_file( const fc::path& log_path, const fc::path& backup_path ) {
+         scoped_fd log_fd( ::open( log_path.generic_string().c_str(), O_RDONLY ) );
+         EOS_ASSERT( log_fd.fd >= 0, block_log_exception, "Unable to open '${f}'", ("f", log_path) );
+
+         const uint64_t log_size = fc::file_size( log_path );
+         EOS_ASSERT( log_size > sizeof(uint64_t), block_log_exception, "Block log '${f}' is empty", ("f", log_path) );
+         const uint64_t log_head_pos = read_trailer_at( log_fd.fd, log_size - sizeof(uint64_t) );
+         EOS_ASSERT( log_head_pos == block_log::npos || log_head_pos < log_size - sizeof(uint64_t), block_log_exception,
+                     "Block log '${f}' does not end with a valid block position", ("f", log_path)("pos", log_head_pos) );
+
+         uint64_t copy_from = 0;
+
+         if( fc::exists( backup_path ) ) {
+            scoped_fd backup_fd( ::open( backup_path.generic_string().c_str(), O_RDWR ) );
+            EOS_ASSERT( backup_fd.fd >= 0, block_log_exception, "Unable to open '${f}'", ("f", backup_path) );
+            const uint64_t backup_size = fc::file_size( backup_path );
+
+            // The backup can only be extended if it is a prefix of the log that ends on a block boundary: its trailer
+            // must point into it, the same trailer must be at the same offset of the log, and the header and the
+            // last backed up block must be byte for byte identical in both files.
+            bool is_prefix = false;
+            if( backup_size > sizeof(uint64_t) && backup_size <= log_size ) {
+               const uint64_t backup_head_pos = read_trailer_at( backup_fd.fd, backup_size - sizeof(uint64_t) );
+               const uint64_t header_size = sizeof(uint32_t) + sizeof(uint32_t);
+               if( backup_head_pos < backup_size - sizeof(uint64_t) &&
+                   read_trailer_at( log_fd.fd, backup_size - sizeof(uint64_t) ) == backup_head_pos &&
+                   ranges_equal( log_fd.fd, backup_fd.fd, 0, std::min( header_size, backup_head_pos ) ) &&
+                   ranges_equal( log_fd.fd, backup_fd.fd, backup_head_pos, backup_size - backup_head_pos ) ) {
+                  is_prefix = true;
+               }
+            }
+
+            if( is_prefix ) {
+               if( backup_size == log_size ) {
+                  ilog( "Block log backup '${f}' is already up to date (${size} bytes)", ("f", backup_path)("size", log_size) );
+                  return 0;
+               }
+               ilog( "Extending block log backup '${f}' from ${from} to ${to} bytes",
+                     ("f", backup_path)("from", backup_size)("to", log_size) );
+               copy_file_range_to( log_fd.fd, backup_fd.fd, backup_size, log_size - backup_size );
+               EOS_ASSERT( ::fsync( backup_fd.fd ) == 0, block_log_exception, "Unable to sync '${f}'", ("f", backup_path) );
+               copy_from = backup_size;
+            } else {
+               wlog( "Block log backup '${f}' (${b} bytes) is not a prefix of '${l}' (${s} bytes), recreating it",
+                     ("f", backup_path)("b", backup_size)("l", log_path)("s", log_size) );
+            }
+         }
+
+         if( copy_from == 0 ) {
+            // write the full copy next to the backup and move it into place so a failure never leaves a partial backup
+            auto tmp_path = backup_path.parent_path() / (backup_path.filename().generic_string() + ".tmp");
+            {
+               scoped_fd tmp_fd( ::open( tmp_path.generic_string().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 ) );
+               EOS_ASSERT( tmp_fd.fd >= 0, block_log_exception, "Unable to create '${f}'", ("f", tmp_path) );
+               copy_file_range_to( log_fd.fd, tmp_fd.fd, 0, log_size );
+               EOS_ASSERT( ::fsync( tmp_fd.fd ) == 0, block_log_exception, "Unable to sync '${f}'", ("f", tmp_path) );
+            }
+            fc::rename( tmp_path, backup_path );
+         }
+
+         return log_size - copy_from;
+      }
+   }
+
+   void block_log::backup_log( const fc::path& data_dir ) {
+      ilog("Backing up Block Log...");
       EOS_ASSERT( fc::is_directory(data_dir) && fc::is_regular_file(data_dir / "blocks.log"), block_log_not_found,
                  "Block log not found in '${blocks_dir}'", ("blocks_dir", data_dir)          );
 
       auto blocks_dir = fc::canonical( data_dir );
       if( blocks_dir.filename().generic_string() == "." ) {
-            blocks_dir = blocks_dir.parent_path();
+         blocks_dir = blocks_dir.parent_path();
       }
-      auto backup_dir = blocks_dir.parent_path().parent_path();
-      auto blocks_dir_name = blocks_dir.filename();
-      EOS_ASSERT( blocks_dir_name.generic_string() != ".", block_log_exception, "Invalid path to blocks directory" );
+      EOS_ASSERT( blocks_dir.filename().generic_string() != ".", block_log_exception, "Invalid path to blocks directory" );
 
-#if 1
-      auto backup_log_path = backup_dir / "blocks_backup.log";
-      auto block_log_path = blocks_dir / "blocks.log";
-      std::exception_ptr     except_ptr;
-#else
-       //backup_dir = backup_dir / blocks_dir_name.generic_string().append("-").append( now );
-      EOS_ASSERT( !fc::exists(backup_dir), block_log_backup_dir_exist,
-                 "Cannot move existing blocks directory to already existing directory '${new_blocks_dir}'",
-                 ("new_blocks_dir", backup_dir) );
-#endif
-      if(!fc::exists(backup_log_path))
-      {
-            std::fstream  block_stream,backup_block_stream;
-            uint64_t pos_tmp,pos;  
-            fc::remove(backup_log_path); 
-            fc::copy(block_log_path,backup_log_path);
-            block_stream.open( block_log_path.generic_string().c_str(), LOG_READ );
-            block_stream.seekg(-sizeof(uint64_t), std::ios::end); 
-            block_stream.read((char*)&pos_tmp, sizeof(pos_tmp));   
-            backup_block_stream.open( block_log_path.generic_string().c_str(), LOG_READ );
-            backup_block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            backup_block_stream.read((char*)&pos, sizeof(pos));           
-            ilog("backup the new block log pos=${pos_tmp},backup blocks log pos=${pos}",("pos_tmp",pos_tmp)("pos",pos)); 
-            return ;
-      }
-      else 
-      {
-            std::fstream  block_stream;
-            std::fstream  backup_block_stream;
-            block_stream.open( block_log_path.generic_string().c_str(), LOG_READ );
-            //backup_block_stream.open( backup_log_path.generic_string().c_str(), LOG_WRITE );
-            backup_block_stream.open( backup_log_path.generic_string().c_str(), LOG_READ ); 
-            block_stream.seekg( 0, std::ios::end );
-            backup_block_stream.seekg( 0,std::ios::end );
-            uint64_t block_end_pos = block_stream.tellg();
-            uint64_t backup_end_pos = backup_block_stream.tellg();
-
-            //output the two files size 
-            ilog("block.log file size = ${block_end_pos},blocks_backup.log file size = ${backup_end_pos}",("block_end_pos",block_end_pos)("backup_end_pos",backup_end_pos));
-            //if blocks_backup.log is large then blocks.log,then copy blocks.log instead of itself
-            if(backup_end_pos>=block_end_pos)
-            {
-                  ilog("the blocks_backup.log ${backup_end_pos}is large than blocks.log ${block_end_pos} ",("backup_end_pos",backup_end_pos)("block_end_pos",block_end_pos));
-                  block_stream.close();
-                  backup_block_stream.close();
-                  fc::remove(backup_log_path);
-                  fc::copy(block_log_path,backup_log_path);
-                  return ;
-            }
-            else
-            {
-                  uint64_t pos,pos_tmp;
-                  signed_block tmp,tmp1;
-
-                  backup_block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-                  backup_block_stream.read((char*)&pos, sizeof(pos));
-                  block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-                  block_stream.read((char*)&pos_tmp, sizeof(pos_tmp)); 
-                  ilog("blocks_backup.log the last block pos = ${pos},blocks.log the last block pos =${pos_tmp} ",("pos",pos)("pos_tmp",pos_tmp));
-
-                  backup_block_stream.seekg(pos);
-                  block_stream.seekg(pos);
-                  fc::raw::unpack(backup_block_stream,tmp);
-                  fc::raw::unpack(block_stream,tmp1);
-                  auto id = tmp.id();
-                  auto id_tmp = tmp1.id();
-                  if( block_header::num_from_id(id) != block_header::num_from_id(id_tmp))
-                  {
-                      //check the backup_block.log last id ,if not same copy the blocks.log as well
-                        ilog("the blocks_backup.log  ${id} is different  than blocks.log ${id_tmp} ",("id",id)("id_tmp",id_tmp));
-                              block_stream.close();
-                              backup_block_stream.close();
-                        fc::copy(block_log_path,backup_log_path);
-                        return ;
-                  }
-                  backup_block_stream.seekg(0, std::ios::end);
-                  //get the backup_blocks.log file size
-                  //pos = backup_block_stream.tellg(); 
-                  //block_stream.seekg(pos);      
-                  //copy the increasement  file 
-                  backup_block_stream.close();
-                  backup_block_stream.open( backup_log_path.generic_string().c_str(), LOG_WRITE );
-                  backup_block_stream.seekg( 0,std::ios::end ); 
-                  pos = backup_block_stream.tellg();
-                  block_stream.seekg(pos);      
-                  block_id_type previous;
-                  while(pos<block_end_pos)
-                  {
-                        ilog("the blocks.log backup processing ,position is ${pos},total pos = ${block_end_pos} ",("pos",pos)("block_end_pos",block_end_pos));
-                        try {
-                              fc::raw::unpack(block_stream, tmp);
-                        } catch( ... ) {
-                                   except_ptr = std::current_exception();
-                                   ilog("the blocks.log read data error ,position is ${pos},total pos = ${block_end_pos} ",("pos",pos)("block_end_pos",block_end_pos));
-                                   break;
-                        }
-                        auto id = tmp.id();
-                        if(pos == backup_end_pos)
-                        {     
-                             // the first time get the blocks,just copy the data id
-                             previous = id;
-                        }
-                        else
-                        {
-                            if(block_header::num_from_id(previous) + 1 != block_header::num_from_id(id) )
-                            {
-                                  ilog("the blocks.log data id is error,the position is ${pos}, the previous is ${previous},the id is ${id}",\
-                                        ("pos",pos)("previous",block_header::num_from_id(previous) + 1 )("id",block_header::num_from_id(id)));
-                                  break;
-                            }
-                            previous = id;
-                        }
-                        uint64_t tmp_pos = std::numeric_limits<uint64_t>::max();
-                        if( (static_cast<uint64_t>(block_stream.tellg()) + sizeof(pos)) <= block_end_pos ) {
-                             block_stream.read( reinterpret_cast<char*>(&tmp_pos), sizeof(tmp_pos) );
-                        }
-                        if( pos != tmp_pos ) {
-                              ilog("the blocks.log postion value is error,the active position is ${pos}, the position is ${tmp_pos}",\
-                                    ("pos",pos)("tmp_pos",tmp_pos));
-                             break;
-                        }
-                      
-                        auto data = fc::raw::pack(tmp);
-                        backup_block_stream.write( data.data(), data.size() );
-                        backup_block_stream.write( reinterpret_cast<char*>(&pos), sizeof(pos) );
-                        pos = backup_block_stream.tellp();
-              
-                 }
-                 //which appens error during processing ,then reset the backup data  
-                 if(pos<block_end_pos)
-                 {
-                   //      fc::resize_file(backup_log_path,backup_end_pos);
-                 }
-          
-                 if( except_ptr ) {
-                     std::string error_msg;
-
-                  try {
-                          std::rethrow_exception(except_ptr);
-                     } catch( const fc::exception& e ) {
-                          error_msg = e.what();
-                     } catch( const std::exception& e ) {
-                       error_msg = e.what();
-                  } catch( ... ) {
-                       error_msg = "unrecognized exception";
-                  }
-                  ilog("Backup only up to block position ${pos} could not be deserialized from the block log due to error:\n${error_msg}",
-                             ("pos", pos)("error_msg", error_msg) );
+      const auto backup_dir      = blocks_dir.parent_path().parent_path();
+      const auto backup_log_path = backup_dir / "blocks_backup.log";
 
-                  }
-            } 
+      // segments of the block log, keyed by their first block
+      std::map<uint32_t, std::pair<uint32_t, fc::path>> segment_files;
+      for( boost::filesystem::directory_iterator enditr, itr{blocks_dir}; itr != enditr; ++itr ) {
+         uint32_t first = 0, last = 0;
+         if( detail::block_log_segment::parse_name( itr->path().filename().generic_string(), first, last ) )
+            segment_files[first] = { last, itr->path() };
       }
-}
-#endif
+
+      const auto start = fc::time_point::now();
+      uint64_t copied = 0;
+      uint64_t backup_size = 0;
+
+      // Segments are backed up next to blocks_backup.log as blocks_backup-<first>-<last>.log, oldest first. A backup
+      // of blocks.log taken before the log was split starts at the same block as the segment those blocks were moved
+      // to, so it is completed from that segment rather than being compared against, and recreated from, the newer
+      // blocks.log.
+      for( const auto& s : segment_files ) {
+         const uint32_t first = s.first, last = s.second.first;
+         const auto segment_backup_path = backup_dir / ("blocks_backup-" + std::to_string( first ) + "-" + std::to_string( last ) + ".log");
+         if( !fc::exists( segment_backup_path ) && fc::exists( backup_log_path ) &&
+             detail::read_first_block_num( backup_log_path ) == first ) {
+            ilog( "Block log backup '${f}' starts at block ${first}, continuing it from segment '${s}'",
+                  ("f", backup_log_path)("first", first)("s", s.second.second) );
+            fc::rename( backup_log_path, segment_backup_path );
+         }
+         copied += detail::backup_file( s.second.second, segment_backup_path );
+         backup_size += fc::file_size( segment_backup_path );
+      }
+
+      copied += detail::backup_file( blocks_dir / "blocks.log", backup_log_path );
+      backup_size += fc::file_size( backup_log_path );
+
+      const auto elapsed = std::max<int64_t>( (fc::time_point::now() - start).count(), 1 );
+      ilog( "Block log backup in '${d}' now holds ${size} bytes in ${n} files, copied ${copied} bytes in ${ms} ms (${mbps} MiB/s)",
+            ("d", backup_dir)("size", backup_size)("n", segment_files.size() + 1)("copied", copied)("ms", elapsed / 1000)
+            ("mbps", copied * 1000000 / elapsed / (1024*1024)) );
+   }
 
 } } /// eosio::chain
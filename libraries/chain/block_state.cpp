@@ -41,4 +41,15 @@ namespace eosio { namespace chain {
    ,trxs( std::move(trx_metas) )
    {}
 
+   packed_block_ptr block_state::packed_block()const {
+      auto packed = std::atomic_load( &_packed_block );
+      if( !packed ) {
+         auto p = std::make_shared<const bytes>( fc::raw::pack( *block ) );
+         // if another thread packed it first keep that copy, both are identical
+         if( std::atomic_compare_exchange_strong( &_packed_block, &packed, p ) )
+            packed = std::move( p );
+      }
+      return packed;
+   }
+
 } } /// eosio::chain
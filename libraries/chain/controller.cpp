@@ -118,6 +118,7 @@ struct building_block {
    vector<transaction_metadata_ptr>   _pending_trx_metas;
    vector<transaction_receipt>        _pending_trx_receipts;
    vector<action_receipt>             _actions;
+   vector<transaction_access_set>     _pending_trx_access_sets;
 };
 
 struct assembled_block {
@@ -291,9 +292,10 @@ struct controller_impl {
     reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
         cfg.read_only ? database::read_only : database::read_write,
         cfg.reversible_cache_size, false, cfg.db_map_mode, cfg.db_hugepage_paths ),
-    blog( cfg.blocks_dir ),
+    blog( cfg.blocks_dir, cfg.blog ),
     fork_db( cfg.state_dir ),
-    wasmif( cfg.wasm_runtime, db ),
+    wasmif( cfg.wasm_runtime, db, cfg.wasm_code_cache_dir, cfg.wasm_code_cache_build_id, cfg.wasm_background_compile,
+            cfg.wasm_inline_checktime ),
     resource_limits( db ),
     authorization( s, db ),
     protocol_features( std::move(pfs) ),
@@ -312,6 +314,14 @@ struct controller_impl {
       set_activation_handler<builtin_protocol_feature_t::preactivate_feature>();
       set_activation_handler<builtin_protocol_feature_t::replace_deferred>();
       set_activation_handler<builtin_protocol_feature_t::get_sender>();
+      set_activation_handler<builtin_protocol_feature_t::batch_db_reads>();
+
+      for( const auto& nc : cfg.native_contracts ) {
+         auto impl = native_contracts::find( nc.second );
+         EOS_ASSERT( impl, misc_exception, "unknown native contract ${n}", ("n", nc.second) );
+         wasmif.register_native_contract( nc.first, impl );
+      }
+      wasmif.set_native_contract_mode( cfg.native_contract_mode );
 
       self.irreversible_block.connect([this](const block_state_ptr& bsp) {
          wasmif.current_lib(bsp->block_num);
@@ -400,7 +410,7 @@ struct controller_impl {
             db.commit( (*bitr)->block_num );
             root_id = (*bitr)->id;
 
-            blog.append( (*bitr)->block );
+            blog.append( (*bitr)->block, (*bitr)->packed_block() );
 
             auto rbitr = rbi.begin();
             while( rbitr != rbi.end() && rbitr->blocknum <= (*bitr)->block_num ) {
@@ -946,16 +956,19 @@ struct controller_impl {
       auto orig_block_transactions_size = bb._pending_trx_receipts.size();
       auto orig_state_transactions_size = bb._pending_trx_metas.size();
       auto orig_state_actions_size      = bb._actions.size();
+      auto orig_access_sets_size        = bb._pending_trx_access_sets.size();
 
       std::function<void()> callback = [this,
                                         orig_block_transactions_size,
                                         orig_state_transactions_size,
-                                        orig_state_actions_size]()
+                                        orig_state_actions_size,
+                                        orig_access_sets_size]()
       {
          auto& bb = pending->_block_stage.get<building_block>();
          bb._pending_trx_receipts.resize(orig_block_transactions_size);
          bb._pending_trx_metas.resize(orig_state_transactions_size);
          bb._actions.resize(orig_state_actions_size);
+         bb._pending_trx_access_sets.resize(orig_access_sets_size);
       };
 
       return fc::make_scoped_exit( std::move(callback) );
@@ -1112,6 +1125,9 @@ struct controller_impl {
       trx_context.billed_cpu_time_us = billed_cpu_time_us;
       trx_context.enforce_whiteblacklist = gtrx.sender.empty() ? true : !sender_avoids_whitelist_blacklist_enforcement( gtrx.sender );
       trace = trx_context.trace;
+      if( conf.track_transaction_access_sets ) {
+         trx_context.access_set.emplace();
+      }
       try {
          trx_context.init_for_deferred_trx( gtrx.published );
 
@@ -1136,6 +1152,11 @@ struct controller_impl {
                                         trace->net_usage );
 
          fc::move_append( pending->_block_stage.get<building_block>()._actions, move(trx_context.executed) );
+         if( trx_context.access_set ) {
+            // removing the generated transaction touches the shared generated_transaction table
+            trx_context.access_set->global_write = true;
+            pending->_block_stage.get<building_block>()._pending_trx_access_sets.emplace_back( std::move(*trx_context.access_set) );
+         }
 
          trace->account_ram_delta = account_delta( gtrx.payer, trx_removal_ram_delta );
 
@@ -1279,6 +1300,9 @@ struct controller_impl {
          trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
          trx_context.billed_cpu_time_us = billed_cpu_time_us;
          trace = trx_context.trace;
+         if( conf.track_transaction_access_sets && !trx->implicit ) {
+            trx_context.access_set.emplace();
+         }
          try {
             if( trx->implicit ) {
                trx_context.init_for_implicit_trx();
@@ -1313,6 +1337,12 @@ struct controller_impl {
                                                     : transaction_receipt::delayed;
                trace->receipt = push_receipt(*trx->packed_trx, s, trx_context.billed_cpu_time_us, trace->net_usage);
                pending->_block_stage.get<building_block>()._pending_trx_metas.emplace_back(trx);
+               if( trx_context.access_set ) {
+                  // a delayed transaction is stored in the shared generated_transaction table
+                  if( s == transaction_receipt::delayed )
+                     trx_context.access_set->global_write = true;
+                  pending->_block_stage.get<building_block>()._pending_trx_access_sets.emplace_back( std::move(*trx_context.access_set) );
+               }
             } else {
                transaction_receipt_header r;
                r.status = transaction_receipt::executed;
@@ -1541,6 +1571,14 @@ struct controller_impl {
          std::move( bb._new_protocol_feature_activations )
       ) );
 
+      // measurement only, the transactions of the block were executed serially
+      if( conf.track_transaction_access_sets && !bb._pending_trx_access_sets.empty() ) {
+         auto waves = conflict_free_waves( bb._pending_trx_access_sets );
+         uint32_t num_waves = *std::max_element( waves.begin(), waves.end() ) + 1;
+         dlog( "block ${n}: ${t} transactions (${r} receipts) in ${w} conflict-free waves",
+               ("n", pbhs.block_num)("t", waves.size())("r", bb._pending_trx_receipts.size())("w", num_waves) );
+      }
+
       block_ptr->transactions = std::move( bb._pending_trx_receipts );
 
       auto id = block_ptr->id();
@@ -1595,7 +1633,7 @@ struct controller_impl {
          if( !replay_head_time && read_mode != db_read_mode::IRREVERSIBLE ) {
             reversible_blocks.create<reversible_block_object>( [&]( auto& ubo ) {
                ubo.blocknum = bsp->block_num;
-               ubo.set_block( bsp->block );
+               ubo.set_packed_block( *bsp->packed_block() );
             });
          }
 
@@ -1686,18 +1724,12 @@ struct controller_impl {
          auto producer_block_id = b->id();
          start_block( b->timestamp, b->confirmed, new_protocol_feature_activations, s, producer_block_id);
 
-         std::vector<transaction_metadata_ptr> packed_transactions;
-         packed_transactions.reserve( b->transactions.size() );
-         for( const auto& receipt : b->transactions ) {
-            if( receipt.trx.contains<packed_transaction>()) {
-               auto& pt = receipt.trx.get<packed_transaction>();
-               auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( pt ) );
-               if( !self.skip_auth_check() ) {
-                  transaction_metadata::start_recover_keys( mtrx, thread_pool.get_executor(), chain_id, microseconds::maximum() );
-               }
-               packed_transactions.emplace_back( std::move( mtrx ) );
-            }
-         }
+         const size_t num_packed = std::count_if( b->transactions.begin(), b->transactions.end(),
+                                                  []( const auto& receipt ) { return receipt.trx.template contains<packed_transaction>(); } );
+
+         // a received block already carries its transaction metadata, with key recovery started in create_block_state_future
+         const std::vector<transaction_metadata_ptr> packed_transactions =
+               bsp->trxs.size() == num_packed ? bsp->trxs : make_trx_metas( *b );
 
          transaction_trace_ptr trace;
 
@@ -1764,6 +1796,20 @@ struct controller_impl {
       }
    } FC_CAPTURE_AND_RETHROW() } /// apply_block
 
+   /// start compiling the code of any setcode in trx, so it is likely ready by the time the block is applied
+   void precompile_deployed_code( const transaction& trx, uint32_t block_num ) {
+      for( const auto& act : trx.actions ) {
+         if( act.account != config::system_account_name || act.name != setcode::get_name() ) continue;
+         try {
+            auto sc = act.data_as<setcode>();
+            if( sc.code.empty() ) continue;
+            wasmif.precompile( fc::sha256::hash( sc.code.data(), (uint32_t)sc.code.size() ), sc.vmtype, sc.vmversion, sc.code, block_num );
+         } catch( const fc::exception& ) {
+            // malformed actions are rejected when the block is applied
+         }
+      }
+   }
+
    std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b ) {
       EOS_ASSERT( b, block_validate_exception, "null block" );
 
@@ -1777,9 +1823,43 @@ struct controller_impl {
       EOS_ASSERT( prev, unlinkable_block_exception,
                   "unlinkable block ${id}", ("id", id)("previous", b->previous) );
 
-      return async_thread_pool( thread_pool.get_executor(), [b, prev, control=this]() {
+      return create_block_state_future( b, prev );
+   }
+
+   /// the metadata of the packed transactions of b in block order, with key recovery started unless auth checks are skipped
+   vector<transaction_metadata_ptr> make_trx_metas( const signed_block& b ) {
+      vector<transaction_metadata_ptr> trx_metas;
+      trx_metas.reserve( b.transactions.size() );
+      for( const auto& receipt : b.transactions ) {
+         if( receipt.trx.contains<packed_transaction>() ) {
+            const auto& pt = receipt.trx.get<packed_transaction>();
+            auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( pt ) );
+            if( !self.skip_auth_check() ) {
+               transaction_metadata::start_recover_keys( mtrx, thread_pool.get_executor(), chain_id, microseconds::maximum() );
+            }
+            trx_metas.emplace_back( std::move( mtrx ) );
+         }
+      }
+      return trx_metas;
+   }
+
+   /// the validation of b on top of prev, to be run on the thread pool; the keys of its transactions are recovered meanwhile
+   std::function<block_state_ptr()> make_block_state_task( const signed_block_ptr& b, const block_header_state_ptr& prev ) {
+      EOS_ASSERT( b, block_validate_exception, "null block" );
+      EOS_ASSERT( prev && prev->id == b->previous, unlinkable_block_exception,
+                  "unlinkable block ${id}", ("id", b->id())("previous", b->previous) );
+
+      // start recovering the keys of every transaction now so they are ready by the time apply_block reaches them
+      vector<transaction_metadata_ptr> trx_metas = make_trx_metas( *b );
+      if( conf.wasm_background_compile ) {
+         for( const auto& mtrx : trx_metas ) {
+            precompile_deployed_code( mtrx->packed_trx->get_transaction(), b->block_num() );
+         }
+      }
+
+      return [b, prev, trx_metas{std::move( trx_metas )}, control=this]() mutable {
          const bool skip_validate_signee = false;
-         return std::make_shared<block_state>(
+         auto bsp = std::make_shared<block_state>(
                         *prev,
                         move( b ),
                         [control]( block_timestamp_type timestamp,
@@ -1788,6 +1868,26 @@ struct controller_impl {
                         { control->check_protocol_features( timestamp, cur_features, new_features ); },
                         skip_validate_signee
          );
+         bsp->trxs = std::move( trx_metas );
+         return bsp;
+      };
+   }
+
+   std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b, const block_header_state_ptr& prev ) {
+      return async_thread_pool( thread_pool.get_executor(), make_block_state_task( b, prev ) );
+   }
+
+   void create_block_state_async( const signed_block_ptr& b, const block_header_state_ptr& prev,
+                                  controller::block_state_callback done ) {
+      boost::asio::post( thread_pool.get_executor(), [task = make_block_state_task( b, prev ), done{std::move( done )}]() mutable {
+         block_state_ptr bsp;
+         std::exception_ptr error;
+         try {
+            bsp = task();
+         } catch( ... ) {
+            error = std::current_exception();
+         }
+         done( bsp, error );
       } );
    }
 
@@ -2472,6 +2572,14 @@ std::future<block_state_ptr> controller::create_block_state_future( const signed
    return my->create_block_state_future( b );
 }
 
+std::future<block_state_ptr> controller::create_block_state_future( const signed_block_ptr& b, const block_header_state_ptr& prev ) {
+   return my->create_block_state_future( b, prev );
+}
+
+void controller::create_block_state_async( const signed_block_ptr& b, const block_header_state_ptr& prev, block_state_callback done ) {
+   my->create_block_state_async( b, prev, std::move( done ) );
+}
+
 void controller::push_block( std::future<block_state_ptr>& block_state_future ) {
    validate_db_available_size();
    validate_reversible_available_size();
@@ -3056,6 +3164,13 @@ void controller_impl::on_activation<builtin_protocol_feature_t::get_sender>() {
    } );
 }
 
+template<>
+void controller_impl::on_activation<builtin_protocol_feature_t::batch_db_reads>() {
+   db.modify( db.get<protocol_state_object>(), [&]( auto& ps ) {
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "db_get_rows_i64" );
+   } );
+}
+
 template<>
 void controller_impl::on_activation<builtin_protocol_feature_t::replace_deferred>() {
    const auto& indx = db.get_index<account_ram_correction_index, by_id>();
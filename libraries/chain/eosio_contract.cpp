@@ -183,6 +183,7 @@ void apply_eosio_setcode(apply_context& context) {
             o.vm_type = act.vmtype;
             o.vm_version = act.vmversion;
          });
+         context.control.get_wasm_interface().precompile(code_hash, act.vmtype, act.vmversion, act.code, context.control.head_block_num() + 1);
       }
    }
 
@@ -6,6 +6,9 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction.hpp>
 #include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/iterator_cache_arena.hpp>
+#include <eosio/chain/native_contracts.hpp>
+#include <eosio/chain/transaction_access_set.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
@@ -23,47 +26,53 @@ class apply_context {
       template<typename T>
       class iterator_cache {
          public:
-            iterator_cache(){
-               _end_iterator_to_table.reserve(8);
-               _iterator_to_object.reserve(32);
+            /// Takes its storage from the arena of the transaction and returns it, cleared, on destruction.
+            explicit iterator_cache( iterator_cache_arena& arena )
+            :_arena(arena)
+            ,_storage(arena.acquire())
+            {}
+
+            ~iterator_cache() {
+               _arena.release( _storage );
             }
 
+            iterator_cache( const iterator_cache& ) = delete;
+            iterator_cache& operator=( const iterator_cache& ) = delete;
+
             /// Returns end iterator of the table.
             int cache_table( const table_id_object& tobj ) {
-               auto itr = _table_cache.find(tobj.id);
-               if( itr != _table_cache.end() )
-                  return itr->second.second;
+               const int cached = _storage.table_to_end_iterator.find( table_key(tobj.id) );
+               if( cached != flat_iterator_map::npos )
+                  return cached;
 
-               auto ei = index_to_end_iterator(_end_iterator_to_table.size());
-               _end_iterator_to_table.push_back( &tobj );
-               _table_cache.emplace( tobj.id, make_pair(&tobj, ei) );
+               auto ei = index_to_end_iterator(_storage.end_iterator_to_table.size());
+               _storage.end_iterator_to_table.push_back( &tobj );
+               _storage.table_to_end_iterator.insert( table_key(tobj.id), ei );
                return ei;
             }
 
             const table_id_object& get_table( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return *itr->second.first;
+               return *static_cast<const table_id_object*>( _storage.end_iterator_to_table[end_iterator_to_index( get_end_iterator_by_table_id(i) )] );
             }
 
             int get_end_iterator_by_table_id( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return itr->second.second;
+               const int ei = _storage.table_to_end_iterator.find( table_key(i) );
+               EOS_ASSERT( ei != flat_iterator_map::npos, table_not_in_cache, "an invariant was broken, table should be in cache" );
+               return ei;
             }
 
             const table_id_object* find_table_by_end_iterator( int ei )const {
                EOS_ASSERT( ei < -1, invalid_table_iterator, "not an end iterator" );
                auto indx = end_iterator_to_index(ei);
-               if( indx >= _end_iterator_to_table.size() ) return nullptr;
-               return _end_iterator_to_table[indx];
+               if( indx >= _storage.end_iterator_to_table.size() ) return nullptr;
+               return static_cast<const table_id_object*>( _storage.end_iterator_to_table[indx] );
             }
 
             const T& get( int iterator ) {
                EOS_ASSERT( iterator != -1, invalid_table_iterator, "invalid iterator" );
                EOS_ASSERT( iterator >= 0, table_operation_not_permitted, "dereference of end iterator" );
-               EOS_ASSERT( (size_t)iterator < _iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
-               auto result = _iterator_to_object[iterator];
+               EOS_ASSERT( (size_t)iterator < _storage.iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
+               auto result = static_cast<const T*>( _storage.iterator_to_object[iterator] );
                EOS_ASSERT( result, table_operation_not_permitted, "dereference of deleted object" );
                return *result;
             }
@@ -71,35 +80,71 @@ class apply_context {
             void remove( int iterator ) {
                EOS_ASSERT( iterator != -1, invalid_table_iterator, "invalid iterator" );
                EOS_ASSERT( iterator >= 0, table_operation_not_permitted, "cannot call remove on end iterators" );
-               EOS_ASSERT( (size_t)iterator < _iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
+               EOS_ASSERT( (size_t)iterator < _storage.iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
 
-               auto obj_ptr = _iterator_to_object[iterator];
+               auto obj_ptr = _storage.iterator_to_object[iterator];
                if( !obj_ptr ) return;
-               _iterator_to_object[iterator] = nullptr;
-               _object_to_iterator.erase( obj_ptr );
+               _storage.iterator_to_object[iterator] = nullptr;
+               _storage.object_to_iterator.erase( object_key(obj_ptr) );
             }
 
             int add( const T& obj ) {
-               auto itr = _object_to_iterator.find( &obj );
-               if( itr != _object_to_iterator.end() )
-                    return itr->second;
+               const int cached = _storage.object_to_iterator.find( object_key(&obj) );
+               if( cached != flat_iterator_map::npos )
+                  return cached;
+
+               const int iterator = _storage.iterator_to_object.size();
+               _storage.iterator_to_object.push_back( &obj );
+               _storage.object_to_iterator.insert( object_key(&obj), iterator );
+
+               return iterator;
+            }
 
-               _iterator_to_object.push_back( &obj );
-               _object_to_iterator[&obj] = _iterator_to_object.size() - 1;
+            /// Exchanges the cached iterators with those in s.
+            void swap_storage( iterator_cache_storage& s ) { std::swap( _storage, s ); }
 
-               return _iterator_to_object.size() - 1;
+            void get_ids( iterator_cache_ids& ids )const {
+               ids.tables.clear();
+               ids.objects.clear();
+               for( auto t : _storage.end_iterator_to_table )
+                  ids.tables.push_back( static_cast<const table_id_object*>(t)->id._id );
+               for( auto o : _storage.iterator_to_object )
+                  ids.objects.push_back( o ? static_cast<const T*>(o)->id._id : -1 );
+            }
+
+            /**
+             * Points the cached iterators at the tables and objects with the ids taken by get_ids() again. Undoing the
+             * removal of a table or object recreates it at another address, so iterators cached before an undo session
+             * must be rebound once it is undone. The iterator numbers do not change.
+             */
+            void rebind( const chainbase::database& db, const iterator_cache_ids& ids ) {
+               EOS_ASSERT( ids.tables.size() == _storage.end_iterator_to_table.size() &&
+                           ids.objects.size() == _storage.iterator_to_object.size(),
+                           transaction_exception, "iterator cache changed since its ids were taken" );
+               for( size_t i = 0; i < ids.tables.size(); ++i ) {
+                  auto tobj = db.find<table_id_object>( table_id_object::id_type(ids.tables[i]) );
+                  EOS_ASSERT( tobj, table_not_in_cache, "cached table no longer exists" );
+                  _storage.end_iterator_to_table[i] = tobj;
+               }
+               _storage.object_to_iterator.clear();
+               for( size_t i = 0; i < ids.objects.size(); ++i ) {
+                  const T* obj = ids.objects[i] < 0 ? nullptr : db.find<T>( typename T::id_type(ids.objects[i]) );
+                  _storage.iterator_to_object[i] = obj;
+                  if( obj ) _storage.object_to_iterator.insert( object_key(obj), i );
+               }
             }
 
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
-            vector<const table_id_object*>                  _end_iterator_to_table;
-            vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            iterator_cache_arena&    _arena;
+            iterator_cache_storage&  _storage;
+
+            static uint64_t table_key( table_id_object::id_type i ) { return static_cast<uint64_t>(i._id); }
+            static uint64_t object_key( const void* p ) { return reinterpret_cast<uintptr_t>(p); }
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
             inline size_t end_iterator_to_index( int ei )const { return (-ei - 2); }
-            /// Precondition: indx < _end_iterator_to_table.size() <= std::numeric_limits<int>::max()
+            /// Precondition: indx < end_iterator_to_table.size() <= std::numeric_limits<int>::max()
             inline int index_to_end_iterator( size_t indx )const { return -(indx + 2); }
       }; /// class iterator_cache
 
@@ -175,15 +220,13 @@ class apply_context {
 
             using secondary_key_helper_t = secondary_key_helper<secondary_key_type, secondary_key_proxy_type, secondary_key_proxy_const_type>;
 
-            generic_index( apply_context& c ):context(c){}
+            generic_index( apply_context& c, iterator_cache_arena& arena ):context(c),itr_cache(arena){}
 
             int store( uint64_t scope, uint64_t table, const account_name& payer,
                        uint64_t id, secondary_key_proxy_const_type value )
             {
                EOS_ASSERT( payer != account_name(), invalid_table_payer, "must specify a valid account to pay for new record" );
 
-//               context.require_write_lock( scope );
-
                const auto& tab = context.find_or_create_table( context.receiver, scope, table, payer );
 
                const auto& obj = context.db.create<ObjectType>( [&]( auto& o ){
@@ -210,7 +253,7 @@ class apply_context {
                const auto& table_obj = itr_cache.get_table( obj.t_id );
                EOS_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
 
-//               context.require_write_lock( table_obj.scope );
+               context.record_table_write( table_obj );
 
                context.db.modify( table_obj, [&]( auto& t ) {
                   --t.count;
@@ -230,7 +273,7 @@ class apply_context {
                const auto& table_obj = itr_cache.get_table( obj.t_id );
                EOS_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
 
-//               context.require_write_lock( table_obj.scope );
+               context.record_table_write( table_obj );
 
                if( payer == account_name() ) payer = obj.payer;
 
@@ -438,6 +481,9 @@ class apply_context {
                return itr_cache.add(*itr);
             }
 
+            iterator_cache<ObjectType>& cache() { return itr_cache; }
+            const iterator_cache<ObjectType>& cache()const { return itr_cache; }
+
             void get( int iterator, uint64_t& primary, secondary_key_proxy_type secondary ) {
                const auto& obj = itr_cache.get( iterator );
                primary   = obj.primary_key;
@@ -518,6 +564,7 @@ class apply_context {
       void db_update_i64( int iterator, account_name payer, const char* buffer, size_t buffer_size );
       void db_remove_i64( int iterator );
       int  db_get_i64( int iterator, char* buffer, size_t buffer_size );
+      int  db_get_rows_i64( int iterator, char* buffer, size_t buffer_size, uint32_t max_rows, int& next );
       int  db_next_i64( int iterator, uint64_t& primary );
       int  db_previous_i64( int iterator, uint64_t& primary );
       int  db_find_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t id );
@@ -531,8 +578,16 @@ class apply_context {
       const table_id_object& find_or_create_table( name code, name scope, name table, const account_name &payer );
       void                   remove_table( const table_id_object& tid );
 
+      /// record state access in the transaction's access set, if it is being tracked
+      void record_action_reads();
+      void record_table_write( const table_id_object& tid );
+      void record_account_write( account_name account );
+      void record_global_write();
+
       int  db_store_i64( uint64_t code, uint64_t scope, uint64_t table, const account_name& payer, uint64_t id, const char* buffer, size_t buffer_size );
 
+      void record_table_delta( const table_id_object& tid, const key_value_object& obj, bool removed );
+
 
    /// Misc methods:
    public:
@@ -556,6 +611,44 @@ class apply_context {
 
       action_name get_sender() const;
 
+   /// Native contracts:
+   public:
+
+      /// the state of the context that a trial run of a native contract has to leave as it found it
+      struct checkpoint {
+         std::array<iterator_cache_ids, 6>   iterator_caches; ///< keyval_cache, then the secondary indices
+         size_t                              notified = 0;
+         flat_set<account_delta>             account_ram_deltas;
+         flat_set<account_name>              validate_ram_usage;
+         optional<transaction_access_set>    access_set;
+      };
+
+      checkpoint make_checkpoint()const;
+      /// must be called after undoing the changes made since make_checkpoint(), it rebinds the iterator caches
+      void restore_checkpoint( checkpoint&& cp );
+
+      /**
+       * Swaps the primary and secondary index iterator caches for empty ones while in scope, so that a trial run
+       * neither sees nor leaves behind iterators of the contract. The caches of the trial are dropped on destruction.
+       */
+      class isolated_iterator_caches {
+         public:
+            explicit isolated_iterator_caches( apply_context& context );
+            ~isolated_iterator_caches();
+
+            isolated_iterator_caches( const isolated_iterator_caches& ) = delete;
+            isolated_iterator_caches& operator=( const isolated_iterator_caches& ) = delete;
+
+         private:
+            void swap_all();
+
+            apply_context&                          _context;
+            std::array<iterator_cache_storage, 6>   _saved;
+      };
+
+      const vector< std::pair<account_name, uint32_t> >& get_notified()const { return _notified; }
+      const flat_set<account_delta>& get_account_ram_deltas()const { return _account_ram_deltas; }
+
    /// Fields:
    public:
 
@@ -574,6 +667,9 @@ class apply_context {
       bool                          context_free = false;
 
    public:
+      /// when set, the changes made to rows of primary indices are appended to it
+      optional<vector<table_delta>> recorded_table_deltas;
+
       generic_index<index64_object>                                  idx64;
       generic_index<index128_object>                                 idx128;
       generic_index<index256_object, uint128_t*, const uint128_t*>   idx256;
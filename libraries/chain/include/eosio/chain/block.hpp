@@ -68,6 +68,7 @@ namespace eosio { namespace chain {
       extensions_type               block_extensions;
    };
    using signed_block_ptr = std::shared_ptr<signed_block>;
+   using packed_block_ptr = std::shared_ptr<const bytes>; ///< fc::raw::pack of a signed_block
 
    struct producer_confirmation {
       block_id_type   block_id;
@@ -11,6 +11,14 @@ namespace eosio { namespace chain {
 
    namespace detail { class block_log_impl; }
 
+   struct block_log_config {
+      uint32_t  stride = 0;                ///< split blocks.log into a segment after every multiple of stride, 0 to disable
+      uint32_t  max_retained_segments = 0; ///< oldest segments beyond this count are retired, 0 to keep all
+      fc::path  archive_dir;               ///< retired segments are moved here, or deleted if empty
+      bool      compress_blocks = false;   ///< store blocks in newly created log files as zlib frames
+      uint32_t  write_interval_ms = 0;     ///< write appended blocks from a background thread in batches at this interval, 0 to write in append
+   };
+
    /* The block log is an external append only log of the blocks with a header. Blocks should only
     * be written to the log after they irreverisble as the log is append only. The log is a doubly
     * linked list of blocks. There is a secondary index file of only block positions that enables
@@ -34,15 +42,34 @@ namespace eosio { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * With a non-zero stride the log is split: once a block whose number is a multiple of stride is appended,
+    * blocks.log and blocks.index are renamed to blocks-<first>-<last>.log and blocks-<first>-<last>.index and a new
+    * blocks.log is started. Each segment is a complete block log file on its own. Reads are routed to the segment
+    * holding the requested block, and old segments can be archived or deleted without touching blocks.log.
+    *
+    * A version 3 log may be compressed, in which case each block is stored as an independent zlib frame in
+    * place of the packed block. Positions in the trailers and index refer to the start of the frame, so random
+    * access only ever decompresses the single block that was asked for.
+    *
+    * Reads go through a read-only memory mapping of both files and may be issued from any thread concurrently
+    * with each other and with append. Appending, resetting and reopening the log must be done by a single writer.
+    *
+    * With a non-zero write_interval_ms, append only queues the block for a dedicated writer thread which writes
+    * and flushes the queue in batches. Queued blocks are served to readers from memory. flush() waits for the
+    * queue to be written, and blocks still queued when the process dies are lost.
     */
 
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         block_log(const fc::path& data_dir, const block_log_config& config = block_log_config());
          block_log(block_log&& other);
          ~block_log();
 
+         /// returns the position of the block in blocks.log, or npos if it was queued for the writer thread
          uint64_t append(const signed_block_ptr& b);
+         /// append using an already packed form of b, such as block_state::packed_block()
+         uint64_t append(const signed_block_ptr& b, const packed_block_ptr& packed_block);
          void flush();
          void reset( const genesis_state& gs, const signed_block_ptr& genesis_block, uint32_t first_block_num = 1 );
 
@@ -53,12 +80,13 @@ namespace eosio { namespace chain {
          }
 
          /**
-          * Return offset of block in file, or block_log::npos if it does not exist.
+          * Return offset of block in the file holding it (blocks.log or its segment), or block_log::npos if it does not exist.
+          * Waits for the writer thread to write out its queue if the block is still in it.
           */
          uint64_t get_block_pos(uint32_t block_num) const;
          signed_block_ptr        read_head()const;
          const signed_block_ptr& head()const;
-         uint32_t                first_block_num() const;
+         uint32_t                first_block_num() const; ///< first block available, including segments
 
          static const uint64_t npos = std::numeric_limits<uint64_t>::max();
 
@@ -69,7 +97,10 @@ namespace eosio { namespace chain {
 
          static genesis_state extract_genesis_state( const fc::path& data_dir );
 
-         //yangfenglin added 20181026  
+         /**
+          * Bring blocks_backup.log (two levels above data_dir) up to date with blocks.log. If the backup is a prefix of
+          * the log ending on a verified block boundary only the missing tail is copied, otherwise it is recreated.
+          */
          static void backup_log( const fc::path& data_dir);
 
       private:
@@ -42,6 +42,11 @@ namespace eosio { namespace chain {
 
       bool is_valid()const { return validated; }
 
+      /**
+       * The packed form of block, serialized on first use and then shared by every consumer (block log, reversible
+       * blocks database, peers). block must not be modified once this has been called. Safe to call from any thread.
+       */
+      packed_block_ptr packed_block()const;
 
       signed_block_ptr                                    block;
       bool                                                validated = false;
@@ -49,6 +54,9 @@ namespace eosio { namespace chain {
       /// this data is redundant with the data stored in block, but facilitates
       /// recapturing transactions when we pop a block
       vector<transaction_metadata_ptr>                    trxs;
+
+   private:
+      mutable packed_block_ptr                            _packed_block;
    };
 
    using block_state_ptr = std::shared_ptr<block_state>;
@@ -1,5 +1,6 @@
 #pragma once
 #include <eosio/chain/block_state.hpp>
+#include <eosio/chain/block_log.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/genesis_state.hpp>
 #include <eosio/chain/genesis_state_origin.hpp>
@@ -65,6 +66,7 @@ namespace eosio { namespace chain {
             flat_set< pair<account_name, action_name> > action_blacklist;
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
+            block_log_config         blog;
             path                     state_dir              =  chain::config::default_state_dir_name;
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
@@ -78,10 +80,17 @@ namespace eosio { namespace chain {
             bool                     contracts_console      =  false;
             bool                     allow_ram_billing_in_notify = false;
             bool                     disable_all_subjective_mitigations = false; //< for testing purposes only
+            bool                     track_transaction_access_sets = false; //< measure, at debug level, how many conflict-free waves each block's transactions would need; execution stays serial
 
             genesis_state            genesis;
             genesis_state_origin     genesis_origin;
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
+            path                     wasm_code_cache_dir; //< compiled contract code is cached here across restarts; empty to disable
+            string                   wasm_code_cache_build_id; //< kept apart from code cached under another id, on top of the hash of the running binary
+            bool                     wasm_background_compile = false; //< compile newly deployed contracts on a separate thread
+            bool                     wasm_inline_checktime = false; //< contracts check the deadline timer inline instead of calling checktime
+            flat_map<digest_type, string> native_contracts; //< code hash to the name of the native implementation that replaces it
+            wasm_interface::native_contract_mode native_contract_mode = wasm_interface::native_contract_mode::enabled;
 
             db_read_mode             read_mode              = db_read_mode::SPECULATIVE;
             validation_mode          block_validation_mode  = validation_mode::FULL;
@@ -160,6 +169,18 @@ namespace eosio { namespace chain {
          void pop_block();
 
          std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b );
+         /**
+          * Validates the header and signature of b on top of prev, which does not have to be in the fork database: a
+          * syncing node uses it to validate blocks ahead of the one being applied. The result can be pushed once prev is.
+          */
+         std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b, const block_header_state_ptr& prev );
+
+         using block_state_callback = std::function<void( const block_state_ptr&, const std::exception_ptr& )>;
+         /**
+          * Like create_block_state_future( b, prev ), but instead of returning a future it calls done, on the thread
+          * pool, with the block state or with the exception the validation threw. Throws if b cannot be validated at all.
+          */
+         void create_block_state_async( const signed_block_ptr& b, const block_header_state_ptr& prev, block_state_callback done );
          void push_block( std::future<block_state_ptr>& block_state_future );
 
          boost::asio::io_context& get_thread_pool();
@@ -0,0 +1,166 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Open addressing map from a 64-bit key (a table id or an object address) to an iterator, used by the iterator
+    * caches of apply_context. Slots are stamped with a generation so that clear() is O(1) and keeps the storage,
+    * which lets a transaction reuse the same slots for all of its actions.
+    */
+   class flat_iterator_map {
+      public:
+         static constexpr int npos = -1; ///< never a valid iterator, so it doubles as "not found"
+
+         int find( uint64_t key )const {
+            if( _slots.empty() ) return npos;
+            for( size_t i = home( key );; i = (i + 1) & _mask ) {
+               const slot& s = _slots[i];
+               if( s.gen != _gen ) return npos;
+               if( s.key == key ) return s.value;
+            }
+         }
+
+         /// Precondition: key is not in the map
+         void insert( uint64_t key, int value ) {
+            if( (_size + 1) * 2 > _slots.size() )
+               grow();
+            size_t i = home( key );
+            while( _slots[i].gen == _gen )
+               i = (i + 1) & _mask;
+            _slots[i] = slot{ key, value, _gen };
+            ++_size;
+         }
+
+         void erase( uint64_t key ) {
+            if( _slots.empty() ) return;
+            size_t i = home( key );
+            for( ;; i = (i + 1) & _mask ) {
+               if( _slots[i].gen != _gen ) return;
+               if( _slots[i].key == key ) break;
+            }
+            // backward shift the rest of the probe sequence so that lookups never need tombstones
+            for( size_t j = i;; ) {
+               j = (j + 1) & _mask;
+               if( _slots[j].gen != _gen ) break;
+               const size_t k = home( _slots[j].key );
+               const bool in_place = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+               if( in_place ) continue;
+               _slots[i] = _slots[j];
+               i = j;
+            }
+            _slots[i].gen = 0;
+            --_size;
+         }
+
+         void clear() {
+            _size = 0;
+            if( ++_gen == 0 ) {
+               for( auto& s : _slots ) s.gen = 0;
+               _gen = 1;
+            }
+         }
+
+         size_t size()const { return _size; }
+
+      private:
+         struct slot {
+            uint64_t key   = 0;
+            int      value = npos;
+            uint32_t gen   = 0; ///< the slot is in use when it matches _gen, 0 is never current
+         };
+
+         size_t home( uint64_t key )const {
+            return size_t( (key * 0x9E3779B97F4A7C15ULL) >> _shift );
+         }
+
+         void grow() {
+            std::vector<slot> old;
+            old.swap( _slots );
+            const size_t capacity = old.empty() ? 16 : old.size() * 2;
+            _slots.resize( capacity );
+            _mask = capacity - 1;
+            _shift = 64 - __builtin_ctzll( capacity );
+            const uint32_t old_gen = _gen;
+            _gen = 1;
+            _size = 0;
+            for( const auto& s : old ) {
+               if( s.gen == old_gen )
+                  insert( s.key, s.value );
+            }
+         }
+
+         std::vector<slot> _slots;
+         size_t            _mask  = 0;
+         unsigned          _shift = 64;
+         size_t            _size  = 0;
+         uint32_t          _gen   = 1;
+   };
+
+   /**
+    * Type erased storage behind an apply_context::iterator_cache.
+    */
+   struct iterator_cache_storage {
+      flat_iterator_map          table_to_end_iterator;
+      std::vector<const void*>   end_iterator_to_table;
+      std::vector<const void*>   iterator_to_object;
+      flat_iterator_map          object_to_iterator;
+
+      void clear() {
+         table_to_end_iterator.clear();
+         end_iterator_to_table.clear();
+         iterator_to_object.clear();
+         object_to_iterator.clear();
+      }
+   };
+
+   /**
+    * The ids of the tables and objects an iterator_cache_storage points to, in iterator order, to point it at them again
+    * once an undo session has moved them in memory. -1 stands for an iterator to a deleted object.
+    */
+   struct iterator_cache_ids {
+      std::vector<int64_t>   tables;
+      std::vector<int64_t>   objects;
+   };
+
+   /**
+    * Pool of iterator cache storage owned by a transaction_context. Every action of the transaction takes storage
+    * for its primary and secondary index caches when its apply_context is created and hands it back, cleared but
+    * still allocated, when the apply_context goes away. Nested actions are alive at the same time as their parents,
+    * so the pool grows to the deepest nesting seen and then stops allocating.
+    */
+   class iterator_cache_arena {
+      public:
+         iterator_cache_storage& acquire() {
+            if( _free.empty() ) {
+               _storage.emplace_back();
+               _storage.back().end_iterator_to_table.reserve( 8 );
+               _storage.back().iterator_to_object.reserve( 32 );
+               return _storage.back();
+            }
+            auto s = _free.back();
+            _free.pop_back();
+            return *s;
+         }
+
+         void release( iterator_cache_storage& s ) {
+            s.clear();
+            _free.push_back( &s );
+         }
+
+         size_t allocated()const { return _storage.size(); }
+
+      private:
+         std::deque<iterator_cache_storage>     _storage; ///< deque so that handed out references stay valid
+         std::vector<iterator_cache_storage*>   _free;
+   };
+
+} } // namespace eosio::chain
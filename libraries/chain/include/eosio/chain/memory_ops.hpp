@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace eosio { namespace chain { namespace memory_ops {
+
+   /**
+    * Kernels behind the memcpy, memmove, memset and memcmp intrinsics. The ranges are validated by the caller.
+    *
+    * Contracts mostly move a few bytes at a time while (de)serializing table rows, so short ranges are handled inline
+    * with a couple of overlapping loads and stores instead of a call into libc. Longer ranges go to AVX2 or SSE2
+    * kernels, chosen at runtime from the features of the cpu, or to libc on other architectures.
+    */
+
+   /// ranges up to this many bytes are handled inline
+   constexpr size_t small_size = 16;
+
+   namespace detail {
+      void move_large( char* dest, const char* src, size_t length );
+      void set_large( char* dest, char value, size_t length );
+      int  compare_large( const char* a, const char* b, size_t length );
+
+      /// all of src is loaded before dest is written, so the ranges may overlap
+      inline void move_small( char* dest, const char* src, size_t length ) {
+         if( length >= 8 ) {
+            uint64_t head, tail;
+            ::memcpy( &head, src, 8 );
+            ::memcpy( &tail, src + length - 8, 8 );
+            ::memcpy( dest, &head, 8 );
+            ::memcpy( dest + length - 8, &tail, 8 );
+         } else if( length >= 4 ) {
+            uint32_t head, tail;
+            ::memcpy( &head, src, 4 );
+            ::memcpy( &tail, src + length - 4, 4 );
+            ::memcpy( dest, &head, 4 );
+            ::memcpy( dest + length - 4, &tail, 4 );
+         } else if( length > 0 ) {
+            const char first = src[0], middle = src[length / 2], last = src[length - 1];
+            dest[0] = first;
+            dest[length / 2] = middle;
+            dest[length - 1] = last;
+         }
+      }
+   }
+
+   /// dest and src must not overlap
+   inline void copy( char* dest, const char* src, size_t length ) {
+      if( length <= small_size )
+         detail::move_small( dest, src, length );
+      else
+         detail::move_large( dest, src, length );
+   }
+
+   inline void move( char* dest, const char* src, size_t length ) {
+      if( length <= small_size )
+         detail::move_small( dest, src, length );
+      else
+         detail::move_large( dest, src, length );
+   }
+
+   inline void set( char* dest, char value, size_t length ) {
+      if( length > small_size ) {
+         detail::set_large( dest, value, length );
+      } else if( length >= 8 ) {
+         const uint64_t v = uint64_t(0x0101010101010101ULL) * uint8_t(value);
+         ::memcpy( dest, &v, 8 );
+         ::memcpy( dest + length - 8, &v, 8 );
+      } else if( length >= 4 ) {
+         const uint32_t v = uint32_t(0x01010101U) * uint8_t(value);
+         ::memcpy( dest, &v, 4 );
+         ::memcpy( dest + length - 4, &v, 4 );
+      } else if( length > 0 ) {
+         dest[0] = value;
+         dest[length / 2] = value;
+         dest[length - 1] = value;
+      }
+   }
+
+   /// returns -1, 0 or 1 as the first differing byte, compared unsigned, is lower in a, absent or higher in a
+   inline int compare( const char* a, const char* b, size_t length ) {
+      if( length > small_size )
+         return detail::compare_large( a, b, length );
+      for( size_t i = 0; i < length; ++i ) {
+         if( a[i] != b[i] )
+            return uint8_t(a[i]) < uint8_t(b[i]) ? -1 : 1;
+      }
+      return 0;
+   }
+
+   /// the name of the kernels used for long ranges on this cpu
+   const char* large_kernels();
+
+   /// use the SSE2 kernels even on a cpu with AVX2, so that tests can check both; returns the previous setting
+   bool disable_avx2( bool disable );
+
+} } } /// eosio::chain::memory_ops
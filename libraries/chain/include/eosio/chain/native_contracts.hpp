@@ -0,0 +1,100 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/trace.hpp>
+
+#include <functional>
+#include <map>
+#include <tuple>
+
+namespace eosio { namespace chain {
+
+   class apply_context;
+
+   /**
+    * A change made by an action to a row of a primary index, with the row as it is afterwards
+    */
+   struct table_delta {
+      account_name   code;
+      scope_name     scope;
+      table_name     table;
+      uint64_t       primary_key = 0;
+      account_name   payer;
+      bytes          value;
+      bool           removed = false;
+
+      friend bool operator==( const table_delta& a, const table_delta& b ) {
+         return std::tie( a.code, a.scope, a.table, a.primary_key, a.payer, a.value, a.removed )
+             == std::tie( b.code, b.scope, b.table, b.primary_key, b.payer, b.value, b.removed );
+      }
+   };
+
+   /**
+    * What running an action on a receiver changed, as compared by the differential mode of native contracts
+    */
+   struct native_contract_effects {
+      vector<table_delta>              table_deltas;
+      std::map<account_name, int64_t>  ram_deltas;
+      vector<account_name>             recipients; ///< notified accounts, in order
+      bool                             failed = false;
+
+      friend bool operator==( const native_contract_effects& a, const native_contract_effects& b ) {
+         return std::tie( a.table_deltas, a.ram_deltas, a.recipients, a.failed )
+             == std::tie( b.table_deltas, b.ram_deltas, b.recipients, b.failed );
+      }
+      friend bool operator!=( const native_contract_effects& a, const native_contract_effects& b ) { return !(a == b); }
+   };
+
+   /**
+    * Passed to native contracts instead of the bare apply_context, so that a trial run can record the accounts the
+    * action is delivered to instead of scheduling the notifications
+    */
+   class native_contract_context {
+      public:
+         explicit native_contract_context( apply_context& c, vector<account_name>* recorded_recipients = nullptr )
+         :context(c)
+         ,_recorded_recipients(recorded_recipients)
+         {}
+
+         void require_recipient( account_name recipient );
+
+         apply_context& context;
+
+      private:
+         vector<account_name>* _recorded_recipients;
+   };
+
+   /**
+    * A host compiled implementation of a contract. Returns false, before doing anything, for the actions it does not
+    * implement; those run through the wasm of the contract. Otherwise it must make exactly the calls into apply_context
+    * that the wasm makes, in the same order, so that the state and the iterators seen by later receivers are the same.
+    */
+   using native_contract_apply = bool (*)( native_contract_context& );
+
+   namespace native_contracts {
+      /// the implementation registered under name, e.g. "eosio.token", or nullptr
+      native_contract_apply find( const string& name );
+
+      /// names of all implementations
+      vector<string> names();
+
+      using mismatch_handler = std::function<void( const native_contract_effects& native, const native_contract_effects& wasm )>;
+
+      /**
+       * Runs native on a trial basis in an undo session, then the wasm for real, and calls on_mismatch when they had
+       * different effects. Only the wasm counts: its exception, if any, is rethrown afterwards.
+       *
+       * A trial run must not remove rows or tables that may already be cached by the action, since restoring them
+       * moves them in the database.
+       */
+      void apply_differential( native_contract_apply native, apply_context& context, const std::function<void()>& apply_wasm,
+                               const mismatch_handler& on_mismatch );
+   }
+
+} } // namespace eosio::chain
+
+FC_REFLECT( eosio::chain::table_delta, (code)(scope)(table)(primary_key)(payer)(value)(removed) )
+FC_REFLECT( eosio::chain::native_contract_effects, (table_deltas)(ram_deltas)(recipients)(failed) )
@@ -26,6 +26,10 @@ namespace eosio { namespace chain {
          fc::raw::pack( ds, *b );
       }
 
+      void set_packed_block( const bytes& packed ) {
+         packedblock.assign( packed.data(), packed.size() );
+      }
+
       signed_block_ptr get_block()const {
          fc::datastream<const char*> ds( packedblock.data(), packedblock.size() );
          auto result = std::make_shared<signed_block>();
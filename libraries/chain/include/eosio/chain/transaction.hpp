@@ -210,6 +210,19 @@ namespace eosio { namespace chain {
 
    uint128_t transaction_id_to_sender_id( const transaction_id_type& tid );
 
+   /// counters of the process wide cache of keys recovered from transaction signatures
+   struct signature_recovery_cache_stats {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t size = 0;
+      uint64_t max_size = 0;
+   };
+
+   signature_recovery_cache_stats get_signature_recovery_cache_stats();
+
+   /// bound the number of recovered keys kept in the cache (default 10000), evicting least recently used entries
+   void set_signature_recovery_cache_size( size_t max_size );
+
 } } /// namespace eosio::chain
 
 FC_REFLECT(eosio::chain::deferred_transaction_generation_context, (sender_trx_id)(sender_id)(sender) )
@@ -220,3 +233,4 @@ FC_REFLECT_DERIVED( eosio::chain::signed_transaction, (eosio::chain::transaction
 FC_REFLECT_ENUM( eosio::chain::packed_transaction::compression_type, (none)(zlib))
 // @ignore unpacked_trx
 FC_REFLECT( eosio::chain::packed_transaction, (signatures)(compression)(packed_context_free_data)(packed_trx) )
+FC_REFLECT( eosio::chain::signature_recovery_cache_stats, (hits)(misses)(size)(max_size) )
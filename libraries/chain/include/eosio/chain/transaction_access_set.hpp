@@ -0,0 +1,70 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/action.hpp>
+
+#include <tuple>
+
+namespace eosio { namespace chain {
+
+   /**
+    * The state a transaction read and wrote while executing, at the granularity of contract tables (code, scope, table),
+    * account rows (existence, RAM/CPU/NET usage and action sequence numbers) and the permissions its actions carry.
+    *
+    * Anything not tracked at that granularity (native system actions, privileged contracts, deferred transactions)
+    * sets global_write, which conflicts with every other transaction. Permissions and permission links are only
+    * written by native system actions, so a permission read can only conflict with a global write. Counters that are only accumulated and could be
+    * assigned when a transaction commits, such as the global action sequence and the block resource totals, are not
+    * treated as conflicts.
+    *
+    * The sets are only recorded to measure how much parallelism blocks would allow, see conflict_free_waves();
+    * transactions are always executed serially.
+    */
+   struct transaction_access_set {
+      using table_key = std::tuple<account_name, scope_name, table_name>;
+
+      flat_set<table_key>     table_reads;
+      flat_set<table_key>     table_writes;
+      flat_set<account_name>  account_reads;
+      flat_set<account_name>  account_writes;
+      flat_set<permission_level> permission_reads;
+      bool                    global_write = false;
+
+      void read_table( account_name code, scope_name scope, table_name table ) {
+         table_reads.emplace( code, scope, table );
+      }
+
+      void write_table( account_name code, scope_name scope, table_name table ) {
+         table_writes.emplace( code, scope, table );
+      }
+
+      void read_account( account_name account ) {
+         account_reads.insert( account );
+      }
+
+      void read_permission( const permission_level& permission ) {
+         permission_reads.insert( permission );
+      }
+
+      void write_account( account_name account ) {
+         account_writes.insert( account );
+      }
+
+      /// true if executing the two transactions in a different order could change the result of either
+      bool conflicts_with( const transaction_access_set& other )const;
+   };
+
+   /**
+    * Assign each transaction, in order, to the wave after the latest wave of any earlier transaction it conflicts with.
+    * Transactions in the same wave do not conflict with each other, so the number of waves, the length of the longest
+    * chain of conflicts, bounds how many steps a parallel execution of the transactions would need. Nothing executes
+    * transactions by wave, this is a measurement.
+    *
+    * @return the zero based wave of each transaction
+    */
+   vector<uint32_t> conflict_free_waves( const vector<transaction_access_set>& sets );
+
+} } /// namespace eosio::chain
@@ -1,6 +1,8 @@
 #pragma once
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
+#include <eosio/chain/transaction_access_set.hpp>
+#include <eosio/chain/iterator_cache_arena.hpp>
 #include <signal.h>
 
 namespace eosio { namespace chain {
@@ -12,7 +14,11 @@ namespace eosio { namespace chain {
          void start(fc::time_point tp);
          void stop();
 
+         static void set_expired(sig_atomic_t e);
+
          static volatile sig_atomic_t expired;
+         //when set, mirrors expired for the wasm code running, which checks it inline before calling checktime
+         static volatile sig_atomic_t* volatile expired_flag;
       private:
          static void timer_expired(int);
          static bool initialized;
@@ -105,6 +111,12 @@ namespace eosio { namespace chain {
          flat_set<account_name>        bill_to_accounts;
          flat_set<account_name>        validate_ram_usage;
 
+         /// state read and written by the transaction, only recorded when the controller tracks access sets
+         optional<transaction_access_set> access_set;
+
+         /// storage of the table iterator caches, reused by every action of the transaction
+         iterator_cache_arena          itr_cache_arena;
+
          /// the maximum number of virtual CPU instructions of the transaction that can be safely billed to the billable accounts
          uint64_t                      initial_max_billable_cpu = 0;
 
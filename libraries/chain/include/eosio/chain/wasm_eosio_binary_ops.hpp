@@ -21,7 +21,12 @@
 #include "IR/Operators.h"
 #include "IR/Module.h"
 
-namespace eosio { namespace chain { namespace wasm_ops {
+namespace eosio { namespace chain {
+
+namespace wasm_injections { struct injection_context; }
+namespace wasm_validations { struct validation_context; }
+
+namespace wasm_ops {
 
 class instruction_stream {
    public:
@@ -528,6 +533,9 @@ struct visitor_arg {
    instruction_stream* new_code;
    IR::FunctionDef*    function_def;
    size_t              start_index;
+   // per-module state of the pass doing the visiting, so that modules can be processed concurrently
+   wasm_injections::injection_context*   injection = nullptr;
+   wasm_validations::validation_context* validation = nullptr;
 };
 
 struct instr {
@@ -22,12 +22,12 @@ namespace eosio { namespace chain { namespace wasm_injections {
    // helper functions for injection
 
    struct injector_utils {
-      static std::map<std::vector<uint16_t>, uint32_t> type_slots;
-      static std::map<std::string, uint32_t>           registered_injected;
-      static std::map<uint32_t, uint32_t>              injected_index_mapping;
-      static uint32_t                                  next_injected_index;
+      std::map<std::vector<uint16_t>, uint32_t> type_slots;
+      std::map<std::string, uint32_t>           registered_injected;
+      std::map<uint32_t, uint32_t>              injected_index_mapping;
+      uint32_t                                  next_injected_index = 0;
 
-      static void init( Module& mod ) { 
+      void init( Module& mod ) { 
          type_slots.clear(); 
          registered_injected.clear();
          injected_index_mapping.clear();
@@ -35,7 +35,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
          next_injected_index = 0;
       }
 
-      static void build_type_slots( Module& mod ) {
+      void build_type_slots( Module& mod ) {
          // add the module types to the type_slots map
          for ( size_t i=0; i < mod.types.size(); i++ ) {
             std::vector<uint16_t> type_slot_list = { static_cast<uint16_t>(mod.types[i]->ret) };
@@ -46,7 +46,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       }
 
       template <ResultType Result, ValueType... Params>
-      static void add_type_slot( Module& mod ) {
+      void add_type_slot( Module& mod ) {
          if ( type_slots.find({FromResultType<Result>::value, FromValueType<Params>::value...}) == type_slots.end() ) {
             type_slots.emplace( std::vector<uint16_t>{FromResultType<Result>::value, FromValueType<Params>::value...}, mod.types.size() );
             mod.types.push_back( FunctionType::get( Result, { Params... } ) );
@@ -54,13 +54,13 @@ namespace eosio { namespace chain { namespace wasm_injections {
       }
 
       // get the next available index that is greater than the last exported function
-      static void get_next_indices( Module& module, int& next_function_index, int& next_actual_index ) {
+      void get_next_indices( Module& module, int& next_function_index, int& next_actual_index ) {
          next_function_index = module.functions.imports.size() + module.functions.defs.size() + registered_injected.size();
          next_actual_index = next_injected_index++;
       }
 
       template <ResultType Result, ValueType... Params>
-      static void add_import(Module& module, const char* func_name, int32_t& index ) {
+      void add_import(Module& module, const char* func_name, int32_t& index ) {
          if (module.functions.imports.size() == 0 || registered_injected.find(func_name) == registered_injected.end() ) {
             add_type_slot<Result, Params...>( module );
             const uint32_t func_type_index = type_slots[{ FromResultType<Result>::value, FromValueType<Params>::value... }];
@@ -95,7 +95,58 @@ namespace eosio { namespace chain { namespace wasm_injections {
          }
       }
    };
-   
+
+   // state of an injection pass over one module; the injectors below reach it through visitor_arg::injection,
+   // so that any number of modules can be injected at the same time
+   struct injection_context {
+      injector_utils                       utils;
+
+      // instruction_counter
+      uint32_t                             icnt = 0; /* instructions so far */
+      uint32_t                             tcnt = 0; /* total instructions */
+      uint32_t                             bcnt = 0; /* total instructions from block types */
+      std::queue<uint32_t>                 fcnts;
+
+      // checktime_block_type
+      std::stack<size_t>                   block_stack;
+      std::stack<size_t>                   type_stack; /* this might capture more than if a block is a loop in the future */
+      std::queue<std::vector<size_t>>      orderings;  /* record the order in which we found the blocks */
+      std::queue<std::map<size_t, size_t>> bcnt_tables; /* table for each blocks instruction count */
+
+      // checktime_function_end
+      size_t                               fcnt = 0;
+
+      // checktime_injection
+      int32_t                              chktm_idx = 0;
+
+      // call_depth_check_and_insert_checktime
+      int32_t                              global_idx = -1;
+
+      // inlined checktime: the global the host raises once the deadline timer expires, or -1 to always call checktime
+      int32_t                              deadline_idx = -1;
+   };
+
+   // emits the checktime at a function entry, loop head or after a call. When it is inlined, checktime is only
+   // called once the deadline global is raised, which keeps the host transition out of hot loops
+   inline void pack_checktime( const injection_context& ctx, wasm_ops::instruction_stream* code ) {
+      wasm_ops::op_types<>::call_t chktm;
+      chktm.field = ctx.utils.injected_index_mapping.find(ctx.chktm_idx)->second;
+      if ( ctx.deadline_idx == -1 ) {
+         chktm.pack(code);
+         return;
+      }
+
+      wasm_ops::op_types<>::get_global_t get_deadline;
+      wasm_ops::op_types<>::if__t        if_inst;
+      wasm_ops::op_types<>::end_t        end_inst;
+      get_deadline.field = ctx.deadline_idx;
+
+      get_deadline.pack(code);
+      if_inst.pack(code);
+      chktm.pack(code);
+      end_inst.pack(code);
+   }
+
    struct noop_injection_visitor {
       static void inject( IR::Module& m );
       static void initializer();
@@ -154,115 +205,83 @@ namespace eosio { namespace chain { namespace wasm_injections {
    struct instruction_counter {
       static constexpr bool kills = false;
       static constexpr bool post = false;
-      static void init() { 
-         icnt=0; 
-         tcnt=0; 
-         bcnt=0; 
-         while ( !fcnts.empty() )
-            fcnts.pop();
-      }
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         icnt++;
-         tcnt++;
+         arg.injection->icnt++;
+         arg.injection->tcnt++;
       }
-      static uint32_t icnt; /* instructions so far */
-      static uint32_t tcnt; /* total instructions */
-      static uint32_t bcnt; /* total instructions from block types */
-      static std::queue<uint32_t> fcnts; 
    };
 
    struct checktime_block_type {
       static constexpr bool kills = false;
       static constexpr bool post = false;
-#define CLEAR(x) \
-      while( !x.empty() ) \
-         x.pop()
-
-      static void init() { 
-         CLEAR(block_stack);
-         CLEAR(type_stack);
-         CLEAR(orderings);
-         CLEAR(bcnt_tables);
-      }
-#undef CLEAR
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         instruction_counter::icnt = 0;
-         block_stack.push(arg.start_index);
-         orderings.back().push_back(arg.start_index);
-         bcnt_tables.back().emplace(arg.start_index, 0);
-         type_stack.push(inst->get_code() == wasm_ops::loop_code);
+         injection_context& ctx = *arg.injection;
+         ctx.icnt = 0;
+         ctx.block_stack.push(arg.start_index);
+         ctx.orderings.back().push_back(arg.start_index);
+         ctx.bcnt_tables.back().emplace(arg.start_index, 0);
+         ctx.type_stack.push(inst->get_code() == wasm_ops::loop_code);
       }
-
-      static std::stack<size_t>                   block_stack;
-      static std::stack<size_t>                   type_stack; /* this might capture more than if a block is a loop in the future */
-      static std::queue<std::vector<size_t>>      orderings;  /* record the order in which we found the blocks */
-      static std::queue<std::map<size_t, size_t>> bcnt_tables; /* table for each blocks instruction count */
    };
 
    struct checktime_end {
       static constexpr bool kills = false;
       static constexpr bool post = false;
-      static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         if ( checktime_block_type::type_stack.empty() ) 
+         injection_context& ctx = *arg.injection;
+         if ( ctx.type_stack.empty() ) 
             return;
-         if ( !checktime_block_type::type_stack.top() ) { // empty or is not a loop
-            checktime_block_type::block_stack.pop();
-            checktime_block_type::type_stack.pop();
+         if ( !ctx.type_stack.top() ) { // empty or is not a loop
+            ctx.block_stack.pop();
+            ctx.type_stack.pop();
             return;
          }
-         size_t inst_idx = checktime_block_type::block_stack.top();
-         checktime_block_type::bcnt_tables.back()[inst_idx] = instruction_counter::icnt;
-         instruction_counter::bcnt += instruction_counter::icnt;
-         instruction_counter::icnt = 0;
-         checktime_block_type::block_stack.pop();
-         checktime_block_type::type_stack.pop();
+         size_t inst_idx = ctx.block_stack.top();
+         ctx.bcnt_tables.back()[inst_idx] = ctx.icnt;
+         ctx.bcnt += ctx.icnt;
+         ctx.icnt = 0;
+         ctx.block_stack.pop();
+         ctx.type_stack.pop();
       }
    };
 
    struct checktime_function_end {
       static constexpr bool kills = false;
       static constexpr bool post = false;
-      static void init() { fcnt = 0; }
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         fcnt = instruction_counter::tcnt - instruction_counter::bcnt;
+         arg.injection->fcnt = arg.injection->tcnt - arg.injection->bcnt;
       }
-      static size_t fcnt;
    };
 
    struct checktime_injection {
       static constexpr bool kills = false;
       static constexpr bool post = true;
-      static void init() {
-         idx = 0;
-         chktm_idx = 0;
-      }
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         auto mapped_index = injector_utils::injected_index_mapping.find(chktm_idx);
-
-         wasm_ops::op_types<>::call_t chktm; 
-         chktm.field = mapped_index->second;
-         chktm.pack(arg.new_code);
+         pack_checktime( *arg.injection, arg.new_code );
       }
-
-      static int32_t idx;
-      static int32_t chktm_idx;
    };
 
    struct fix_call_index {
-      static constexpr bool kills = false;
+      static constexpr bool kills = true;
       static constexpr bool post = false;
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
+         const injector_utils& utils = arg.injection->utils;
          wasm_ops::op_types<>::call_t* call_inst = reinterpret_cast<wasm_ops::op_types<>::call_t*>(inst);
-         auto mapped_index = injector_utils::injected_index_mapping.find(call_inst->field);
+         auto mapped_index = utils.injected_index_mapping.find(call_inst->field);
 
-         if ( mapped_index != injector_utils::injected_index_mapping.end() )  {
+         if ( mapped_index != utils.injected_index_mapping.end() )  {
+            // the checktime calls inserted after each call by call_depth_check_and_insert_checktime
+            if ( call_inst->field == arg.injection->chktm_idx ) {
+               pack_checktime( *arg.injection, arg.new_code );
+               return;
+            }
             call_inst->field = mapped_index->second;
          }
          else {
-            call_inst->field += injector_utils::registered_injected.size();
+            call_inst->field += utils.registered_injected.size();
          }
+         call_inst->pack(arg.new_code);
       }
 
    };
@@ -270,19 +289,16 @@ namespace eosio { namespace chain { namespace wasm_injections {
    struct call_depth_check_and_insert_checktime {
       static constexpr bool kills = true;
       static constexpr bool post = false;
-      static int32_t global_idx; 
-      static void init() {
-         global_idx = -1;
-      }
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         if ( global_idx == -1 ) {
+         injection_context& ctx = *arg.injection;
+         if ( ctx.global_idx == -1 ) {
             arg.module->globals.defs.push_back({{ValueType::i32, true}, {(I32) eosio::chain::wasm_constraints::maximum_call_depth}});
          }
 
-         global_idx = arg.module->globals.size()-1;
+         ctx.global_idx = arg.module->globals.size()-1;
 
          int32_t assert_idx;
-         injector_utils::add_import<ResultType::none>(*(arg.module), "call_depth_assert", assert_idx);
+         ctx.utils.add_import<ResultType::none>(*(arg.module), "call_depth_assert", assert_idx);
 
          wasm_ops::op_types<>::call_t call_assert;
          wasm_ops::op_types<>::call_t call_checktime;
@@ -297,9 +313,9 @@ namespace eosio { namespace chain { namespace wasm_injections {
          wasm_ops::op_types<>::else__t else_inst; 
 
          call_assert.field = assert_idx;
-         call_checktime.field = checktime_injection::chktm_idx;
-         get_global_inst.field = global_idx;
-         set_global_inst.field = global_idx;
+         call_checktime.field = ctx.chktm_idx;
+         get_global_inst.field = ctx.global_idx;
+         set_global_inst.field = ctx.global_idx;
          const_inst.field = -1;
 
 #define INSERT_INJECTED(X)       \
@@ -469,7 +485,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f32, ValueType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -483,7 +499,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -497,7 +513,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::i32, ValueType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -510,7 +526,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f64, ValueType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -524,7 +540,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -538,7 +554,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::i32, ValueType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -552,7 +568,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::i32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -565,7 +581,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i64, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::i64, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -578,7 +594,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::i32, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -591,7 +607,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::i64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -604,7 +620,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::i32>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f32, ValueType::i32>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -617,7 +633,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::i64>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f32, ValueType::i64>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -630,7 +646,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::i32>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f64, ValueType::i32>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -643,7 +659,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::i64>( *(arg.module), inject_which_op(Opcode), idx );
+         arg.injection->utils.add_import<ResultType::f64, ValueType::i64>( *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -656,7 +672,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::f32>( *(arg.module), u8"_eosio_f32_promote", idx );
+         arg.injection->utils.add_import<ResultType::f64, ValueType::f32>( *(arg.module), u8"_eosio_f32_promote", idx );
          wasm_ops::op_types<>::call_t f32promote;
          f32promote.field = idx;
          f32promote.pack(arg.new_code);
@@ -669,7 +685,7 @@ namespace eosio { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::f64>( *(arg.module), u8"_eosio_f64_demote", idx );
+         arg.injection->utils.add_import<ResultType::f32, ValueType::f64>( *(arg.module), u8"_eosio_f64_demote", idx );
          wasm_ops::op_types<>::call_t f32promote;
          f32promote.field = idx;
          f32promote.pack(arg.new_code);
@@ -774,22 +790,23 @@ namespace eosio { namespace chain { namespace wasm_injections {
    };
  
    // inherit from this class and define your own injectors 
+   // all state of the injection lives in the instance, so separate instances may inject on separate threads
    class wasm_binary_injection {
       using standard_module_injectors = module_injectors< max_memory_injection_visitor >;
 
       public:
-         wasm_binary_injection( IR::Module& mod )  : _module( &mod ) { 
-            _module_injectors.init();
-            // initialize static fields of injectors
-            injector_utils::init( mod );
-            checktime_injection::init();
-            call_depth_check_and_insert_checktime::init();
+         // with inline_checktime, the module checks a global instead of calling checktime on every function entry,
+         // loop iteration and call. It is the last global of the module, which the host raises once the deadline
+         // timer expires
+         wasm_binary_injection( IR::Module& mod, bool inline_checktime = false )  : _module( &mod ), _inline_checktime( inline_checktime ) { 
+            standard_module_injectors::init();
+            _context.utils.init( mod );
          }
 
          void inject() {
-            _module_injectors.inject( *_module );
+            standard_module_injectors::inject( *_module );
             // inject checktime first
-            injector_utils::add_import<ResultType::none>( *_module, u8"checktime", checktime_injection::chktm_idx );
+            _context.utils.add_import<ResultType::none>( *_module, u8"checktime", _context.chktm_idx );
 
             for ( auto& fd : _module->functions.defs ) {
                wasm_ops::EOSIO_OperatorDecoderStream<pre_op_injectors> pre_decoder(fd.code);
@@ -799,32 +816,34 @@ namespace eosio { namespace chain { namespace wasm_injections {
                   auto op = pre_decoder.decodeOp();
                   if (op->is_post()) {
                      op->pack(&pre_code);
-                     op->visit( { _module, &pre_code, &fd, pre_decoder.index() } );
+                     op->visit( { _module, &pre_code, &fd, pre_decoder.index(), &_context } );
                   }
                   else {
-                     op->visit( { _module, &pre_code, &fd, pre_decoder.index() } );
+                     op->visit( { _module, &pre_code, &fd, pre_decoder.index(), &_context } );
                      if (!(op->is_kill()))
                         op->pack(&pre_code);
                   }
                }
                fd.code = pre_code.get();
             }
+            if ( _inline_checktime ) {
+               _module->globals.defs.push_back({{ValueType::i32, true}, {(I32) 0}});
+               _context.deadline_idx = _module->globals.size()-1;
+            }
             for ( auto& fd : _module->functions.defs ) {
                wasm_ops::EOSIO_OperatorDecoderStream<post_op_injectors> post_decoder(fd.code);
                wasm_ops::instruction_stream post_code(fd.code.size()*2);
 
-               wasm_ops::op_types<>::call_t chktm; 
-               chktm.field = injector_utils::injected_index_mapping.find(checktime_injection::chktm_idx)->second;
-               chktm.pack(&post_code);
+               pack_checktime( _context, &post_code );
 
                while ( post_decoder ) {
                   auto op = post_decoder.decodeOp();
                   if (op->is_post()) {
                      op->pack(&post_code);
-                     op->visit( { _module, &post_code, &fd, post_decoder.index() } );
+                     op->visit( { _module, &post_code, &fd, post_decoder.index(), &_context } );
                   }
                   else {
-                     op->visit( { _module, &post_code, &fd, post_decoder.index() } );
+                     op->visit( { _module, &post_code, &fd, post_decoder.index(), &_context } );
                      if (!(op->is_kill()))
                         op->pack(&post_code);
                   }
@@ -833,9 +852,9 @@ namespace eosio { namespace chain { namespace wasm_injections {
             }
          }
       private:
-         IR::Module* _module;
-         static std::string op_string;
-         static standard_module_injectors _module_injectors;
+         IR::Module*       _module;
+         bool              _inline_checktime;
+         injection_context _context;
    };
 
 }}} // namespace wasm_constraints, chain, eosio
@@ -100,20 +100,26 @@ namespace eosio { namespace chain { namespace wasm_validations {
       }
    };
    
+   // state of a validation pass over one module, reached through visitor_arg::validation so that any number of
+   // modules can be validated at the same time
+   struct validation_context {
+      // nested_validator
+      bool     nesting_disabled = false;
+      uint16_t depth = 0;
+   };
+
    struct nested_validator {
       static constexpr bool kills = false;
       static constexpr bool post = false;
-      static bool disabled;
-      static uint16_t depth;
-      static void init(bool disable) { disabled = disable; depth = 0; }
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         if (!disabled) {
-            if ( inst->get_code() == wasm_ops::end_code && depth > 0 ) {
-               depth--;
+         validation_context& ctx = *arg.validation;
+         if (!ctx.nesting_disabled) {
+            if ( inst->get_code() == wasm_ops::end_code && ctx.depth > 0 ) {
+               ctx.depth--;
                return;
             }
-            depth++;
-            EOS_ASSERT(depth < 1024, wasm_execution_error, "Nested depth exceeded");
+            ctx.depth++;
+            EOS_ASSERT(ctx.depth < 1024, wasm_execution_error, "Nested depth exceeded");
          }
       }
    };
@@ -332,7 +338,7 @@ namespace eosio { namespace chain { namespace wasm_validations {
       public:
          wasm_binary_validation( const eosio::chain::controller& control, IR::Module& mod ) : _module( &mod ) {
             // initialize validators here
-            nested_validator::init(!control.is_producing_block());
+            _context.nesting_disabled = !control.is_producing_block();
          }
 
          void validate() {
@@ -342,12 +348,13 @@ namespace eosio { namespace chain { namespace wasm_validations {
                while ( decoder ) {
                   wasm_ops::instruction_stream new_code(0);
                   auto op = decoder.decodeOp();
-                  op->visit( { _module, &new_code, &fd, decoder.index() } );
+                  op->visit( { _module, &new_code, &fd, decoder.index(), nullptr, &_context } );
                }
             }
          }
       private:
-         IR::Module* _module;
+         IR::Module*        _module;
+         validation_context _context;
          static standard_module_constraints_validators _module_validators;
    };
 
@@ -3,6 +3,7 @@
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/whitelisted_intrinsics.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/native_contracts.hpp>
 #include "Runtime/Linker.h"
 #include "Runtime/Runtime.h"
 
@@ -76,7 +77,17 @@ namespace eosio { namespace chain {
             wabt
          };
 
-         wasm_interface(vm_type vm, const chainbase::database& db);
+         enum class native_contract_mode {
+            disabled,     //always run the wasm
+            enabled,      //run registered native implementations in place of the wasm
+            differential  //run the wasm, and compare its effects with those of a trial run of the native implementation
+         };
+
+         //code_cache_dir and build_id configure the on-disk cache of compiled code, for runtimes that support it
+         //background_compile enables compiling newly deployed code on a separate thread ahead of its first use
+         //inline_checktime has contracts check the deadline timer inline instead of calling checktime, for runtimes that support it
+         wasm_interface(vm_type vm, const chainbase::database& db, const fc::path& code_cache_dir = fc::path(), const string& build_id = string(),
+                        bool background_compile = false, bool inline_checktime = false);
          ~wasm_interface();
 
          //call before dtor to skip what can be minutes of dtor overhead with some runtimes; can cause leaks
@@ -91,12 +102,22 @@ namespace eosio { namespace chain {
          //indicate the current LIB. evicts old cache entries
          void current_lib(const uint32_t lib);
 
+         //start compiling code deployed in block_num in the background, if enabled; apply waits for the result when needed
+         void precompile(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, const bytes& code, const uint32_t block_num);
+
          //Calls apply or error on a given code
          void apply(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, apply_context& context);
 
          //Immediately exits currently running wasm. UB is called when no wasm running
          void exit();
 
+         //use a native implementation for the actions it implements of the code with the given hash
+         void register_native_contract(const digest_type& code_hash, native_contract_apply apply);
+         void set_native_contract_mode(native_contract_mode mode);
+
+         //number of actions for which the differential mode saw the native implementation differ from the wasm
+         uint64_t native_contract_mismatches()const;
+
       private:
          unique_ptr<struct wasm_interface_impl> my;
          friend class eosio::chain::webassembly::common::intrinsics_accessor;
@@ -106,6 +127,8 @@ namespace eosio { namespace chain {
 
 namespace eosio{ namespace chain {
    std::istream& operator>>(std::istream& in, wasm_interface::vm_type& runtime);
+   std::istream& operator>>(std::istream& in, wasm_interface::native_contract_mode& mode);
 }}
 
 FC_REFLECT_ENUM( eosio::chain::wasm_interface::vm_type, (wavm)(wabt) )
+FC_REFLECT_ENUM( eosio::chain::wasm_interface::native_contract_mode, (disabled)(enabled)(differential) )
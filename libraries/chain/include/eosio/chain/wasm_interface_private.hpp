@@ -8,8 +8,13 @@
 #include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/code_object.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <future>
+#include <map>
+#include <tuple>
+
 #include "IR/Module.h"
 #include "Runtime/Intrinsics.h"
 #include "Platform/Platform.h"
@@ -37,16 +42,42 @@ namespace eosio { namespace chain {
       struct by_first_block_num;
       struct by_last_block_num;
 
-      wasm_interface_impl(wasm_interface::vm_type vm, const chainbase::database& d) : db(d) {
-         if(vm == wasm_interface::vm_type::wavm)
-            runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>();
+      using module_ptr = std::unique_ptr<wasm_instantiated_module_interface>;
+      using code_key = std::tuple<digest_type, uint8_t, uint8_t>;
+
+      //a compile started ahead of the first use of the code, deployed in block block_num
+      struct pending_compile {
+         uint32_t                 block_num = 0;
+         std::future<module_ptr>  module;
+      };
+
+      wasm_interface_impl(wasm_interface::vm_type vm, const chainbase::database& d, const fc::path& code_cache_dir, const string& build_id,
+                          bool background_compile, bool inline_checktime) : db(d) {
+         //only wavm maps the deadline global to the deadline timer, other runtimes keep calling checktime
+         if(vm == wasm_interface::vm_type::wavm) {
+            runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>(code_cache_dir, build_id, inline_checktime);
+            this->inline_checktime = inline_checktime;
+         }
          else if(vm == wasm_interface::vm_type::wabt)
             runtime_interface = std::make_unique<webassembly::wabt_runtime::wabt_runtime>();
          else
             EOS_THROW(wasm_exception, "wasm_interface_impl fall through");
+
+         //modules are parsed and injected in parallel, but wavm generates machine code for one module at a time,
+         // so more than a couple of threads would only wait on each other
+         if(background_compile)
+            compile_thread_pool.emplace( "wasmc", 2 );
       }
 
       ~wasm_interface_impl() {
+         //finish any compile in progress before the cache and runtime go away
+         if(compile_thread_pool)
+            compile_thread_pool->stop();
+         if(is_shutting_down)
+            for(auto& p : pending_compiles)
+               if(p.second.module.valid() && p.second.module.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                  try { p.second.module.get().release(); } catch(...) {}
+         pending_compiles.clear();
          if(is_shutting_down)
             for(wasm_cache_index::iterator it = wasm_instantiation_cache.begin(); it != wasm_instantiation_cache.end(); ++it)
                wasm_instantiation_cache.modify(it, [](wasm_cache_entry& e) {
@@ -83,6 +114,78 @@ namespace eosio { namespace chain {
       void current_lib(uint32_t lib) {
          //anything last used before or on the LIB can be evicted
          wasm_instantiation_cache.get<by_last_block_num>().erase(wasm_instantiation_cache.get<by_last_block_num>().begin(), wasm_instantiation_cache.get<by_last_block_num>().upper_bound(lib));
+
+         //code deployed in an irreversible block keeps its finished compile; code of a block that was forked out is dropped
+         for(auto p = pending_compiles.begin(); p != pending_compiles.end();) {
+            if(p->second.block_num > lib || p->second.module.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+               ++p;
+               continue;
+            }
+            try {
+               module_ptr module = p->second.module.get();
+               const auto key = boost::make_tuple(std::get<0>(p->first), std::get<1>(p->first), std::get<2>(p->first));
+               const code_object* codeobject = db.find<code_object,by_code_hash>(key);
+               if(codeobject && wasm_instantiation_cache.find(key) == wasm_instantiation_cache.end())
+                  wasm_instantiation_cache.emplace( wasm_interface_impl::wasm_cache_entry{
+                                                       .code_hash = codeobject->code_hash,
+                                                       .first_block_num_used = codeobject->first_block_used,
+                                                       .last_block_num_used = UINT32_MAX,
+                                                       .module = std::move(module),
+                                                       .vm_type = codeobject->vm_type,
+                                                       .vm_version = codeobject->vm_version
+                                                    } );
+            } catch(...) {
+               //code that fails to compile is reported when it is first applied
+            }
+            p = pending_compiles.erase(p);
+         }
+      }
+
+      void precompile(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, const char* code, size_t code_size, uint32_t block_num) {
+         if(!compile_thread_pool || code_size == 0)
+            return;
+         const code_key key(code_hash, vm_type, vm_version);
+         if(pending_compiles.count(key))
+            return;
+         auto it = wasm_instantiation_cache.find(boost::make_tuple(code_hash, vm_type, vm_version));
+         if(it != wasm_instantiation_cache.end() && it->module)
+            return;
+
+         auto code_copy = std::make_shared<std::vector<char>>(code, code + code_size);
+         pending_compiles[key] = pending_compile{ block_num,
+            async_thread_pool( compile_thread_pool->get_executor(), [this, code_copy, code_hash, vm_type, vm_version]() {
+               return build_module(code_copy->data(), code_copy->size(), code_hash, vm_type, vm_version);
+            } ) };
+      }
+
+      module_ptr build_module(const char* code, size_t code_size, const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version) {
+         IR::Module module;
+         try {
+            Serialization::MemoryInputStream stream((const U8*)code, code_size);
+            WASM::serialize(stream, module);
+            module.userSections.clear();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+
+         wasm_injections::wasm_binary_injection injector(module, inline_checktime);
+         injector.inject();
+
+         std::vector<U8> bytes;
+         try {
+            Serialization::ArrayOutputStream outstream;
+            WASM::serialize(outstream, module);
+            bytes = outstream.getBytes();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+
+         return runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module),
+                                                      code_hash, vm_type, vm_version);
       }
 
       const std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_hash, const uint8_t& vm_type,
@@ -112,41 +215,35 @@ namespace eosio { namespace chain {
                trx_context.resume_billing_timer();
             });
             trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)codeobject->code.data(), codeobject->code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
-
-            wasm_injections::wasm_binary_injection injector(module);
-            injector.inject();
 
-            std::vector<U8> bytes;
-            try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+            module_ptr module;
+            auto pending = pending_compiles.find(code_key(code_hash, vm_type, vm_version));
+            if(pending != pending_compiles.end()) {
+               auto module_future = std::move(pending->second.module);
+               pending_compiles.erase(pending);
+               module = module_future.get();
+            } else {
+               module = build_module(codeobject->code.data(), codeobject->code.size(), code_hash, vm_type, vm_version);
             }
 
             wasm_instantiation_cache.modify(it, [&](auto& c) {
-               c.module = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module));
+               c.module = std::move(module);
             });
          }
          return it->module;
       }
 
       bool is_shutting_down = false;
+      bool inline_checktime = false;
+
+      std::map<digest_type, native_contract_apply>  native_contracts;
+      wasm_interface::native_contract_mode          native_mode = wasm_interface::native_contract_mode::enabled;
+      uint64_t                                      native_mismatches = 0;
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
 
+      fc::optional<named_thread_pool>      compile_thread_pool;
+      std::map<code_key, pending_compile>  pending_compiles; //only used from the main thread
+
       typedef boost::multi_index_container<
          wasm_cache_entry,
          indexed_by<
@@ -1,4 +1,5 @@
 #pragma once
+#include <eosio/chain/types.hpp>
 #include <vector>
 #include <memory>
 
@@ -15,7 +16,9 @@ class wasm_instantiated_module_interface {
 
 class wasm_runtime_interface {
    public:
-      virtual std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) = 0;
+      //code_hash, vm_type and vm_version identify the code, for runtimes that cache what they compile from it
+      virtual std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory,
+                                                                                     const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version) = 0;
 
       //immediately exit the currently running wasm_instantiated_module_interface. Yep, this assumes only one can possibly run at a time.
       virtual void immediately_exit_currently_running_module() = 0;
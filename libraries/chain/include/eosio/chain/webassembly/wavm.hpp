@@ -18,11 +18,21 @@ using namespace eosio::chain::webassembly::common;
 
 class wavm_runtime : public eosio::chain::wasm_runtime_interface {
    public:
-      wavm_runtime();
+      //if code_cache_dir is not empty, compiled machine code is cached in it across restarts, keyed on a hash of the
+      // running binary and build_id, so that code cached by a different build is not loaded. Only one directory can be
+      // used per process, runtimes asking for another one do not cache. With inline_checktime, the modules are injected
+      // to check a deadline global, the last one of the module, which is raised along with deadline_timer::expired
+      wavm_runtime(const fc::path& code_cache_dir = fc::path(), const string& build_id = string(), bool inline_checktime = false);
       ~wavm_runtime();
-      std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) override;
+      std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory,
+                                                                             const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version) override;
 
       void immediately_exit_currently_running_module() override;
+
+   private:
+      bool   _cache_code = false;
+      string _build_id;
+      bool   _inline_checktime = false;
 };
 
 //This is a temporary hack for the single threaded implementation
@@ -464,7 +474,18 @@ struct intrinsic_invoker_impl<Ret, std::tuple<array_ptr<T>, array_ptr<U>, size_t
    static Ret translate_one(running_instance_context& ctx, Inputs... rest, Translated... translated, I32 ptr_t, I32 ptr_u, I32 size) {
       static_assert(std::is_same<std::remove_const_t<T>, char>::value && std::is_same<std::remove_const_t<U>, char>::value, "Currently only support array of (const)chars");
       const auto length = size_t(size);
-      return Then(ctx, array_ptr_impl<T>(ctx, (U32)ptr_t, length), array_ptr_impl<U>(ctx, (U32)ptr_u, length), length, rest..., translated...);
+      MemoryInstance* mem = ctx.memory;
+      if (!mem)
+         Runtime::causeException(Exception::Cause::accessViolation);
+
+      //same checks as array_ptr_impl for both ranges, against a single read of the memory size
+      const size_t mem_total = IR::numBytesPerPage * Runtime::getMemoryNumPages(mem);
+      const U32 ptr_max = std::max((U32)ptr_t, (U32)ptr_u);
+      if (ptr_max >= mem_total || length > mem_total - ptr_max)
+         Runtime::causeException(Exception::Cause::accessViolation);
+
+      char* base = (char*)getMemoryBaseAddress(mem);
+      return Then(ctx, array_ptr<T>((T*)(base + (U32)ptr_t)), array_ptr<U>((U*)(base + (U32)ptr_u)), length, rest..., translated...);
    };
 
    template<then_type Then>
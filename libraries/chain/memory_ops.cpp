@@ -0,0 +1,168 @@
+#include <eosio/chain/memory_ops.hpp>
+
+#include <atomic>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EOSIO_MEMORY_OPS_X86
+#include <immintrin.h>
+#endif
+
+namespace eosio { namespace chain { namespace memory_ops {
+
+namespace detail {
+
+#ifdef EOSIO_MEMORY_OPS_X86
+
+   static std::atomic<bool> avx2_disabled{false};
+
+   static bool cpu_has_avx2() {
+      static const bool avx2 = []() {
+         __builtin_cpu_init();
+         return __builtin_cpu_supports( "avx2" ) != 0;
+      }();
+      return avx2 && !avx2_disabled.load( std::memory_order_relaxed );
+   }
+
+   // The kernels copy whole vectors, with the last one overlapping the previous so that no scalar tail is needed.
+   // For memmove, the vectors are copied away from the overlap, and the one stored last is loaded before any store.
+   // SSE2 is part of x86_64, so it serves the cpus without AVX2 and the ranges shorter than an AVX2 vector.
+
+   static void move_sse2( char* dest, const char* src, size_t length ) {
+      if( dest <= src ) {
+         const __m128i tail = _mm_loadu_si128( (const __m128i*)(src + length - 16) );
+         for( size_t i = 0; i + 16 <= length; i += 16 )
+            _mm_storeu_si128( (__m128i*)(dest + i), _mm_loadu_si128( (const __m128i*)(src + i) ) );
+         _mm_storeu_si128( (__m128i*)(dest + length - 16), tail );
+      } else {
+         const __m128i head = _mm_loadu_si128( (const __m128i*)src );
+         for( size_t i = length; i >= 16; i -= 16 )
+            _mm_storeu_si128( (__m128i*)(dest + i - 16), _mm_loadu_si128( (const __m128i*)(src + i - 16) ) );
+         _mm_storeu_si128( (__m128i*)dest, head );
+      }
+   }
+
+   __attribute__((target("avx2")))
+   static void move_avx2( char* dest, const char* src, size_t length ) {
+      if( dest <= src ) {
+         const __m256i tail = _mm256_loadu_si256( (const __m256i*)(src + length - 32) );
+         for( size_t i = 0; i + 32 <= length; i += 32 )
+            _mm256_storeu_si256( (__m256i*)(dest + i), _mm256_loadu_si256( (const __m256i*)(src + i) ) );
+         _mm256_storeu_si256( (__m256i*)(dest + length - 32), tail );
+      } else {
+         const __m256i head = _mm256_loadu_si256( (const __m256i*)src );
+         for( size_t i = length; i >= 32; i -= 32 )
+            _mm256_storeu_si256( (__m256i*)(dest + i - 32), _mm256_loadu_si256( (const __m256i*)(src + i - 32) ) );
+         _mm256_storeu_si256( (__m256i*)dest, head );
+      }
+      _mm256_zeroupper();
+   }
+
+   static void set_sse2( char* dest, char value, size_t length ) {
+      const __m128i v = _mm_set1_epi8( value );
+      for( size_t i = 0; i + 16 <= length; i += 16 )
+         _mm_storeu_si128( (__m128i*)(dest + i), v );
+      _mm_storeu_si128( (__m128i*)(dest + length - 16), v );
+   }
+
+   __attribute__((target("avx2")))
+   static void set_avx2( char* dest, char value, size_t length ) {
+      const __m256i v = _mm256_set1_epi8( value );
+      for( size_t i = 0; i + 32 <= length; i += 32 )
+         _mm256_storeu_si256( (__m256i*)(dest + i), v );
+      _mm256_storeu_si256( (__m256i*)(dest + length - 32), v );
+      _mm256_zeroupper();
+   }
+
+   static int compare_at( const char* a, const char* b, size_t i ) {
+      return uint8_t(a[i]) < uint8_t(b[i]) ? -1 : 1;
+   }
+
+   // the bytes before a window all compared equal, so the first difference inside the overlapping last window is
+   // the first difference of the whole range
+   static int compare_sse2( const char* a, const char* b, size_t length ) {
+      for( size_t i = 0;; i += 16 ) {
+         if( i + 16 > length )
+            i = length - 16;
+         const unsigned mask = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)(a + i) ),
+                                                                  _mm_loadu_si128( (const __m128i*)(b + i) ) ) );
+         if( mask != 0xffff )
+            return compare_at( a, b, i + __builtin_ctz( ~mask ) );
+         if( i + 16 == length )
+            return 0;
+      }
+   }
+
+   __attribute__((target("avx2")))
+   static int compare_avx2( const char* a, const char* b, size_t length ) {
+      for( size_t i = 0;; i += 32 ) {
+         if( i + 32 > length )
+            i = length - 32;
+         const unsigned mask = _mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)(a + i) ),
+                                                                        _mm256_loadu_si256( (const __m256i*)(b + i) ) ) );
+         if( mask != 0xffffffff ) {
+            _mm256_zeroupper();
+            return compare_at( a, b, i + __builtin_ctz( ~mask ) );
+         }
+         if( i + 32 == length ) {
+            _mm256_zeroupper();
+            return 0;
+         }
+      }
+   }
+
+   void move_large( char* dest, const char* src, size_t length ) {
+      if( length >= 32 && cpu_has_avx2() )
+         move_avx2( dest, src, length );
+      else
+         move_sse2( dest, src, length );
+   }
+
+   void set_large( char* dest, char value, size_t length ) {
+      if( length >= 32 && cpu_has_avx2() )
+         set_avx2( dest, value, length );
+      else
+         set_sse2( dest, value, length );
+   }
+
+   int compare_large( const char* a, const char* b, size_t length ) {
+      if( length >= 32 && cpu_has_avx2() )
+         return compare_avx2( a, b, length );
+      return compare_sse2( a, b, length );
+   }
+
+#else
+
+   void move_large( char* dest, const char* src, size_t length ) {
+      ::memmove( dest, src, length );
+   }
+
+   void set_large( char* dest, char value, size_t length ) {
+      ::memset( dest, value, length );
+   }
+
+   int compare_large( const char* a, const char* b, size_t length ) {
+      const int ret = ::memcmp( a, b, length );
+      return ret < 0 ? -1 : ret > 0 ? 1 : 0;
+   }
+
+#endif
+
+} /// detail
+
+   const char* large_kernels() {
+#ifdef EOSIO_MEMORY_OPS_X86
+      return detail::cpu_has_avx2() ? "avx2" : "sse2";
+#else
+      return "libc";
+#endif
+   }
+
+   bool disable_avx2( bool disable ) {
+#ifdef EOSIO_MEMORY_OPS_X86
+      return detail::avx2_disabled.exchange( disable );
+#else
+      return false; // there are no AVX2 kernels to disable
+#endif
+   }
+
+} } } /// eosio::chain::memory_ops
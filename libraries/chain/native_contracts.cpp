@@ -0,0 +1,262 @@
+#include <eosio/chain/native_contracts.hpp>
+#include <eosio/chain/apply_context.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/wasm_interface.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace eosio { namespace chain {
+
+void native_contract_context::require_recipient( account_name recipient ) {
+   if( !_recorded_recipients ) {
+      context.require_recipient( recipient );
+   } else if( !context.has_recipient( recipient )
+              && std::find( _recorded_recipients->begin(), _recorded_recipients->end(), recipient ) == _recorded_recipients->end() ) {
+      _recorded_recipients->push_back( recipient );
+   }
+}
+
+namespace native_contracts {
+
+namespace {
+
+   /// eosio_assert of the contracts
+   void check( bool condition, const char* message ) {
+      if( !condition )
+         EOS_THROW( eosio_assert_message_exception, "assertion failure with message: ${s}", ("s",message) );
+   }
+
+   /// multi_index::find and the load of the row it found, returns the iterator, negative when there is no row
+   int find_row( apply_context& context, uint64_t scope, uint64_t table, uint64_t primary_key, bytes& row ) {
+      const int itr = context.db_find_i64( context.get_receiver(), scope, table, primary_key );
+      if( itr < 0 )
+         return itr;
+      const int size = context.db_get_i64( itr, nullptr, 0 );
+      check( size >= 0, "error reading iterator" );
+      row.resize( size );
+      context.db_get_i64( itr, row.data(), row.size() );
+      return itr;
+   }
+
+   /**
+    * eosio.token of eosio.contracts v1.5, of which only transfer is implemented
+    */
+   namespace token {
+      constexpr int64_t max_amount = (int64_t(1) << 62) - 1;
+
+      struct asset {
+         int64_t  amount = 0;
+         uint64_t symbol = 0;
+
+         uint64_t code()const { return symbol >> 8; }
+      };
+
+      bool is_valid_symbol_code( uint64_t sym ) {
+         for( int i = 0; i < 7; i++ ) {
+            const char c = (char)(sym & 0xFF);
+            if( !('A' <= c && c <= 'Z') ) return false;
+            sym >>= 8;
+            if( !(sym & 0xFF) ) {
+               do {
+                  sym >>= 8;
+                  if( (sym & 0xFF) ) return false;
+                  i++;
+               } while( i < 7 );
+            }
+         }
+         return true;
+      }
+
+      bool is_valid( const asset& a ) {
+         return -max_amount <= a.amount && a.amount <= max_amount && is_valid_symbol_code( a.code() );
+      }
+
+      asset read_asset( const bytes& row, size_t offset ) {
+         check( row.size() >= offset + 16, "read" );
+         asset a;
+         memcpy( &a.amount, row.data() + offset, 8 );
+         memcpy( &a.symbol, row.data() + offset + 8, 8 );
+         return a;
+      }
+
+      std::array<char, 16> pack_account( const asset& balance ) {
+         std::array<char, 16> row;
+         memcpy( row.data(), &balance.amount, 8 );
+         memcpy( row.data() + 8, &balance.symbol, 8 );
+         return row;
+      }
+
+      void sub_balance( apply_context& context, account_name owner, const asset& value ) {
+         bytes row;
+         const int itr = find_row( context, owner, N(accounts), value.code(), row );
+         check( itr >= 0, "no balance object found" );
+         asset balance = read_asset( row, 0 );
+         check( balance.amount >= value.amount, "overdrawn balance" );
+
+         check( value.symbol == balance.symbol, "attempt to subtract asset with different symbol" );
+         balance.amount -= value.amount;
+         check( -max_amount <= balance.amount, "subtraction underflow" );
+         check( balance.amount <= max_amount, "subtraction overflow" );
+
+         const auto packed = pack_account( balance );
+         context.db_update_i64( itr, owner, packed.data(), packed.size() );
+      }
+
+      void add_balance( apply_context& context, account_name owner, const asset& value, account_name ram_payer ) {
+         bytes row;
+         const int itr = find_row( context, owner, N(accounts), value.code(), row );
+         if( itr < 0 ) {
+            const auto packed = pack_account( value );
+            context.db_store_i64( owner, N(accounts), ram_payer, value.code(), packed.data(), packed.size() );
+         } else {
+            asset balance = read_asset( row, 0 );
+            check( value.symbol == balance.symbol, "attempt to add asset with different symbol" );
+            balance.amount += value.amount;
+            check( -max_amount <= balance.amount, "addition underflow" );
+            check( balance.amount <= max_amount, "addition overflow" );
+
+            const auto packed = pack_account( balance );
+            context.db_update_i64( itr, account_name(), packed.data(), packed.size() );
+         }
+      }
+
+      bool apply( native_contract_context& ctx ) {
+         apply_context& context = ctx.context;
+         const action& act = context.get_action();
+         if( context.get_receiver() != act.account || act.name != N(transfer) )
+            return false;
+
+         // unpacked up front, scheduling a notification can move the action
+         account_name from, to;
+         asset quantity;
+         string memo;
+         fc::datastream<const char*> ds( act.data.data(), act.data.size() );
+         fc::raw::unpack( ds, from );
+         fc::raw::unpack( ds, to );
+         fc::raw::unpack( ds, quantity.amount );
+         fc::raw::unpack( ds, quantity.symbol );
+         fc::raw::unpack( ds, memo );
+
+         check( from != to, "cannot transfer to self" );
+         context.require_authorization( from );
+         check( context.is_account( to ), "to account does not exist" );
+
+         const uint64_t sym_code = quantity.code();
+         bytes stat;
+         check( find_row( context, sym_code, N(stat), sym_code, stat ) >= 0, "unable to find key" );
+         check( stat.size() >= 40, "read" ); // supply, max_supply and issuer
+         const asset supply = read_asset( stat, 0 );
+
+         ctx.require_recipient( from );
+         ctx.require_recipient( to );
+
+         check( is_valid( quantity ), "invalid quantity" );
+         check( quantity.amount > 0, "must transfer positive quantity" );
+         check( quantity.symbol == supply.symbol, "symbol precision mismatch" );
+         check( memo.size() <= 256, "memo has more than 256 bytes" );
+
+         const account_name payer = context.has_authorization( to ) ? to : from;
+
+         sub_balance( context, from, quantity );
+         add_balance( context, to, quantity, payer );
+         return true;
+      }
+   }
+
+   const std::map<string, native_contract_apply>& implementations() {
+      static const std::map<string, native_contract_apply> impls = {
+         { "eosio.token", &token::apply }
+      };
+      return impls;
+   }
+
+   /// what the action did to the context since the checkpoint, while the table deltas were recorded
+   void collect_effects( apply_context& context, const apply_context::checkpoint& cp, native_contract_effects& effects ) {
+      effects.table_deltas = std::move( *context.recorded_table_deltas );
+      for( const auto& d : context.get_account_ram_deltas() )
+         effects.ram_deltas[d.account] += d.delta;
+      for( const auto& d : cp.account_ram_deltas )
+         effects.ram_deltas[d.account] -= d.delta;
+      for( auto itr = effects.ram_deltas.begin(); itr != effects.ram_deltas.end(); ) {
+         if( itr->second == 0 )
+            itr = effects.ram_deltas.erase( itr );
+         else
+            ++itr;
+      }
+   }
+
+} /// anonymous
+
+   native_contract_apply find( const string& name ) {
+      auto itr = implementations().find( name );
+      return itr == implementations().end() ? nullptr : itr->second;
+   }
+
+   vector<string> names() {
+      vector<string> result;
+      for( const auto& i : implementations() )
+         result.push_back( i.first );
+      return result;
+   }
+
+   void apply_differential( native_contract_apply native, apply_context& context, const std::function<void()>& apply_wasm,
+                            const mismatch_handler& on_mismatch ) {
+      native_contract_effects native_effects, wasm_effects;
+      bool handled = true;
+      {
+         auto cp = context.make_checkpoint();
+         auto session = context.db.start_undo_session( true );
+         {
+            // the iterators of the trial point into state that is about to be undone
+            apply_context::isolated_iterator_caches trial_caches( context );
+            context.recorded_table_deltas.emplace();
+            native_contract_context ctx( context, &native_effects.recipients );
+            try {
+               handled = native( ctx );
+            } catch( ... ) {
+               native_effects.failed = true;
+            }
+            collect_effects( context, cp, native_effects );
+            context.recorded_table_deltas.reset();
+         }
+         session.undo();
+         context.restore_checkpoint( std::move(cp) );
+      }
+      if( !handled ) {
+         apply_wasm();
+         return;
+      }
+
+      auto cp = context.make_checkpoint();
+      context.recorded_table_deltas.emplace();
+      std::exception_ptr wasm_failure;
+      try {
+         apply_wasm();
+      } catch( const wasm_exit& ) {
+      } catch( ... ) {
+         wasm_failure = std::current_exception();
+      }
+      collect_effects( context, cp, wasm_effects );
+      context.recorded_table_deltas.reset();
+      const auto& notified = context.get_notified();
+      for( size_t i = cp.notified; i < notified.size(); ++i )
+         wasm_effects.recipients.push_back( notified[i].first );
+
+      // whatever a failed action did is discarded with its transaction
+      if( native_effects.failed )
+         native_effects = native_contract_effects{ {}, {}, {}, true };
+      if( wasm_failure )
+         wasm_effects = native_contract_effects{ {}, {}, {}, true };
+      if( native_effects != wasm_effects )
+         on_mismatch( native_effects, wasm_effects );
+      if( wasm_failure )
+         std::rethrow_exception( wasm_failure );
+   }
+
+} /// native_contracts
+
+} } /// eosio::chain
@@ -154,6 +154,18 @@ is not allowed to schedule a deferred transaction in which the RAM costs are pai
 unless that account authorized the action;
 but is allowed to execute database operations that increase RAM usage of an account other than the receiver as long as
 either the account authorized the action or the action's net effect on RAM usage for the account is to not increase it.
+*/
+            {}
+         } )
+         (  builtin_protocol_feature_t::batch_db_reads, builtin_protocol_feature_spec{
+            "BATCH_DB_READS",
+            fc::variant("017009eed6bf0d38ca1b792f7c350e98837f5c9da6ff86ffea057d8bf0f6d919").as<digest_type>(),
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: BATCH_DB_READS
+
+Adds an intrinsic that reads consecutive rows of a primary index table, starting at an iterator, into a buffer supplied
+by the contract in a single call.
 */
             {}
          } )
@@ -6,6 +6,7 @@
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 
 #include <boost/range/adaptor/transformed.hpp>
@@ -26,7 +27,7 @@ namespace eosio { namespace chain {
 using namespace boost::multi_index;
 
 struct cached_pub_key {
-   transaction_id_type trx_id;
+   digest_type digest;
    public_key_type pub_key;
    signature_type sig;
    fc::microseconds cpu_usage;
@@ -50,6 +51,47 @@ typedef multi_index_container<
    >
 > recovery_cache_type;
 
+namespace {
+
+   /**
+    * Process wide LRU cache of keys recovered from (digest, signature) pairs, shared by every transaction so that a
+    * transaction seen again (in a block, or re-pushed after a fork switch) does not pay for recovery twice.
+    * The sequenced index is in LRU order: hits are moved to the back and entries are evicted from the front.
+    */
+   struct recovery_cache {
+      std::mutex              mtx;
+      recovery_cache_type     cache;
+      size_t                  max_size = 10000;
+      std::atomic<uint64_t>   hits{0};
+      std::atomic<uint64_t>   misses{0};
+   };
+
+   recovery_cache& get_recovery_cache() {
+      static recovery_cache rc;
+      return rc;
+   }
+
+}
+
+signature_recovery_cache_stats get_signature_recovery_cache_stats() {
+   auto& rc = get_recovery_cache();
+   signature_recovery_cache_stats stats;
+   stats.hits = rc.hits.load( std::memory_order_relaxed );
+   stats.misses = rc.misses.load( std::memory_order_relaxed );
+   std::lock_guard<std::mutex> g( rc.mtx );
+   stats.size = rc.cache.size();
+   stats.max_size = rc.max_size;
+   return stats;
+}
+
+void set_signature_recovery_cache_size( size_t max_size ) {
+   auto& rc = get_recovery_cache();
+   std::lock_guard<std::mutex> g( rc.mtx );
+   rc.max_size = max_size;
+   while( rc.cache.size() > rc.max_size )
+      rc.cache.pop_front();
+}
+
 void deferred_transaction_generation_context::reflector_init() {
       static_assert( fc::raw::has_feature_reflector_init_on_unpacked_reflected_types,
                      "deferred_transaction_generation_context expects FC to support reflector_init" );
@@ -99,34 +141,40 @@ fc::microseconds transaction::get_signature_keys( const vector<signature_type>&
 { try {
    using boost::adaptors::transformed;
 
-   constexpr size_t recovery_cache_size = 10000;
-   static recovery_cache_type recovery_cache;
-   static std::mutex cache_mtx;
+   auto& rc = get_recovery_cache();
+   auto& by_sig_idx = rc.cache.get<by_sig>();
 
    auto start = fc::time_point::now();
    recovered_pub_keys.clear();
    const digest_type digest = sig_digest(chain_id, cfd);
 
-   std::unique_lock<std::mutex> lock(cache_mtx, std::defer_lock);
+   std::unique_lock<std::mutex> lock(rc.mtx, std::defer_lock);
    fc::microseconds sig_cpu_usage;
    for(const signature_type& sig : signatures) {
       auto now = fc::time_point::now();
       EOS_ASSERT( now < deadline, tx_cpu_usage_exceeded, "transaction signature verification executed for too long",
                   ("now", now)("deadline", deadline)("start", start) );
       public_key_type recov;
-      const auto& tid = id();
       lock.lock();
-      recovery_cache_type::index<by_sig>::type::iterator it = recovery_cache.get<by_sig>().find( sig );
-      if( it == recovery_cache.get<by_sig>().end() || it->trx_id != tid ) {
+      auto it = by_sig_idx.find( sig );
+      if( it == by_sig_idx.end() || it->digest != digest ) {
          lock.unlock();
+         ++rc.misses;
          recov = public_key_type( sig, digest );
          fc::microseconds cpu_usage = fc::time_point::now() - start;
          lock.lock();
-         recovery_cache.emplace_back( cached_pub_key{tid, recov, sig, cpu_usage} ); //could fail on dup signatures; not a problem
+         it = by_sig_idx.find( sig ); // may have changed while unlocked
+         if( it != by_sig_idx.end() )
+            by_sig_idx.erase( it );
+         rc.cache.emplace_back( cached_pub_key{digest, recov, sig, cpu_usage} );
+         while( rc.cache.size() > rc.max_size )
+            rc.cache.pop_front();
          sig_cpu_usage += cpu_usage;
       } else {
+         ++rc.hits;
          recov = it->pub_key;
          sig_cpu_usage += it->cpu_usage;
+         rc.cache.relocate( rc.cache.end(), rc.cache.project<0>( it ) );
       }
       lock.unlock();
       bool successful_insertion = false;
@@ -136,11 +184,6 @@ fc::microseconds transaction::get_signature_keys( const vector<signature_type>&
                   ("key", recov) );
    }
 
-   lock.lock();
-   while ( recovery_cache.size() > recovery_cache_size )
-      recovery_cache.erase( recovery_cache.begin());
-   lock.unlock();
-
    return sig_cpu_usage;
 } FC_CAPTURE_AND_RETHROW() }
 
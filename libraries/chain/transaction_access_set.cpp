@@ -0,0 +1,49 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <eosio/chain/transaction_access_set.hpp>
+
+namespace eosio { namespace chain {
+
+   namespace {
+      /// both sets are sorted, so walk them together instead of searching one for each element of the other
+      template<typename Set>
+      bool intersects( const Set& a, const Set& b ) {
+         auto ai = a.begin(), bi = b.begin();
+         while( ai != a.end() && bi != b.end() ) {
+            if( *ai < *bi ) {
+               ++ai;
+            } else if( *bi < *ai ) {
+               ++bi;
+            } else {
+               return true;
+            }
+         }
+         return false;
+      }
+   }
+
+   bool transaction_access_set::conflicts_with( const transaction_access_set& other )const {
+      if( global_write || other.global_write )
+         return true;
+      return intersects( table_writes, other.table_writes )
+          || intersects( table_writes, other.table_reads )
+          || intersects( table_reads, other.table_writes )
+          || intersects( account_writes, other.account_writes )
+          || intersects( account_writes, other.account_reads )
+          || intersects( account_reads, other.account_writes );
+   }
+
+   vector<uint32_t> conflict_free_waves( const vector<transaction_access_set>& sets ) {
+      vector<uint32_t> waves( sets.size(), 0 );
+      for( size_t i = 0; i < sets.size(); ++i ) {
+         for( size_t j = 0; j < i; ++j ) {
+            if( waves[j] >= waves[i] && sets[i].conflicts_with( sets[j] ) )
+               waves[i] = waves[j] + 1;
+         }
+      }
+      return waves;
+   }
+
+} } /// namespace eosio::chain
@@ -111,21 +111,21 @@ namespace bacc = boost::accumulators;
 
    void deadline_timer::start(fc::time_point tp) {
       if(tp == fc::time_point::maximum()) {
-         expired = 0;
+         set_expired(0);
          return;
       }
       if(!deadline_timer_verification.use_deadline_timer) {
-         expired = 1;
+         set_expired(1);
          return;
       }
       microseconds x = tp.time_since_epoch() - fc::time_point::now().time_since_epoch();
       if(x.count() <= deadline_timer_verification.timer_overhead)
-         expired = 1;
+         set_expired(1);
       else {
          struct itimerval enable = {{0, 0}, {0, (int)x.count()-deadline_timer_verification.timer_overhead}};
-         expired = 0;
+         set_expired(0);
          if(setitimer(ITIMER_REAL, &enable, NULL))
-            expired = 1;
+            set_expired(1);
       }
    }
 
@@ -140,10 +140,18 @@ namespace bacc = boost::accumulators;
       stop();
    }
 
+   void deadline_timer::set_expired(sig_atomic_t e) {
+      expired = e;
+      volatile sig_atomic_t* flag = expired_flag;
+      if(flag)
+         *flag = e;
+   }
+
    void deadline_timer::timer_expired(int) {
-      expired = 1;
+      set_expired(1);
    }
    volatile sig_atomic_t deadline_timer::expired = 0;
+   volatile sig_atomic_t* volatile deadline_timer::expired_flag = nullptr;
    bool deadline_timer::initialized = false;
 
    transaction_context::transaction_context( controller& c,
@@ -281,7 +289,7 @@ namespace bacc = boost::accumulators;
       checktime(); // Fail early if deadline has already been exceeded
 
       if(control.skip_trx_checks())
-         _deadline_timer.expired = 0;
+         _deadline_timer.set_expired(0);
       else
          _deadline_timer.start(_deadline);
 
@@ -435,6 +443,11 @@ namespace bacc = boost::accumulators;
 
       rl.add_transaction_usage( bill_to_accounts, static_cast<uint64_t>(billed_cpu_time_us), net_usage,
                                 block_timestamp_type(control.pending_block_time()).slot ); // Should never fail
+
+      if( access_set ) {
+         for( const auto& a : bill_to_accounts )
+            access_set->write_account( a );
+      }
    }
 
    void transaction_context::squash() {
@@ -562,6 +575,9 @@ namespace bacc = boost::accumulators;
       if( ram_delta > 0 ) {
          validate_ram_usage.insert( account );
       }
+      if( access_set ) {
+         access_set->write_account( account );
+      }
    }
 
    uint32_t transaction_context::update_billed_cpu_time( fc::time_point now ) {
@@ -91,6 +91,4 @@ void ensure_apply_exported_visitor::validate( const IR::Module& m ) {
       FC_THROW_EXCEPTION(wasm_execution_error, "Smart contract's apply function not exported; non-existent; or wrong type");
 }
 
-uint16_t nested_validator::depth = 0;
-bool     nested_validator::disabled = false;
 }}} // namespace eosio chain validation
@@ -10,6 +10,7 @@
 #include <eosio/chain/wasm_interface_private.hpp>
 #include <eosio/chain/wasm_eosio_validation.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
+#include <eosio/chain/memory_ops.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/protocol_state_object.hpp>
 #include <eosio/chain/account_object.hpp>
@@ -29,7 +30,9 @@ namespace eosio { namespace chain {
    using namespace webassembly;
    using namespace webassembly::common;
 
-   wasm_interface::wasm_interface(vm_type vm, const chainbase::database& d) : my( new wasm_interface_impl(vm, d) ) {}
+   wasm_interface::wasm_interface(vm_type vm, const chainbase::database& d, const fc::path& code_cache_dir, const string& build_id,
+                                  bool background_compile, bool inline_checktime)
+   : my( new wasm_interface_impl(vm, d, code_cache_dir, build_id, background_compile, inline_checktime) ) {}
 
    wasm_interface::~wasm_interface() {}
 
@@ -52,9 +55,9 @@ namespace eosio { namespace chain {
       root_resolver resolver( pso.whitelisted_intrinsics );
       LinkResult link_result = linkModule(module, resolver);
 
-      //there are a couple opportunties for improvement here--
+      //there is an opportunity for improvement here--
       //Easy: Cache the Module created here so it can be reused for instantiaion
-      //Hard: Kick off instantiation in a separate thread at this location
+      //(instantiation is kicked off in a separate thread by apply_eosio_setcode when background compile is enabled)
 	 }
 
    void wasm_interface::indicate_shutting_down() {
@@ -69,8 +72,47 @@ namespace eosio { namespace chain {
       my->current_lib(lib);
    }
 
+   void wasm_interface::precompile(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, const bytes& code, const uint32_t block_num) {
+      my->precompile(code_hash, vm_type, vm_version, code.data(), code.size(), block_num);
+   }
+
    void wasm_interface::apply( const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, apply_context& context ) {
-      my->get_instantiated_module(code_hash, vm_type, vm_version, context.trx_context)->apply(context);
+      auto apply_wasm = [&]() {
+         my->get_instantiated_module(code_hash, vm_type, vm_version, context.trx_context)->apply(context);
+      };
+
+      if( my->native_mode != native_contract_mode::disabled && vm_type == 0 && vm_version == 0 ) {
+         auto itr = my->native_contracts.find( code_hash );
+         if( itr != my->native_contracts.end() ) {
+            if( my->native_mode == native_contract_mode::enabled ) {
+               native_contract_context ctx( context );
+               if( itr->second( ctx ) )
+                  return;
+            } else {
+               native_contracts::apply_differential( itr->second, context, apply_wasm,
+                  [&]( const native_contract_effects& native, const native_contract_effects& wasm ) {
+                     ++my->native_mismatches;
+                     elog( "native implementation of ${h} differs from its wasm on ${a}::${n} received by ${r}: native ${ne}, wasm ${we}",
+                           ("h", code_hash)("a", context.get_action().account)("n", context.get_action().name)
+                           ("r", context.get_receiver())("ne", native)("we", wasm) );
+                  } );
+               return;
+            }
+         }
+      }
+      apply_wasm();
+   }
+
+   void wasm_interface::register_native_contract( const digest_type& code_hash, native_contract_apply apply ) {
+      my->native_contracts[code_hash] = apply;
+   }
+
+   void wasm_interface::set_native_contract_mode( native_contract_mode mode ) {
+      my->native_mode = mode;
+   }
+
+   uint64_t wasm_interface::native_contract_mismatches()const {
+      return my->native_mismatches;
    }
 
    void wasm_interface::exit() {
@@ -1302,6 +1344,9 @@ class database_api : public context_aware_api {
       int db_get_i64( int itr, array_ptr<char> buffer, size_t buffer_size ) {
          return context.db_get_i64( itr, buffer, buffer_size );
       }
+      int db_get_rows_i64( int itr, array_ptr<char> buffer, size_t buffer_size, uint32_t max_rows, int& next ) {
+         return context.db_get_rows_i64( itr, buffer, buffer_size, max_rows, next );
+      }
       int db_next_i64( int itr, uint64_t& primary ) {
          return context.db_next_i64(itr, primary);
       }
@@ -1336,24 +1381,22 @@ class memory_api : public context_aware_api {
       char* memcpy( array_ptr<char> dest, array_ptr<const char> src, size_t length) {
          EOS_ASSERT((size_t)(std::abs((ptrdiff_t)dest.value - (ptrdiff_t)src.value)) >= length,
                overlapping_memory_error, "memcpy can only accept non-aliasing pointers");
-         return (char *)::memcpy(dest, src, length);
+         memory_ops::copy(dest, src, length);
+         return dest;
       }
 
       char* memmove( array_ptr<char> dest, array_ptr<const char> src, size_t length) {
-         return (char *)::memmove(dest, src, length);
+         memory_ops::move(dest, src, length);
+         return dest;
       }
 
       int memcmp( array_ptr<const char> dest, array_ptr<const char> src, size_t length) {
-         int ret = ::memcmp(dest, src, length);
-         if(ret < 0)
-            return -1;
-         if(ret > 0)
-            return 1;
-         return 0;
+         return memory_ops::compare(dest, src, length);
       }
 
       char* memset( array_ptr<char> dest, int value, size_t length ) {
-         return (char *)::memset( dest, value, length );
+         memory_ops::set( dest, value, length );
+         return dest;
       }
 };
 
@@ -1797,6 +1840,7 @@ REGISTER_INTRINSICS( database_api,
    (db_update_i64,       void(int,int64_t,int,int))
    (db_remove_i64,       void(int))
    (db_get_i64,          int(int, int, int))
+   (db_get_rows_i64,     int(int, int, int, int, int))
    (db_next_i64,         int(int, int))
    (db_previous_i64,     int(int, int))
    (db_find_i64,         int(int64_t,int64_t,int64_t,int64_t))
@@ -1976,4 +2020,18 @@ std::istream& operator>>(std::istream& in, wasm_interface::vm_type& runtime) {
    return in;
 }
 
+std::istream& operator>>(std::istream& in, wasm_interface::native_contract_mode& mode) {
+   std::string s;
+   in >> s;
+   if (s == "disabled")
+      mode = wasm_interface::native_contract_mode::disabled;
+   else if (s == "enabled")
+      mode = wasm_interface::native_contract_mode::enabled;
+   else if (s == "differential")
+      mode = wasm_interface::native_contract_mode::differential;
+   else
+      in.setstate(std::ios_base::failbit);
+   return in;
+}
+
 } } /// eosio::chain
@@ -2,7 +2,11 @@
 #include <eosio/chain/wasm_eosio_constraints.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
 #include <eosio/chain/apply_context.hpp>
+#include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/thread_utils.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/scoped_exit.hpp>
 
 #include "IR/Module.h"
 #include "Platform/Platform.h"
@@ -12,8 +16,11 @@
 #include "Runtime/Linker.h"
 #include "Runtime/Intrinsics.h"
 
+#include <atomic>
+#include <fstream>
 #include <vector>
 #include <iterator>
+#include <mutex>
 
 using namespace IR;
 using namespace Runtime;
@@ -29,47 +36,153 @@ struct wavm_runtime_initializer {
    }
 };
 
+//the machine code also depends on the injection passes, intrinsics and compiler flags of the build, which a version
+// string does not pin down, so cached code is keyed on a hash of the running binary. Empty if it cannot be read.
+static string runtime_binary_hash() {
+   std::ifstream exe( "/proc/self/exe", std::ios::binary );
+   if( !exe )
+      return string();
+   fc::sha256::encoder enc;
+   std::vector<char> buf( 1024*1024 );
+   while( exe.read( buf.data(), buf.size() ) || exe.gcount() > 0 )
+      enc.write( buf.data(), exe.gcount() );
+   return exe.bad() ? string() : enc.result().str();
+}
+
 using live_module_ref = std::list<ObjectInstance*>::iterator;
 
+//modules can be instantiated on a background compile thread while the main thread runs and destroys others.
+// Objects of a module being instantiated are not yet reachable from live_modules, so the garbage collector must
+// not run during an instantiation. A collection that finds an instantiation in progress is left pending, and the
+// instantiating thread runs it once its new module is live.
 struct wavm_live_modules {
    live_module_ref add_live_module(ModuleInstance* module_instance) {
+      std::lock_guard<std::mutex> g(live_modules_mtx);
       return live_modules.insert(live_modules.begin(), asObject(module_instance));
    }
 
    void remove_live_module(live_module_ref it) {
-      live_modules.erase(it);
-      run_wavm_garbage_collection();
+      {
+         std::lock_guard<std::mutex> g(live_modules_mtx);
+         live_modules.erase(it);
+      }
+      gc_pending = true;
+      std::unique_lock<std::mutex> instantiate_lock(instantiate_mtx, std::try_to_lock);
+      if(instantiate_lock && gc_pending.exchange(false))
+         run_wavm_garbage_collection();
+   }
+
+   //called by the instantiating thread, with instantiate_mtx held, after its module has been added as live
+   void finish_instantiation(std::unique_lock<std::mutex>& instantiate_lock) {
+      if(gc_pending.exchange(false))
+         run_wavm_garbage_collection();
+      instantiate_lock.unlock();
+      //a module removed after the check above still saw instantiate_mtx held
+      if(gc_pending) {
+         std::unique_lock<std::mutex> gc_lock(instantiate_mtx, std::try_to_lock);
+         if(gc_lock && gc_pending.exchange(false))
+            run_wavm_garbage_collection();
+      }
    }
 
    void run_wavm_garbage_collection() {
       //need to pass in a mutable list of root objects we want the garbage collector to retain
       std::vector<ObjectInstance*> root;
-      std::copy(live_modules.begin(), live_modules.end(), std::back_inserter(root));
+      {
+         std::lock_guard<std::mutex> g(live_modules_mtx);
+         std::copy(live_modules.begin(), live_modules.end(), std::back_inserter(root));
+      }
       Runtime::freeUnreferencedObjects(std::move(root));
    }
 
+   std::mutex                 instantiate_mtx; //held while instantiating a module or collecting garbage
+   std::mutex                 live_modules_mtx;
    std::list<ObjectInstance*> live_modules;
+   std::atomic<bool>          gc_pending{false};
 };
 
 static wavm_live_modules the_wavm_live_modules;
 
+//resets the memory and globals on a background thread once an action returns, so that the next action on the same
+// contract finds them ready instead of resetting them on its critical path. Only used from the main thread
+struct background_reset {
+   ~background_reset() {
+      take(0);
+   }
+
+   //waits for the reset in flight; returns true if it left the memory and globals ready for module_id
+   bool take(uint64_t module_id) {
+      const bool ready = pending.valid() && pending.get() && reset_for == module_id;
+      reset_for = 0;
+      return ready;
+   }
+
+   //called from a scope guard, so it does not throw: if the reset cannot be started, the next action resets on its own
+   template<typename F>
+   void start(uint64_t module_id, F&& reset) noexcept {
+      reset_for = 0;
+      try {
+         if(!thread_pool)
+            thread_pool.emplace( "wasmrst", 1 );
+         pending = async_thread_pool( thread_pool->get_executor(), [reset{std::forward<F>(reset)}]() {
+            try {
+               reset();
+               return true;
+            } catch(...) {
+               //the next action resets on its own and reports the failure
+               return false;
+            }
+         } );
+         reset_for = module_id;
+      } catch( const fc::exception& e ) {
+         wlog( "Could not start the background reset of a contract's memory: ${e}", ("e", e.to_detail_string()) );
+      } catch( const std::exception& e ) {
+         wlog( "Could not start the background reset of a contract's memory: ${e}", ("e", e.what()) );
+      } catch( ... ) {
+         wlog( "Could not start the background reset of a contract's memory" );
+      }
+   }
+
+   fc::optional<named_thread_pool> thread_pool;
+   std::future<bool>               pending;
+   uint64_t                        reset_for = 0;
+};
+
+static background_reset the_background_reset;
+
+static std::atomic<uint64_t> next_module_id{1};
+
 }
 
 class wavm_instantiated_module : public wasm_instantiated_module_interface {
    public:
-      wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem) :
+      wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem, bool inline_checktime) :
          _initial_memory(initial_mem),
          _instance(instance),
-         _module_ref(detail::the_wavm_live_modules.add_live_module(instance))
+         _module_ref(detail::the_wavm_live_modules.add_live_module(instance)),
+         _id(detail::next_module_id++)
       {
+         if(inline_checktime)
+            _deadline_flag = getGlobalI32Address(getInstanceGlobal(_instance, module->globals.size()-1));
+
          //The memory instance is reused across all wavm_instantiated_modules, but for wasm instances
          // that didn't declare "memory", getDefaultMemory() won't see it. It would also be possible
          // to say something like if(module->memories.size()) here I believe
-         if(getDefaultMemory(_instance))
+         if(getDefaultMemory(_instance)) {
             _initial_memory_config = module->memories.defs.at(0).type;
+            //map the initial memory copy-on-write on each reset instead of copying it, where supported
+            if(!_initial_memory.empty()) {
+               _initial_memory_image = createMemoryImage(_initial_memory.data(), _initial_memory.size());
+               if(_initial_memory_image)
+                  std::vector<uint8_t>().swap(_initial_memory);
+            }
+         }
       }
 
       ~wavm_instantiated_module() {
+         if(detail::the_background_reset.reset_for == _id)
+            detail::the_background_reset.take(_id);
+         destroyMemoryImage(_initial_memory_image);
          detail::the_wavm_live_modules.remove_live_module(_module_ref);
       }
 
@@ -93,19 +206,25 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
             //The memory instance is reused across all wavm_instantiated_modules, but for wasm instances
             // that didn't declare "memory", getDefaultMemory() won't see it
             MemoryInstance* default_mem = getDefaultMemory(_instance);
-            if(default_mem) {
-               //reset memory resizes the sandbox'ed memory to the module's init memory size and then
-               // (effectively) memzeros it all
-               resetMemory(default_mem, _initial_memory_config);
-
-               char* memstart = &memoryRef<char>(getDefaultMemory(_instance), 0);
-               memcpy(memstart, _initial_memory.data(), _initial_memory.size());
-            }
+            if(!detail::the_background_reset.take(_id))
+               reset(default_mem);
 
             the_running_instance_context.memory = default_mem;
             the_running_instance_context.apply_ctx = &context;
 
-            resetGlobalInstances(_instance);
+            auto reset_when_done = fc::make_scoped_exit([this, default_mem]() {
+               detail::the_background_reset.start(_id, [this, default_mem]() {
+                  reset(default_mem);
+               });
+            });
+            //the timer raises the deadline global from here on; it may already have expired before
+            if(_deadline_flag) {
+               deadline_timer::expired_flag = _deadline_flag;
+               *_deadline_flag = deadline_timer::expired;
+            }
+            auto unmap_deadline_flag = fc::make_scoped_exit([]() {
+               deadline_timer::expired_flag = nullptr;
+            });
             runInstanceStartFunc(_instance);
             Runtime::invokeFunction(call,args);
          } catch( const wasm_exit& e ) {
@@ -117,23 +236,70 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
          } FC_CAPTURE_AND_RETHROW()
       }
 
+      void reset(MemoryInstance* default_mem) {
+         if(default_mem) {
+            //reset memory resizes the sandbox'ed memory to the module's init memory size and then
+            // (effectively) memzeros it all. With an image, only the pages the previous action dirtied are reset
+            if(_initial_memory_image || _initial_memory.empty()) {
+               resetMemory(default_mem, _initial_memory_config, _initial_memory_image);
+            } else {
+               resetMemory(default_mem, _initial_memory_config);
 
-      std::vector<uint8_t>     _initial_memory;
+               char* memstart = &memoryRef<char>(default_mem, 0);
+               memcpy(memstart, _initial_memory.data(), _initial_memory.size());
+            }
+         }
+         resetGlobalInstances(_instance);
+      }
+
+
+      std::vector<uint8_t>     _initial_memory; //empty once _initial_memory_image holds it
+      MemoryImage*             _initial_memory_image = nullptr;
       //naked pointer because ModuleInstance is opaque
       //_instance is deleted via WAVM's object garbage collection when wavm_rutime is deleted
       ModuleInstance*          _instance;
       detail::live_module_ref  _module_ref;
+      uint64_t                 _id; //identifies this module to the_background_reset
+      volatile I32*            _deadline_flag = nullptr; //the injected deadline global, if checktime is inlined
       MemoryType               _initial_memory_config;
 };
 
-wavm_runtime::wavm_runtime() {
+wavm_runtime::wavm_runtime(const fc::path& code_cache_dir, const string& build_id, bool inline_checktime)
+:_cache_code( !code_cache_dir.empty() )
+,_build_id( inline_checktime ? build_id + "-inline-checktime" : build_id )
+,_inline_checktime( inline_checktime )
+{
    static detail::wavm_runtime_initializer the_wavm_runtime_initializer;
+
+   if( _cache_code ) {
+      static const string binary_hash = detail::runtime_binary_hash();
+      if( binary_hash.empty() ) {
+         wlog( "Not caching compiled contract code, the running binary could not be read to identify the build" );
+         _cache_code = false;
+         return;
+      }
+      //the object cache directory is global to the WAVM runtime, the first runtime that caches code sets it
+      static const string cache_dir = [&code_cache_dir]() {
+         if( !fc::is_directory( code_cache_dir ) )
+            fc::create_directories( code_cache_dir );
+         Runtime::setObjectCacheDirectory( code_cache_dir.generic_string() );
+         return code_cache_dir.generic_string();
+      }();
+      if( cache_dir != code_cache_dir.generic_string() ) {
+         wlog( "Not caching compiled contract code in ${d}, it is already cached in ${c}",
+               ("d", code_cache_dir.generic_string())("c", cache_dir) );
+         _cache_code = false;
+         return;
+      }
+      _build_id = binary_hash + "-" + _build_id;
+   }
 }
 
 wavm_runtime::~wavm_runtime() {
 }
 
-std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) {
+std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory,
+                                                                                     const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version) {
    std::unique_ptr<Module> module = std::make_unique<Module>();
    try {
       Serialization::MemoryInputStream stream((const U8*)code_bytes, code_size);
@@ -146,10 +312,18 @@ std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_mo
 
    eosio::chain::webassembly::common::root_resolver resolver;
    LinkResult link_result = linkModule(*module, resolver);
-   ModuleInstance *instance = instantiateModule(*module, std::move(link_result.resolvedImports));
+   //_build_id identifies the binary, and with it the injection passes and intrinsics the machine code depends on
+   string object_cache_key;
+   if( _cache_code )
+      object_cache_key = fc::sha256::hash( code_hash.str() + "-" + std::to_string(vm_type) + "-" + std::to_string(vm_version) + "-" + _build_id ).str();
+
+   std::unique_lock<std::mutex> instantiate_lock(detail::the_wavm_live_modules.instantiate_mtx);
+   ModuleInstance *instance = instantiateModule(*module, std::move(link_result.resolvedImports), object_cache_key);
    EOS_ASSERT(instance != nullptr, wasm_exception, "Fail to Instantiate WAVM Module");
 
-   return std::make_unique<wavm_instantiated_module>(instance, std::move(module), initial_memory);
+   auto instantiated = std::make_unique<wavm_instantiated_module>(instance, std::move(module), initial_memory, _inline_checktime);
+   detail::the_wavm_live_modules.finish_instantiation(instantiate_lock);
+   return instantiated;
 }
 
 void wavm_runtime::immediately_exit_currently_running_module() {
@@ -94,6 +94,33 @@ namespace Platform
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages);
 
+	// Discards the contents of the specified committed virtual pages without changing their access: anonymous pages
+	// read as zero again, and pages mapped from a page image read as the image again. Only pages that were touched
+	// cost anything to discard.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	PLATFORM_API void discardVirtualPages(U8* baseVirtualAddress,Uptr numPages);
+
+	// Replaces whatever is mapped at the specified virtual pages with fresh anonymous zero pages.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	// Return true if successful, or false if the pages could not be mapped.
+	PLATFORM_API bool remapVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access);
+
+	// An immutable copy of some bytes that can be mapped copy-on-write into virtual address space.
+	struct PageImage;
+
+	// Creates a page image of numBytes bytes of data, padded with zeros to a whole number of pages.
+	// Returns nullptr if page images aren't supported on this platform or the image could not be created.
+	// Only a bounded number of images hold a file descriptor at a time, however many are created.
+	PLATFORM_API PageImage* createPageImage(const U8* data,Uptr numBytes);
+	PLATFORM_API void destroyPageImage(PageImage* image);
+	PLATFORM_API Uptr getPageImageNumPages(const PageImage* image);
+
+	// Maps the image's pages at baseVirtualAddress as private read-write pages, replacing whatever was mapped there.
+	// Writes to the pages are not visible in the image. Pages mapped from an image stay valid after it is destroyed.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	// Return true if successful, or false if the image could not be mapped.
+	PLATFORM_API bool mapPageImage(const PageImage* image,U8* baseVirtualAddress);
+
 	//
 	// Call stack and exceptions
 	//
@@ -168,6 +168,13 @@ namespace Runtime
 
 	// Validates that an offset range is wholly inside a Memory's virtual address range.
 	RUNTIME_API U8* getValidatedMemoryOffsetRange(MemoryInstance* memory,Uptr offset,Uptr numBytes);
+
+	// An immutable copy of a memory's initial contents, that a memory can be reset to copy-on-write.
+	struct MemoryImage;
+
+	// Creates an image of numBytes of initial memory contents. Returns null if images aren't supported on this platform.
+	RUNTIME_API MemoryImage* createMemoryImage(const U8* data,Uptr numBytes);
+	RUNTIME_API void destroyMemoryImage(MemoryImage* image);
 	
 	// Validates an access to a single element of memory at the given offset, and returns a reference to it.
 	template<typename Value> Value& memoryRef(MemoryInstance* memory,U32 offset)
@@ -190,6 +197,10 @@ namespace Runtime
 	// Writes a new value to a global, and returns the previous value.
 	RUNTIME_API Value setGlobalValue(GlobalInstance* global,Value newValue);
 
+	// Gets the address of an i32 global's value. Generated code loads the value from it on each get_global, so it may
+	// be written while the module runs, e.g. by a signal handler.
+	RUNTIME_API volatile I32* getGlobalI32Address(GlobalInstance* global);
+
 	//
 	// Modules
 	//
@@ -203,7 +214,12 @@ namespace Runtime
 	};
 
 	// Instantiates a module, bindings its imports to the specified objects. May throw InstantiationException.
-	RUNTIME_API ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports);
+	// If an object cache directory is set and objectCacheKey is not empty, the module's machine code is loaded from the
+	// cache when it has been compiled before, and written to it otherwise. The key must identify the module's code.
+	RUNTIME_API ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports,const std::string& objectCacheKey = std::string());
+
+	// Sets the directory in which compiled machine code is cached. An empty directory disables the cache.
+	RUNTIME_API void setObjectCacheDirectory(const std::string& directory);
 
 	// Gets the default table/memory for a ModuleInstance.
 	RUNTIME_API MemoryInstance* getDefaultMemory(ModuleInstance* moduleInstance);
@@ -213,6 +229,13 @@ namespace Runtime
 	RUNTIME_API void runInstanceStartFunc(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetGlobalInstances(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
+	// Resets the memory to the minimum size of newMemoryType, with the image's contents at its start and zeros after it.
+	// The image is mapped copy-on-write, so only the pages written since the memory was last reset to the same image
+	// are discarded. A null image resets the memory to all zeros.
+	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType, const MemoryImage* image);
+
+	// Gets a global of a ModuleInstance by index, with the imported globals first. Returns null if out of range.
+	RUNTIME_API GlobalInstance* getInstanceGlobal(ModuleInstance* moduleInstance,Uptr globalIndex);
 
 	// Gets an object exported by a ModuleInstance by name.
 	RUNTIME_API ObjectInstance* getInstanceExport(ModuleInstance* moduleInstance,const std::string& name);
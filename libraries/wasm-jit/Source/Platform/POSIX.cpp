@@ -7,6 +7,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include <errno.h>
 #include <signal.h>
@@ -14,6 +15,7 @@
 #include <sys/resource.h>
 #include <string.h>
 #include <iostream>
+#include <list>
 #include <string>
 
 #include <sys/time.h>
@@ -107,6 +109,138 @@ namespace Platform
 		if(munmap(baseVirtualAddress,numPages << getPageSizeLog2())) { Errors::fatal("munmap failed"); }
 	}
 
+	void discardVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		if(madvise(baseVirtualAddress,numPages << getPageSizeLog2(),MADV_DONTNEED)) { Errors::fatal("madvise failed"); }
+	}
+
+	bool remapVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		auto result = mmap(baseVirtualAddress,numPages << getPageSizeLog2(),memoryAccessAsPOSIXFlag(access),MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,-1,0);
+		return result != MAP_FAILED;
+	}
+
+	// Every image keeps its pages in a memfd, but only the most recently mapped images keep the descriptor open, so
+	// that a process with many modules does not run out of them. A closed image holds its pages through a read-only
+	// shared mapping of the memfd, and copies them to a new memfd when it is mapped again.
+	enum { maxOpenPageImages = 128 };
+
+	struct PageImage
+	{
+		int fd; // -1 while closed
+		Uptr numPages;
+		const U8* pages;
+		std::list<PageImage*>::iterator openItr;
+	};
+
+	static Mutex* getPageImagesMutex()
+	{
+		static Mutex* mutex = createMutex();
+		return mutex;
+	}
+
+	// The images with an open descriptor, the most recently mapped first.
+	static std::list<PageImage*> openPageImages;
+
+	static int createPageImageFile(const U8* data,Uptr numBytes,Uptr numPages)
+	{
+		#if defined(__linux__) && defined(SYS_memfd_create)
+			int fd = (int)syscall(SYS_memfd_create,"wasm-memory-image",0);
+			if(fd < 0) { return -1; }
+			// The file is zero filled up to its size, so only the data itself needs to be written.
+			bool ok = ftruncate(fd,numPages << getPageSizeLog2()) == 0;
+			for(Uptr offset = 0;ok && offset < numBytes;)
+			{
+				auto written = pwrite(fd,data + offset,numBytes - offset,offset);
+				if(written < 0 && errno == EINTR) { continue; }
+				ok = written > 0;
+				if(ok) { offset += written; }
+			}
+			if(!ok) { close(fd); return -1; }
+			return fd;
+		#else
+			return -1;
+		#endif
+	}
+
+	// Must be called with the page images mutex locked.
+	static void closeLeastRecentlyMappedPageImages()
+	{
+		while(openPageImages.size() > maxOpenPageImages)
+		{
+			PageImage* image = openPageImages.back();
+			openPageImages.pop_back();
+			close(image->fd);
+			image->fd = -1;
+		}
+	}
+
+	PageImage* createPageImage(const U8* data,Uptr numBytes)
+	{
+		const Uptr numPages = (numBytes + (Uptr(1) << getPageSizeLog2()) - 1) >> getPageSizeLog2();
+		if(!numPages) { return nullptr; }
+		int fd = createPageImageFile(data,numBytes,numPages);
+		if(fd < 0) { return nullptr; }
+		void* pages = mmap(nullptr,numPages << getPageSizeLog2(),PROT_READ,MAP_SHARED,fd,0);
+		if(pages == MAP_FAILED) { close(fd); return nullptr; }
+
+		auto image = new PageImage {fd,numPages,(const U8*)pages,{}};
+		Lock lock(getPageImagesMutex());
+		image->openItr = openPageImages.insert(openPageImages.begin(),image);
+		closeLeastRecentlyMappedPageImages();
+		return image;
+	}
+
+	void destroyPageImage(PageImage* image)
+	{
+		if(!image) { return; }
+		{
+			Lock lock(getPageImagesMutex());
+			if(image->fd >= 0)
+			{
+				openPageImages.erase(image->openItr);
+				close(image->fd);
+			}
+		}
+		munmap((void*)image->pages,image->numPages << getPageSizeLog2());
+		delete image;
+	}
+
+	Uptr getPageImageNumPages(const PageImage* image)
+	{
+		return image ? image->numPages : 0;
+	}
+
+	bool mapPageImage(const PageImage* constImage,U8* baseVirtualAddress)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		if(!constImage->numPages) { return true; }
+
+		// Only the descriptor changes, the pages of an image stay the same.
+		PageImage* image = const_cast<PageImage*>(constImage);
+		const Uptr numBytes = image->numPages << getPageSizeLog2();
+		Lock lock(getPageImagesMutex());
+		if(image->fd < 0)
+		{
+			int fd = createPageImageFile(image->pages,numBytes,image->numPages);
+			if(fd < 0) { return false; }
+			void* pages = mmap(nullptr,numBytes,PROT_READ,MAP_SHARED,fd,0);
+			if(pages == MAP_FAILED) { close(fd); return false; }
+			// Hold the pages through the new memfd, so that the old one is freed.
+			munmap((void*)image->pages,numBytes);
+			image->pages = (const U8*)pages;
+			image->fd = fd;
+			image->openItr = openPageImages.insert(openPageImages.begin(),image);
+			closeLeastRecentlyMappedPageImages();
+		}
+		else { openPageImages.splice(openPageImages.begin(),openPageImages,image->openItr); }
+
+		auto result = mmap(baseVirtualAddress,numBytes,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_FIXED,image->fd,0);
+		return result != MAP_FAILED;
+	}
+
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription)
 	{
 		#if defined __linux__ || defined __FreeBSD__
@@ -85,6 +85,26 @@ namespace Platform
 		if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_RELEASE) failed"); }
 	}
 
+	void discardVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		memset(baseVirtualAddress,0,numPages << getPageSizeLog2());
+	}
+
+	bool remapVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		decommitVirtualPages(baseVirtualAddress,numPages);
+		return access == MemoryAccess::None || commitVirtualPages(baseVirtualAddress,numPages,access);
+	}
+
+	// Page images aren't supported on Windows; callers fall back to copying.
+	struct PageImage {};
+	PageImage* createPageImage(const U8* data,Uptr numBytes) { return nullptr; }
+	void destroyPageImage(PageImage* image) {}
+	Uptr getPageImageNumPages(const PageImage* image) { return 0; }
+	bool mapPageImage(const PageImage* image,U8* baseVirtualAddress) { return false; }
+
 	// The interface to the DbgHelp DLL
 	struct DbgHelp
 	{
@@ -43,6 +43,14 @@ namespace LLVMJIT
 
 		}
 		llvm::Module* emit();
+
+		// Emits a reference to an external symbol, which is bound to an address when the object code is loaded.
+		llvm::Constant* emitExternalPointer(const std::string& symbolName,llvm::Type* type)
+		{
+			llvm::GlobalVariable* global = llvmModule->getNamedGlobal(symbolName);
+			if(!global) { global = new llvm::GlobalVariable(*llvmModule,llvmI8Type,true,llvm::GlobalVariable::ExternalLinkage,nullptr,symbolName); }
+			return llvm::ConstantExpr::getPointerCast(global,type);
+		}
 	};
 
 	// The context used by functions involved in JITing a single AST function.
@@ -287,7 +295,9 @@ namespace LLVMJIT
 			WAVM_ASSERT_THROW(intrinsicObject);
 			FunctionInstance* intrinsicFunction = asFunction(intrinsicObject);
 			WAVM_ASSERT_THROW(intrinsicFunction->type == intrinsicType);
-			auto intrinsicFunctionPointer = emitLiteralPointer(intrinsicFunction->nativeFunction,asLLVMType(intrinsicType)->getPointerTo());
+			auto intrinsicFunctionPointer = moduleContext.emitExternalPointer(
+				intrinsicSymbolPrefix + Intrinsics::getDecoratedName(intrinsicName,intrinsicType),
+				asLLVMType(intrinsicType)->getPointerTo());
 			return irBuilder.CreateCall(intrinsicFunctionPointer,llvm::ArrayRef<llvm::Value*>(args.begin(),args.end()));
 		}
 
@@ -668,7 +678,7 @@ namespace LLVMJIT
 			// Load the type for this table entry.
 			auto functionTypePointerPointer = irBuilder.CreateInBoundsGEP(moduleContext.defaultTablePointer,{functionIndexZExt,emitLiteral((U32)0)});
 			auto functionTypePointer = irBuilder.CreateLoad(functionTypePointerPointer);
-			auto llvmCalleeType = emitLiteralPointer(calleeType,llvmI8PtrType);
+			auto llvmCalleeType = moduleContext.emitExternalPointer(functionTypeSymbolPrefix + std::to_string(imm.type.index),llvmI8PtrType);
 			
 			// If the function type doesn't match, trap.
 			emitConditionalTrapIntrinsic(
@@ -677,7 +687,7 @@ namespace LLVMJIT
 				FunctionType::get(ResultType::none,{ValueType::i32,ValueType::i64,ValueType::i64}),
 				{	tableElementIndex,
 					irBuilder.CreatePtrToInt(llvmCalleeType,llvmI64Type),
-					emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultTable))	}
+					moduleContext.emitExternalPointer(defaultTableSymbol,llvmI64Type)	}
 				);
 
 			// Call the function loaded from the table.
@@ -731,7 +741,7 @@ namespace LLVMJIT
 		void grow_memory(MemoryImm)
 		{
 			auto deltaNumPages = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitExternalPointer(defaultMemorySymbol,llvmI64Type);
 			auto previousNumPages = emitRuntimeIntrinsic(
 				"wavmIntrinsics.growMemory",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i64}),
@@ -740,7 +750,7 @@ namespace LLVMJIT
 		}
 		void current_memory(MemoryImm)
 		{
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitExternalPointer(defaultMemorySymbol,llvmI64Type);
 			auto currentNumPages = emitRuntimeIntrinsic(
 				"wavmIntrinsics.currentMemory",
 				FunctionType::get(ResultType::i32,{ValueType::i64}),
@@ -1215,7 +1225,7 @@ namespace LLVMJIT
 		{
 			auto numWaiters = pop();
 			auto address = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitExternalPointer(defaultMemorySymbol,llvmI64Type);
 			push(emitRuntimeIntrinsic(
 				"wavmIntrinsics.wake",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i32,ValueType::i64}),
@@ -1226,7 +1236,7 @@ namespace LLVMJIT
 			auto timeout = pop();
 			auto expectedValue = pop();
 			auto address = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitExternalPointer(defaultMemorySymbol,llvmI64Type);
 			push(emitRuntimeIntrinsic(
 				"wavmIntrinsics.wait",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i32,ValueType::f64,ValueType::i64}),
@@ -1237,7 +1247,7 @@ namespace LLVMJIT
 			auto timeout = pop();
 			auto expectedValue = pop();
 			auto address = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitExternalPointer(defaultMemorySymbol,llvmI64Type);
 			push(emitRuntimeIntrinsic(
 				"wavmIntrinsics.wait",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i64,ValueType::f64,ValueType::i64}),
@@ -1250,7 +1260,7 @@ namespace LLVMJIT
 			auto errorFunctionIndex = pop();
 			auto argument = pop();
 			auto functionIndex = pop();
-			auto defaultTableAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultTable));
+			auto defaultTableAsI64 = moduleContext.emitExternalPointer(defaultTableSymbol,llvmI64Type);
 			emitRuntimeIntrinsic(
 				"wavmIntrinsics.launchThread",
 				FunctionType::get(ResultType::none,{ValueType::i32,ValueType::i32,ValueType::i32,ValueType::i64}),
@@ -1543,7 +1553,7 @@ namespace LLVMJIT
 		// Create literals for the default memory base and mask.
 		if(moduleInstance->defaultMemory)
 		{
-			defaultMemoryBase = emitLiteralPointer(moduleInstance->defaultMemory->baseAddress,llvmI8PtrType);
+			defaultMemoryBase = emitExternalPointer(defaultMemoryBaseSymbol,llvmI8PtrType);
 			const Uptr defaultMemoryEndOffsetValue = Uptr(moduleInstance->defaultMemory->endOffset);
 			defaultMemoryEndOffset = emitLiteral(defaultMemoryEndOffsetValue);
 		}
@@ -1556,7 +1566,7 @@ namespace LLVMJIT
 				llvmI8PtrType,
 				llvmI8PtrType
 				});
-			defaultTablePointer = emitLiteralPointer(moduleInstance->defaultTable->baseAddress,tableElementType->getPointerTo());
+			defaultTablePointer = emitExternalPointer(defaultTableBaseSymbol,tableElementType->getPointerTo());
 			defaultTableMaxElementIndex = emitLiteral(((Uptr)moduleInstance->defaultTable->endOffset)/sizeof(TableInstance::FunctionElement));
 		}
 		else
@@ -1568,12 +1578,15 @@ namespace LLVMJIT
 		for(Uptr functionIndex = 0;functionIndex < module.functions.imports.size();++functionIndex)
 		{
 			const FunctionInstance* functionInstance = moduleInstance->functions[functionIndex];
-			importedFunctionPointers.push_back(emitLiteralPointer(functionInstance->nativeFunction,asLLVMType(functionInstance->type)->getPointerTo()));
+			importedFunctionPointers.push_back(emitExternalPointer(importedFunctionSymbolPrefix + std::to_string(functionIndex),asLLVMType(functionInstance->type)->getPointerTo()));
 		}
 
 		// Create LLVM pointer constants for the module's globals.
-		for(auto global : moduleInstance->globals)
-		{ globalPointers.push_back(emitLiteralPointer(&global->value,asLLVMType(global->type.valueType)->getPointerTo())); }
+		for(Uptr globalIndex = 0;globalIndex < moduleInstance->globals.size();++globalIndex)
+		{
+			const GlobalInstance* global = moduleInstance->globals[globalIndex];
+			globalPointers.push_back(emitExternalPointer(globalSymbolPrefix + std::to_string(globalIndex),asLLVMType(global->type.valueType)->getPointerTo()));
+		}
 		
 		// Create the LLVM functions.
 		functionDefs.resize(module.functions.defs.size());
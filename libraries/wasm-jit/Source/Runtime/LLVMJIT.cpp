@@ -4,6 +4,9 @@
 #include "Logging/Logging.h"
 #include "RuntimePrivate.h"
 #include "IR/Validate.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #ifdef _DEBUG
 	// This needs to be 1 to allow debuggers such as Visual Studio to place breakpoints and step through the JITed code.
@@ -51,7 +54,18 @@ namespace LLVMJIT
 	#endif
 
 	llvm::Constant* typedZeroConstants[(Uptr)ValueType::num];
+
+	// The directory compiled module object code is cached in, or empty if it is not cached.
+	std::string objectCacheDirectory;
+
+	// Increment when the generated code or the external symbols it references change, so that object code cached by an
+	// older build is not loaded.
+	static const U32 objectCacheFormatVersion = 1;
 	
+	// Serializes use of the LLVM context, so a module may be compiled on a background thread while invoke thunks are
+	// compiled on the thread running WebAssembly code.
+	Platform::Mutex* compileMutex = Platform::createMutex();
+
 	// A map from address to loaded JIT symbols.
 	Platform::Mutex* addressToSymbolMapMutex = Platform::createMutex();
 	std::map<Uptr,struct JITSymbol*> addressToSymbolMap;
@@ -221,21 +235,28 @@ namespace LLVMJIT
 		{
 			objectLayer = llvm::make_unique<ObjectLayer>(NotifyLoadedFunctor(this),NotifyFinalizedFunctor(this));
 			objectLayer->setProcessAllSections(true);
-			compileLayer = llvm::make_unique<CompileLayer>(*objectLayer,llvm::orc::SimpleCompiler(*targetMachine));
 		}
 		~JITUnit()
 		{
 			if(handleIsValid)
-				compileLayer->removeModuleSet(handle);
+				objectLayer->removeObjectSet(handle);
 			#ifdef _WIN64
 				if(pdataCopy) { Platform::deregisterSEHUnwindInfo(reinterpret_cast<Uptr>(pdataCopy)); }
 			#endif
 		}
 
-		void compile(llvm::Module* llvmModule);
+		// Compiles a LLVM module and loads the resulting object code. If objectCachePath isn't empty, the object code is
+		// also written to it.
+		void compile(llvm::Module* llvmModule,const std::string& objectCachePath = std::string());
+
+		// Loads object code previously written by compile. Returns false if there is no valid object code at the path.
+		bool loadCachedObject(const std::string& objectCachePath);
 
 		virtual void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,std::map<U32,U32>&& offsetToOpIndexMap) = 0;
 
+		// The resolver for the external symbols referenced by the unit's object code.
+		virtual llvm::JITSymbolResolver* getSymbolResolver();
+
 	private:
 		
 		// Functor that receives notifications when an object produced by the JIT is loaded.
@@ -258,12 +279,13 @@ namespace LLVMJIT
 			void operator()(const llvm::orc::ObjectLinkingLayerBase::ObjSetHandleT& objectSetHandle);
 		};
 		typedef llvm::orc::ObjectLinkingLayer<NotifyLoadedFunctor> ObjectLayer;
-		typedef llvm::orc::IRCompileLayer<ObjectLayer> CompileLayer;
+		typedef std::vector<std::unique_ptr<llvm::object::OwningBinary<llvm::object::ObjectFile>>> ObjectSet;
+
+		void load(ObjectSet&& objectSet);
 
 		UnitMemoryManager memoryManager;
 		std::unique_ptr<ObjectLayer> objectLayer;
-		std::unique_ptr<CompileLayer> compileLayer;
-		CompileLayer::ModuleSetHandleT handle;
+		ObjectLayer::ObjSetHandleT handle;
 		bool handleIsValid = false;
 		bool shouldLogMetrics;
 
@@ -280,18 +302,33 @@ namespace LLVMJIT
 		#endif
 	};
 
+	// Binds the external symbols referenced by a module's object code to the addresses of a module instance.
+	struct ModuleSymbolResolver : llvm::JITSymbolResolver
+	{
+		std::vector<const FunctionType*> types;
+		ModuleInstance* moduleInstance;
+
+		ModuleSymbolResolver(const IR::Module& module,ModuleInstance* inModuleInstance): types(module.types), moduleInstance(inModuleInstance) {}
+
+		virtual llvm::JITSymbol findSymbol(const std::string& name) override;
+		virtual llvm::JITSymbol findSymbolInLogicalDylib(const std::string& name) override;
+	};
+
 	// The JIT compilation unit for a WebAssembly module instance.
 	struct JITModule : JITUnit, JITModuleBase
 	{
 		ModuleInstance* moduleInstance;
+		ModuleSymbolResolver symbolResolver;
 
 		std::vector<JITSymbol*> functionDefSymbols;
 
-		JITModule(ModuleInstance* inModuleInstance): moduleInstance(inModuleInstance) {}
+		JITModule(const IR::Module& module,ModuleInstance* inModuleInstance): moduleInstance(inModuleInstance), symbolResolver(module,inModuleInstance) {}
 		~JITModule() override
 		{
 		}
 
+		llvm::JITSymbolResolver* getSymbolResolver() override { return &symbolResolver; }
+
 		void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,std::map<U32,U32>&& offsetToOpIndexMap) override
 		{
 			// Save the address range this function was loaded at for future address->symbol lookups.
@@ -374,6 +411,48 @@ namespace LLVMJIT
 	}
 	llvm::JITSymbol NullResolver::findSymbolInLogicalDylib(const std::string& name) { return llvm::JITSymbol(nullptr); }
 
+	llvm::JITSymbolResolver* JITUnit::getSymbolResolver() { return &NullResolver::singleton; }
+
+	// Parses the index from a symbol name of the form <prefix><index>.
+	static bool getSymbolIndex(const std::string& name,const char* prefix,Uptr& outIndex)
+	{
+		const Uptr numPrefixChars = strlen(prefix);
+		if(name.compare(0,numPrefixChars,prefix) || name.size() == numPrefixChars) { return false; }
+		char* numberEnd = nullptr;
+		outIndex = Uptr(std::strtoull(name.c_str() + numPrefixChars,&numberEnd,10));
+		return *numberEnd == 0;
+	}
+
+	llvm::JITSymbol ModuleSymbolResolver::findSymbol(const std::string& decoratedName)
+	{
+		#if defined(_WIN32) && !defined(_WIN64)
+			const std::string name = decoratedName.size() && decoratedName[0] == '_' ? decoratedName.substr(1) : decoratedName;
+		#else
+			const std::string& name = decoratedName;
+		#endif
+
+		const void* address = nullptr;
+		Uptr index;
+		if(name == defaultMemoryBaseSymbol && moduleInstance->defaultMemory) { address = moduleInstance->defaultMemory->baseAddress; }
+		else if(name == defaultMemorySymbol && moduleInstance->defaultMemory) { address = moduleInstance->defaultMemory; }
+		else if(name == defaultTableBaseSymbol && moduleInstance->defaultTable) { address = moduleInstance->defaultTable->baseAddress; }
+		else if(name == defaultTableSymbol && moduleInstance->defaultTable) { address = moduleInstance->defaultTable; }
+		else if(getSymbolIndex(name,importedFunctionSymbolPrefix,index) && index < moduleInstance->functions.size())
+		{ address = moduleInstance->functions[index]->nativeFunction; }
+		else if(getSymbolIndex(name,globalSymbolPrefix,index) && index < moduleInstance->globals.size())
+		{ address = &moduleInstance->globals[index]->value; }
+		else if(getSymbolIndex(name,functionTypeSymbolPrefix,index) && index < types.size()) { address = types[index]; }
+		else if(!name.compare(0,strlen(intrinsicSymbolPrefix),intrinsicSymbolPrefix))
+		{
+			FunctionInstance* intrinsicFunction = Intrinsics::findFunction(name.substr(strlen(intrinsicSymbolPrefix)));
+			if(intrinsicFunction) { address = intrinsicFunction->nativeFunction; }
+		}
+
+		if(address) { return llvm::JITSymbol(reinterpret_cast<Uptr>(address),llvm::JITSymbolFlags::None); }
+		return NullResolver::singleton.findSymbol(decoratedName);
+	}
+	llvm::JITSymbol ModuleSymbolResolver::findSymbolInLogicalDylib(const std::string& name) { return llvm::JITSymbol(nullptr); }
+
 	void JITUnit::NotifyLoadedFunctor::operator()(
 		const llvm::orc::ObjectLinkingLayerBase::ObjSetHandleT& objectSetHandle,
 		const std::vector<std::unique_ptr<llvm::object::OwningBinary<llvm::object::ObjectFile>>>& objectSet,
@@ -517,6 +596,32 @@ namespace LLVMJIT
 		jitUnit->loadedObjects.clear();
 	}
 
+	static void writeCachedObject(const std::string& path,llvm::MemoryBufferRef object)
+	{
+		// Write to a temporary file and rename it, so a partially written object is never found at the cached path.
+		const std::string tempPath = path + ".tmp";
+		std::error_code errorCode;
+		{
+			llvm::raw_fd_ostream stream(tempPath,errorCode,llvm::sys::fs::F_None);
+			if(!errorCode)
+			{
+				stream.write(object.getBufferStart(),object.getBufferSize());
+				stream.close();
+				if(stream.has_error())
+				{
+					errorCode = std::make_error_code(std::errc::io_error);
+					stream.clear_error();
+				}
+			}
+		}
+		if(!errorCode) { errorCode = llvm::sys::fs::rename(tempPath,path); }
+		if(errorCode)
+		{
+			Log::printf(Log::Category::error,"Failed to write cached object %s: %s\n",path.c_str(),errorCode.message().c_str());
+			llvm::sys::fs::remove(tempPath);
+		}
+	}
+
 	static Uptr printedModuleId = 0;
 
 	void printModule(const llvm::Module* llvmModule,const char* filename)
@@ -528,7 +633,7 @@ namespace LLVMJIT
 		Log::printf(Log::Category::debug,"Dumped LLVM module to: %s\n",augmentedFilename.c_str());
 	}
 
-	void JITUnit::compile(llvm::Module* llvmModule)
+	void JITUnit::compile(llvm::Module* llvmModule,const std::string& objectCachePath)
 	{
 		// Get a target machine object for this host, and set the module to use its data layout.
 		llvmModule->setDataLayout(targetMachine->createDataLayout());
@@ -566,14 +671,10 @@ namespace LLVMJIT
 
 		if(DUMP_OPTIMIZED_MODULE) { printModule(llvmModule,"llvmOptimizedDump"); }
 
-		// Pass the module to the JIT compiler.
+		// Generate machine code for the module.
 		Timing::Timer machineCodeTimer;
-		handle = compileLayer->addModuleSet(
-			std::vector<llvm::Module*>{llvmModule},
-			&memoryManager,
-			&NullResolver::singleton);
-		handleIsValid = true;
-		compileLayer->emitAndFinalize(handle);
+		auto object = llvm::make_unique<llvm::object::OwningBinary<llvm::object::ObjectFile>>(
+			llvm::orc::SimpleCompiler(*targetMachine)(*llvmModule));
 
 		if(shouldLogMetrics)
 		{
@@ -581,19 +682,70 @@ namespace LLVMJIT
 		}
 
 		delete llvmModule;
+
+		if(objectCachePath.size() && object->getBinary()) { writeCachedObject(objectCachePath,object->getBinary()->getMemoryBufferRef()); }
+
+		ObjectSet objectSet;
+		objectSet.push_back(std::move(object));
+		load(std::move(objectSet));
 	}
 
-	void instantiateModule(const IR::Module& module,ModuleInstance* moduleInstance)
+	bool JITUnit::loadCachedObject(const std::string& objectCachePath)
 	{
-		// Emit LLVM IR for the module.
-		auto llvmModule = emitModule(module,moduleInstance);
+		// Files large enough for it to pay off are mapped rather than read. The object's sections are copied into the
+		// unit's image when it is loaded.
+		auto buffer = llvm::MemoryBuffer::getFile(objectCachePath,-1,false);
+		if(!buffer) { return false; }
+
+		auto object = llvm::object::ObjectFile::createObjectFile((*buffer)->getMemBufferRef());
+		if(!object)
+		{
+			Log::printf(Log::Category::error,"Ignoring invalid cached object %s: %s\n",objectCachePath.c_str(),llvm::toString(object.takeError()).c_str());
+			return false;
+		}
+
+		ObjectSet objectSet;
+		objectSet.push_back(llvm::make_unique<llvm::object::OwningBinary<llvm::object::ObjectFile>>(std::move(*object),std::move(*buffer)));
+		load(std::move(objectSet));
+		return true;
+	}
+
+	void JITUnit::load(ObjectSet&& objectSet)
+	{
+		handle = objectLayer->addObjectSet(std::move(objectSet),&memoryManager,getSymbolResolver());
+		handleIsValid = true;
+		objectLayer->emitAndFinalize(handle);
+	}
+
+	void setObjectCacheDirectory(const std::string& directory)
+	{
+		objectCacheDirectory = directory;
+	}
+
+	// The object code depends on the LLVM version and target, as well as on the module code identified by the key.
+	static std::string getObjectCachePath(const std::string& objectCacheKey)
+	{
+		if(objectCacheDirectory.empty() || objectCacheKey.empty()) { return std::string(); }
+		return objectCacheDirectory + "/" + objectCacheKey
+			+ "-" + targetMachine->getTargetTriple().str()
+			+ "-llvm" LLVM_VERSION_STRING
+			+ "-v" + std::to_string(objectCacheFormatVersion) + ".o";
+	}
+
+	void instantiateModule(const IR::Module& module,ModuleInstance* moduleInstance,const std::string& objectCacheKey)
+	{
+		Platform::Lock compileLock(compileMutex);
 
 		// Construct the JIT compilation pipeline for this module.
-		auto jitModule = new JITModule(moduleInstance);
+		auto jitModule = new JITModule(module,moduleInstance);
 		moduleInstance->jitModule = jitModule;
 
-		// Compile the module.
-		jitModule->compile(llvmModule);
+		// Load the module's object code if it was cached, otherwise emit LLVM IR for the module and compile it.
+		const std::string objectCachePath = getObjectCachePath(objectCacheKey);
+		if(objectCachePath.size() && jitModule->loadCachedObject(objectCachePath)) { return; }
+
+		auto llvmModule = emitModule(module,moduleInstance);
+		jitModule->compile(llvmModule,objectCachePath);
 	}
 
 	std::string getExternalFunctionName(ModuleInstance* moduleInstance,Uptr functionDefIndex)
@@ -659,6 +811,8 @@ namespace LLVMJIT
 
 	InvokeFunctionPointer getInvokeThunk(const FunctionType* functionType)
 	{
+		Platform::Lock compileLock(compileMutex);
+
 		// Reuse cached invoke thunks for the same function type.
 		auto mapIt = invokeThunkTypeToSymbolMap.find(functionType);
 		if(mapIt != invokeThunkTypeToSymbolMap.end()) { return reinterpret_cast<InvokeFunctionPointer>(mapIt->second->baseAddress); }
@@ -123,6 +123,19 @@ namespace LLVMJIT
 	std::string getExternalFunctionName(ModuleInstance* moduleInstance,Uptr functionDefIndex);
 	bool getFunctionIndexFromExternalName(const char* externalName,Uptr& outFunctionDefIndex);
 
+	// Compiled code references the addresses that are specific to a module instance or to the process (the default
+	// memory and table, imported functions, globals, the signatures of indirect calls and the WAVM intrinsics) through
+	// external symbols with these names rather than literal pointers. That keeps the object code independent of the
+	// instance it was compiled for, so it can be cached and loaded into another instance or process.
+	static const char defaultMemoryBaseSymbol[] = "wavmDefaultMemoryBase";
+	static const char defaultMemorySymbol[] = "wavmDefaultMemory";
+	static const char defaultTableBaseSymbol[] = "wavmDefaultTableBase";
+	static const char defaultTableSymbol[] = "wavmDefaultTable";
+	static const char importedFunctionSymbolPrefix[] = "wavmImport";
+	static const char globalSymbolPrefix[] = "wavmGlobal";
+	static const char functionTypeSymbolPrefix[] = "wavmType";
+	static const char intrinsicSymbolPrefix[] = "wavmIntrinsic:";
+
 	// Emits LLVM IR for a module.
 	llvm::Module* emitModule(const IR::Module& module,ModuleInstance* moduleInstance);
 }
@@ -3,6 +3,8 @@
 #include "Platform/Platform.h"
 #include "RuntimePrivate.h"
 
+#include <algorithm>
+
 namespace Runtime
 {
 	// Global lists of memories; used to query whether an address is reserved by one of them.
@@ -88,7 +90,85 @@ namespace Runtime
 		return Uptr(memory->type.size.max);
 	}
 
+	// Replaces the pages mapped from a memory image with anonymous pages, which read as zero.
+	static void unmapMemoryImage(MemoryInstance* memory,Uptr firstPlatformPage = 0)
+	{
+		if(memory->mappedImageNumPlatformPages > firstPlatformPage)
+		{
+			if(!Platform::remapVirtualPages(
+				memory->baseAddress + (firstPlatformPage << Platform::getPageSizeLog2()),
+				memory->mappedImageNumPlatformPages - firstPlatformPage,
+				Platform::MemoryAccess::ReadWrite
+				))
+			{
+				causeException(Exception::Cause::outOfMemory);
+			}
+		}
+		memory->mappedImageId = 0;
+		memory->mappedImageNumPlatformPages = 0;
+	}
+
+	MemoryImage* createMemoryImage(const U8* data,Uptr numBytes)
+	{
+		static std::atomic<U64> nextMemoryImageId(1);
+
+		Platform::PageImage* pageImage = Platform::createPageImage(data,numBytes);
+		if(!pageImage) { return nullptr; }
+		return new MemoryImage {pageImage,nextMemoryImageId++};
+	}
+
+	void destroyMemoryImage(MemoryImage* image)
+	{
+		if(!image) { return; }
+		Platform::destroyPageImage(image->pageImage);
+		delete image;
+	}
+
+	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType, const MemoryImage* image)
+	{
+		const Uptr pageSizeLog2 = Platform::getPageSizeLog2();
+		const Uptr imageNumPlatformPages = image ? Platform::getPageImageNumPages(image->pageImage) : 0;
+		const Uptr imageBytes = imageNumPlatformPages << pageSizeLog2;
+		const Uptr previousBytes = memory->numPages << IR::numBytesPerPageLog2;
+		const Uptr newBytes = Uptr(newMemoryType.size.min) << IR::numBytesPerPageLog2;
+		errorUnless(imageBytes <= newBytes);
+
+		// Restore the image at the start of the memory. If it is still mapped there, discarding the pages written since
+		// the last reset brings back the image's contents.
+		if(image && memory->mappedImageId == image->id) { Platform::discardVirtualPages(memory->baseAddress,imageNumPlatformPages); }
+		else
+		{
+			unmapMemoryImage(memory,imageNumPlatformPages);
+			if(image)
+			{
+				if(!Platform::mapPageImage(image->pageImage,memory->baseAddress)) { causeException(Exception::Cause::outOfMemory); }
+				memory->mappedImageId = image->id;
+				memory->mappedImageNumPlatformPages = imageNumPlatformPages;
+			}
+		}
+
+		// Zero what was written after the image, and resize the memory. Pages past the previous size were decommitted,
+		// so they already read as zero.
+		const Uptr keptBytes = std::min(previousBytes,newBytes);
+		if(keptBytes > imageBytes) { Platform::discardVirtualPages(memory->baseAddress + imageBytes,(keptBytes - imageBytes) >> pageSizeLog2); }
+		if(newBytes > previousBytes)
+		{
+			if(!Platform::commitVirtualPages(memory->baseAddress + previousBytes,(newBytes - previousBytes) >> pageSizeLog2))
+			{
+				causeException(Exception::Cause::outOfMemory);
+			}
+		}
+		else if(newBytes < previousBytes)
+		{
+			Platform::decommitVirtualPages(memory->baseAddress + newBytes,(previousBytes - newBytes) >> pageSizeLog2);
+		}
+
+		memory->type = newMemoryType;
+		memory->numPages = newMemoryType.size.min;
+	}
+
 	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType) {
+		unmapMemoryImage(memory);
 		memory->type.size.min = 1;
 		if(shrinkMemory(memory, memory->numPages - 1) == -1)
 			causeException(Exception::Cause::outOfMemory);
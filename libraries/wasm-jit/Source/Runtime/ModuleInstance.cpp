@@ -30,7 +30,7 @@ namespace Runtime
 
 	MemoryInstance* MemoryInstance::theMemoryInstance = nullptr;
 
-	ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports)
+	ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports,const std::string& objectCacheKey)
 	{
 		ModuleInstance* moduleInstance = new ModuleInstance(
 			std::move(imports.functions),
@@ -74,10 +74,8 @@ namespace Runtime
 		}
 		for(const MemoryDef& memoryDef : module.memories.defs)
 		{
-			if(!MemoryInstance::theMemoryInstance) {
-				MemoryInstance::theMemoryInstance = createMemory(memoryDef.type);
-				if(!MemoryInstance::theMemoryInstance) { causeException(Exception::Cause::outOfMemory); }
-			}
+			// The shared memory is created by Runtime::init, so instantiating on several threads never races to create it.
+			errorUnless(MemoryInstance::theMemoryInstance);
 			moduleInstance->memories.push_back(MemoryInstance::theMemoryInstance);
 		}
 
@@ -130,7 +128,7 @@ namespace Runtime
 		}
 
 		// Generate machine code for the module.
-		LLVMJIT::instantiateModule(module,moduleInstance);
+		LLVMJIT::instantiateModule(module,moduleInstance,objectCacheKey);
 
 		// Set up the instance's exports.
 		for(const Export& exportIt : module.exports)
@@ -195,6 +193,11 @@ namespace Runtime
 			memcpy(&gi->value, &gi->initialValue, sizeof(gi->value));
 	}
 	
+	GlobalInstance* getInstanceGlobal(ModuleInstance* moduleInstance,Uptr globalIndex)
+	{
+		return globalIndex < moduleInstance->globals.size() ? moduleInstance->globals[globalIndex] : nullptr;
+	}
+
 	ObjectInstance* getInstanceExport(ModuleInstance* moduleInstance,const std::string& name)
 	{
 		auto mapIt = moduleInstance->exportMap.find(name);
@@ -43,6 +43,9 @@ namespace Runtime
 		// Gather GC roots from running WASM threads.
 		getThreadGCRoots(rootObjectReferences);
 
+		// The shared memory outlives the modules that reference it, so it is always a root.
+		if(MemoryInstance::theMemoryInstance) { rootObjectReferences.push_back(MemoryInstance::theMemoryInstance); }
+
 		// Initialize the referencedObjects set from the rootObjectReferences and intrinsic objects.
 		for(auto object : rootObjectReferences)
 		{
@@ -12,6 +12,18 @@ namespace Runtime
 	{
 		LLVMJIT::init();
 		initWAVMIntrinsics();
+
+		// Every module shares one memory instance; the size it is created with is replaced by resetMemory before each call.
+		if(!MemoryInstance::theMemoryInstance)
+		{
+			MemoryInstance::theMemoryInstance = createMemory(IR::MemoryType(false,{1,UINT64_MAX}));
+			if(!MemoryInstance::theMemoryInstance) { causeException(Exception::Cause::outOfMemory); }
+		}
+	}
+
+	void setObjectCacheDirectory(const std::string& directory)
+	{
+		LLVMJIT::setObjectCacheDirectory(directory);
 	}
 	
 	// Returns a vector of strings, each element describing a frame of the call stack.
@@ -154,4 +166,10 @@ namespace Runtime
 		global->value = newValue;
 		return previousValue;
 	}
+
+	volatile I32* getGlobalI32Address(GlobalInstance* global)
+	{
+		WAVM_ASSERT_THROW(global->type.valueType == ValueType::i32);
+		return &global->value.i32;
+	}
 }
@@ -20,7 +20,8 @@ namespace LLVMJIT
 	};
 
 	void init();
-	void instantiateModule(const IR::Module& module,Runtime::ModuleInstance* moduleInstance);
+	void setObjectCacheDirectory(const std::string& directory);
+	void instantiateModule(const IR::Module& module,Runtime::ModuleInstance* moduleInstance,const std::string& objectCacheKey);
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription);
 	
 	typedef void (*InvokeFunctionPointer)(void*,U64*);
@@ -88,12 +89,23 @@ namespace Runtime
 		U8* reservedBaseAddress;
 		Uptr reservedNumPlatformPages;
 
-		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0) {}
+		// The image mapped copy-on-write at the start of the memory by resetMemory, if any. The mapped pages are always
+		// within the memory's current size.
+		U64 mappedImageId;
+		Uptr mappedImageNumPlatformPages;
+
+		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0), mappedImageId(0), mappedImageNumPlatformPages(0) {}
 		~MemoryInstance() override;
 
       static MemoryInstance* theMemoryInstance;
 	};
 
+	struct MemoryImage
+	{
+		Platform::PageImage* pageImage;
+		U64 id;
+	};
+
 	// An instance of a WebAssembly global.
 	struct GlobalInstance : GCObject
 	{
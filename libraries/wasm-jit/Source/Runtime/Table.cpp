@@ -7,6 +7,8 @@
 namespace Runtime
 {
 	// Global lists of tables; used to query whether an address is reserved by one of them.
+	// Tables may be created by a background compile while another thread runs WebAssembly code.
+	Platform::Mutex* tablesMutex = Platform::createMutex();
 	std::vector<TableInstance*> tables;
 
 	static Uptr getNumPlatformPages(Uptr numBytes)
@@ -30,7 +32,10 @@ namespace Runtime
 		if(growTable(table,Uptr(type.size.min)) == -1) { delete table; return nullptr; }
 		
 		// Add the table to the global array.
-		tables.push_back(table);
+		{
+			Platform::Lock tablesLock(tablesMutex);
+			tables.push_back(table);
+		}
 		return table;
 	}
 	
@@ -46,6 +51,7 @@ namespace Runtime
 		baseAddress = nullptr;
 		
 		// Remove the table from the global array.
+		Platform::Lock tablesLock(tablesMutex);
 		for(Uptr tableIndex = 0;tableIndex < tables.size();++tableIndex)
 		{
 			if(tables[tableIndex] == this) { tables.erase(tables.begin() + tableIndex); break; }
@@ -55,6 +61,7 @@ namespace Runtime
 	bool isAddressOwnedByTable(U8* address)
 	{
 		// Iterate over all tables and check if the address is within the reserved address space for each.
+		Platform::Lock tablesLock(tablesMutex);
 		for(auto table : tables)
 		{
 			U8* startAddress = (U8*)table->reservedBaseAddress;
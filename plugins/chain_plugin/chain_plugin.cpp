@@ -209,10 +209,30 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-stride", bpo::value<uint32_t>()->default_value(0),
+          "split the block log file into a new segment blocks-<first>-<last>.log every time a block number that is a multiple of this value is appended (0 to disable)")
+         ("max-retained-block-files", bpo::value<uint32_t>()->default_value(0),
+          "the maximum number of block log segments to retain; older segments are archived or deleted (0 to retain all)")
+         ("blocks-archive-dir", bpo::value<bfs::path>(),
+          "the location of the directory retired block log segments are moved to (absolute path or relative to blocks dir). If not specified, retired segments are deleted")
+         ("blocks-log-compression", bpo::value<bool>()->default_value(false),
+          "store blocks compressed in block log files created from now on; existing files keep their format (see eosio-blocklog to convert them)")
+         ("blocks-log-write-interval-ms", bpo::value<uint32_t>()->default_value(0),
+          "write irreversible blocks to the block log from a dedicated thread, batching and flushing them at this interval in milliseconds (0 to write them as they become irreversible). Blocks not yet written are lost if nodeos is killed")
          ("protocol-features-dir", bpo::value<bfs::path>()->default_value("protocol_features"),
           "the location of the protocol_features directory (absolute path or relative to application config dir)")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("wasm-runtime", bpo::value<eosio::chain::wasm_interface::vm_type>()->value_name("wavm/wabt"), "Override default WASM runtime")
+         ("wasm-code-cache-dir", bpo::value<bfs::path>(),
+          "the location of the directory in which machine code compiled by the wavm runtime is cached across restarts (absolute path or relative to application data dir); not cached if unset")
+         ("wasm-background-compile", bpo::value<bool>()->default_value(false),
+          "compile contracts deployed by setcode on a background thread, ahead of their first use")
+         ("wasm-inline-checktime", bpo::value<bool>()->default_value(false),
+          "have contracts run by the wavm runtime check the deadline timer inline, calling checktime only once it expired")
+         ("native-contract", bpo::value<vector<string>>()->composing(),
+          "NAME=CODE_HASH: run the actions that native implementation NAME supports in place of the contract code with the given hash, NAME being one of: eosio.token")
+         ("native-contract-mode", bpo::value<eosio::chain::wasm_interface::native_contract_mode>()->default_value(eosio::chain::wasm_interface::native_contract_mode::enabled, "enabled")->value_name("disabled/enabled/differential"),
+          "whether native contracts are used; differential runs both native and wasm, keeps the wasm result and logs any difference")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
           "Override default maximum ABI serialization time allowed in ms")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
@@ -221,6 +241,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
          ("signature-cpu-billable-pct", bpo::value<uint32_t>()->default_value(config::default_sig_cpu_bill_pct / config::percent_1),
           "Percentage of actual signature recovery cpu to bill. Whole number percentages, e.g. 50 for 50%")
+         ("signature-cache-size", bpo::value<uint32_t>()->default_value(10000),
+          "Number of keys recovered from transaction signatures to keep in the process wide cache, least recently used are evicted first")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
          ("contracts-console", bpo::bool_switch()->default_value(false),
@@ -252,6 +274,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "In \"light\" mode all incoming blocks headers will be fully validated; transactions in those validated blocks will be trusted \n")
          ("disable-ram-billing-notify-checks", bpo::bool_switch()->default_value(false),
           "Disable the check which subjectively fails a transaction if a contract bills more RAM to another account within the context of a notification handler (i.e. when the receiver is not the code of the action).")
+         ("track-transaction-access-sets", bpo::bool_switch()->default_value(false),
+          "Record the tables, accounts and permissions each transaction reads and writes, and log at debug level how many conflict-free waves of transactions each block could be executed in. This only tracks access; transactions are still executed serially.")
          ("trusted-producer", bpo::value<vector<string>>()->composing(), "Indicate a producer whose blocks headers signed by it will be fully validated, but transactions in those validated blocks will be trusted.")
          ("database-map-mode", bpo::value<chainbase::pinnable_mapped_file::map_mode>()->default_value(chainbase::pinnable_mapped_file::map_mode::mapped),
           "Database map mode (\"mapped\", \"heap\", or \"locked\").\n"
@@ -298,7 +322,7 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("delete-all-blocks", bpo::bool_switch()->default_value(false),
           "clear chain state database and block log")
          ("backup-blocks-log", bpo::bool_switch()->default_value(false),
-          "increase backup  block log")
+          "incrementally back up the block log to blocks_backup.log, copying only blocks appended since the last backup")
          ("truncate-at-block", bpo::value<uint32_t>()->default_value(0),
           "stop hard replay / block log recovery at this block number (if set to non-zero number)")
          ("import-reversible-blocks", bpo::value<bfs::path>(),
@@ -637,10 +661,43 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "wasm-runtime" ))
          my->wasm_runtime = options.at( "wasm-runtime" ).as<vm_type>();
 
+      if( options.count( "wasm-code-cache-dir" )) {
+         auto ccd = options.at( "wasm-code-cache-dir" ).as<bfs::path>();
+         if( ccd.is_relative())
+            my->chain_config->wasm_code_cache_dir = app().data_dir() / ccd;
+         else
+            my->chain_config->wasm_code_cache_dir = ccd;
+      }
+      my->chain_config->wasm_background_compile = options.at( "wasm-background-compile" ).as<bool>();
+      my->chain_config->wasm_inline_checktime = options.at( "wasm-inline-checktime" ).as<bool>();
+
+      if( options.count( "native-contract" )) {
+         for( const auto& nc : options.at( "native-contract" ).as<vector<string>>()) {
+            auto eq = nc.find( '=' );
+            EOS_ASSERT( eq != string::npos, plugin_config_exception, "expected NAME=CODE_HASH for native-contract: ${nc}", ("nc", nc) );
+            auto name = nc.substr( 0, eq );
+            EOS_ASSERT( native_contracts::find( name ), plugin_config_exception, "unknown native contract ${n}, expected one of ${names}",
+                        ("n", name)("names", native_contracts::names()) );
+            my->chain_config->native_contracts[digest_type( nc.substr( eq + 1 ))] = name;
+         }
+      }
+      my->chain_config->native_contract_mode = options.at( "native-contract-mode" ).as<eosio::chain::wasm_interface::native_contract_mode>();
+
       if(options.count("abi-serializer-max-time-ms"))
          my->abi_serializer_max_time_ms = fc::microseconds(options.at("abi-serializer-max-time-ms").as<uint32_t>() * 1000);
 
       my->chain_config->blocks_dir = my->blocks_dir;
+      my->chain_config->blog.stride = options.at( "blocks-log-stride" ).as<uint32_t>();
+      my->chain_config->blog.max_retained_segments = options.at( "max-retained-block-files" ).as<uint32_t>();
+      if( options.count( "blocks-archive-dir" )) {
+         auto ad = options.at( "blocks-archive-dir" ).as<bfs::path>();
+         if( ad.is_relative())
+            my->chain_config->blog.archive_dir = my->blocks_dir / ad;
+         else
+            my->chain_config->blog.archive_dir = ad;
+      }
+      my->chain_config->blog.compress_blocks = options.at( "blocks-log-compression" ).as<bool>();
+      my->chain_config->blog.write_interval_ms = options.at( "blocks-log-write-interval-ms" ).as<uint32_t>();
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
       my->chain_config->read_only = my->readonly;
 
@@ -668,6 +725,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                   "signature-cpu-billable-pct must be 0 - 100, ${pct}", ("pct", my->chain_config->sig_cpu_bill_pct) );
       my->chain_config->sig_cpu_bill_pct *= config::percent_1;
 
+      set_signature_recovery_cache_size( options.at( "signature-cache-size" ).as<uint32_t>() );
+
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
 
@@ -675,6 +734,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
+      my->chain_config->track_transaction_access_sets = options.at( "track-transaction-access-sets" ).as<bool>();
 
       if( options.count( "extract-genesis-json" ) || options.at( "print-genesis-json" ).as<bool>()) {
          genesis_state gs;
@@ -1016,8 +1076,8 @@ void chain_apis::read_write::validate() const {
    EOS_ASSERT( db.get_read_mode() != chain::db_read_mode::READ_ONLY, missing_chain_api_plugin_exception, "Not allowed, node in read-only mode" );
 }
 
-void chain_plugin::accept_block(const signed_block_ptr& block ) {
-   my->incoming_block_sync_method(block);
+void chain_plugin::accept_block(const signed_block_ptr& block, const block_state_ptr& validated ) {
+   my->incoming_block_sync_method(block, validated);
 }
 
 void chain_plugin::accept_transaction(const chain::packed_transaction& trx, next_function<chain::transaction_trace_ptr> next) {
@@ -1302,7 +1362,8 @@ read_only::get_info_results read_only::get_info(const read_only::get_info_params
       //__builtin_popcountll(db.get_dynamic_global_properties().recent_slots_filled) / 64.0,
       app().version_string(),
       db.fork_db_pending_head_block_num(),
-      db.fork_db_pending_head_block_id()
+      db.fork_db_pending_head_block_id(),
+      get_signature_recovery_cache_stats()
    };
 }
 
@@ -1887,7 +1948,7 @@ fc::variant read_only::get_block_header_state(const get_block_header_state_param
 
 void read_write::push_block(read_write::push_block_params&& params, next_function<read_write::push_block_results> next) {
    try {
-      app().get_method<incoming::methods::block_sync>()(std::make_shared<signed_block>(std::move(params)));
+      app().get_method<incoming::methods::block_sync>()(std::make_shared<signed_block>(std::move(params)), block_state_ptr());
       next(read_write::push_block_results{});
    } catch ( boost::interprocess::bad_alloc& ) {
       chain_plugin::handle_db_exhaustion();
@@ -0,0 +1,139 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/net_plugin/protocol.hpp>
+#include <eosio/chain/merkle.hpp>
+
+#include <fc/time.hpp>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace eosio {
+
+   /// a block rebuilt from a compact_block_message, waiting for the transactions asked for with a get_block_txns_message
+   struct pending_compact_block {
+      signed_block_ptr   block;
+      block_id_type      id;
+      vector<uint32_t>   missing;  ///< indexes into the transactions of block that were not found locally
+      fc::time_point     deadline; ///< the full block is requested instead if the transactions have not arrived by then
+   };
+
+   /**
+    * Rebuild the block of a compact_block_message. find_trx( short_id ) returns the packed_transaction_ptr of the
+    * transaction known locally by that short id, or null; the transactions not found are listed in missing.
+    */
+   template<typename FindTrx>
+   pending_compact_block reconstruct_compact_block( const compact_block_message& msg, FindTrx&& find_trx ) {
+      pending_compact_block result;
+      result.id = msg.header.id();
+      result.block = std::make_shared<signed_block>( msg.header );
+      result.block->block_extensions = msg.block_extensions;
+      result.block->transactions.resize( msg.transactions.size() );
+      for( uint32_t i = 0; i < msg.transactions.size(); ++i ) {
+         const compact_transaction_receipt& cr = msg.transactions[i];
+         transaction_receipt& r = result.block->transactions[i];
+         static_cast<transaction_receipt_header&>( r ) = cr;
+         if( cr.trx.contains<transaction_id_type>() ) {
+            r.trx = cr.trx.get<transaction_id_type>();
+            continue;
+         }
+         packed_transaction_ptr ptrx = find_trx( cr.trx.get<uint64_t>() );
+         if( ptrx ) {
+            r.trx = *ptrx;
+         } else {
+            result.missing.push_back( i );
+         }
+      }
+      return result;
+   }
+
+   /// fills the transactions of a block_txns_message in, false if they are not the ones that were asked for
+   inline bool fill_compact_block( pending_compact_block& pending, const block_txns_message& msg ) {
+      if( msg.id != pending.id || msg.transactions.size() != pending.missing.size() )
+         return false;
+      for( size_t i = 0; i < msg.transactions.size(); ++i ) {
+         pending.block->transactions[pending.missing[i]].trx = msg.transactions[i];
+      }
+      pending.missing.clear();
+      return true;
+   }
+
+   /// false if the transactions of a rebuilt block do not match its transaction_mroot, e.g. as a short id matched another transaction
+   inline bool compact_block_matches_mroot( const signed_block& block ) {
+      vector<digest_type> digests;
+      digests.reserve( block.transactions.size() );
+      for( const auto& r : block.transactions ) {
+         digests.emplace_back( r.digest() );
+      }
+      return merkle( std::move( digests ) ) == block.transaction_mroot;
+   }
+
+   /**
+    * The compact blocks of one peer waiting for their missing transactions, by block id. A block that is evicted to
+    * make room for a newer one, or whose transactions are not received by its deadline, is to be requested whole.
+    */
+   class pending_compact_blocks {
+      public:
+         static constexpr size_t max_pending = 8;
+
+         /// false, and nothing changes, if the block is waiting already; evicted gets the ids of the blocks pushed out
+         bool add( pending_compact_block&& p, vector<block_id_type>& evicted ) {
+            if( _pending.count( p.id ) )
+               return false;
+            while( _pending.size() >= max_pending ) {
+               auto oldest = std::min_element( _pending.begin(), _pending.end(), []( const auto& a, const auto& b ) {
+                  return a.second.deadline < b.second.deadline;
+               } );
+               evicted.push_back( oldest->first );
+               _pending.erase( oldest );
+            }
+            _pending.emplace( p.id, std::move( p ) );
+            return true;
+         }
+
+         /// removes and returns the block waiting under id, if any
+         fc::optional<pending_compact_block> take( const block_id_type& id ) {
+            fc::optional<pending_compact_block> result;
+            auto itr = _pending.find( id );
+            if( itr != _pending.end() ) {
+               result = std::move( itr->second );
+               _pending.erase( itr );
+            }
+            return result;
+         }
+
+         /// removes the blocks with a deadline before now and returns their ids
+         vector<block_id_type> expire( const fc::time_point& now ) {
+            vector<block_id_type> expired;
+            for( auto itr = _pending.begin(); itr != _pending.end(); ) {
+               if( itr->second.deadline < now ) {
+                  expired.push_back( itr->first );
+                  itr = _pending.erase( itr );
+               } else {
+                  ++itr;
+               }
+            }
+            return expired;
+         }
+
+         /// the earliest deadline, fc::time_point::maximum() if nothing is waiting
+         fc::time_point next_deadline()const {
+            fc::time_point next = fc::time_point::maximum();
+            for( const auto& p : _pending )
+               next = std::min( next, p.second.deadline );
+            return next;
+         }
+
+         size_t size()const { return _pending.size(); }
+         bool empty()const { return _pending.empty(); }
+         void clear() { _pending.clear(); }
+
+      private:
+         std::map<block_id_type, pending_compact_block> _pending;
+   };
+
+} // namespace eosio
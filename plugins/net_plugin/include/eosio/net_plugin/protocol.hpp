@@ -132,6 +132,33 @@ namespace eosio {
       uint32_t end_block;
    };
 
+   /**
+    * A transaction_receipt of a compact_block_message: a packed transaction is replaced by the first 8 bytes of its id
+    */
+   struct compact_transaction_receipt : public transaction_receipt_header {
+      static_variant<transaction_id_type, uint64_t> trx;
+   };
+
+   /**
+    * A signed_block relayed to a peer that supports proto_compact_blocks. The peer most likely has the transactions
+    * of the block already, and asks with a get_block_txns_message for the ones it does not.
+    */
+   struct compact_block_message {
+      signed_block_header                   header;
+      vector<compact_transaction_receipt>   transactions;
+      extensions_type                       block_extensions;
+   };
+
+   struct get_block_txns_message {
+      block_id_type      id;
+      vector<uint32_t>   indexes; ///< into the transactions of the block
+   };
+
+   struct block_txns_message {
+      block_id_type                 id;
+      vector<packed_transaction>    transactions; ///< in the order of the request, empty if it could not be served
+   };
+
    using net_message = static_variant<handshake_message,
                                       chain_size_message,
                                       go_away_message,
@@ -140,7 +167,10 @@ namespace eosio {
                                       request_message,
                                       sync_request_message,
                                       signed_block,         // which = 7
-                                      packed_transaction>;  // which = 8
+                                      packed_transaction,   // which = 8
+                                      compact_block_message,
+                                      get_block_txns_message,
+                                      block_txns_message>;
 
 } // namespace eosio
 
@@ -159,6 +189,10 @@ FC_REFLECT( eosio::time_message, (org)(rec)(xmt)(dst) )
 FC_REFLECT( eosio::notice_message, (known_trx)(known_blocks) )
 FC_REFLECT( eosio::request_message, (req_trx)(req_blocks) )
 FC_REFLECT( eosio::sync_request_message, (start_block)(end_block) )
+FC_REFLECT_DERIVED( eosio::compact_transaction_receipt, (eosio::chain::transaction_receipt_header), (trx) )
+FC_REFLECT( eosio::compact_block_message, (header)(transactions)(block_extensions) )
+FC_REFLECT( eosio::get_block_txns_message, (id)(indexes) )
+FC_REFLECT( eosio::block_txns_message, (id)(transactions) )
 
 /**
  *
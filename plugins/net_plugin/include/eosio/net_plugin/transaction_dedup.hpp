@@ -0,0 +1,237 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+#include <fc/optional.hpp>
+#include <fc/time.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+   /// the first 8 bytes of a transaction id, by which transaction_dedup_table hashes and compact blocks refer to it
+   inline uint64_t short_transaction_id( const chain::transaction_id_type& id ) {
+      return id._hash[0];
+   }
+
+   /**
+    * Buckets of transaction ids by a deadline, a time in seconds or a block number. Deadlines up to slots ahead of the
+    * last expire go straight to their own slot, so that expiring visits only the slots that came due and the entries
+    * in them; entries further ahead wait in the last slot and are moved on when it comes due.
+    */
+   class transaction_expiry_wheel {
+      public:
+         static constexpr uint32_t slots = 4096; ///< more than the maximum transaction lifetime in seconds
+
+         void add( uint32_t deadline, const chain::transaction_id_type& id ) {
+            if( _slots.empty() )
+               _slots.resize( slots );
+            deadline = std::max( deadline, _next );
+            const uint32_t slot = deadline - _next < slots ? deadline : _next + slots - 1;
+            _slots[slot % slots].emplace_back( deadline, id );
+         }
+
+         /// removes the entries with a deadline of at most until and appends them to due
+         void expire( uint32_t until, std::vector<std::pair<uint32_t, chain::transaction_id_type>>& due ) {
+            if( until < _next || _slots.empty() ) {
+               _next = std::max( _next, until );
+               return;
+            }
+            const uint64_t count = std::min<uint64_t>( uint64_t(until) - _next + 1, slots );
+            std::vector<std::pair<uint32_t, chain::transaction_id_type>> ahead;
+            for( uint64_t i = 0; i < count; ++i ) {
+               auto& slot = _slots[(_next + i) % slots];
+               for( auto& e : slot ) {
+                  if( e.first <= until )
+                     due.emplace_back( std::move( e ) );
+                  else
+                     ahead.emplace_back( std::move( e ) );
+               }
+               slot.clear();
+            }
+            _next = until;
+            for( const auto& e : ahead )
+               add( e.first, e.second );
+         }
+
+         void clear() {
+            _slots.clear();
+         }
+
+      private:
+         std::vector<std::vector<std::pair<uint32_t, chain::transaction_id_type>>> _slots; ///< allocated by the first add
+         /// the deadlines before this have been expired; this one is visited again, as entries may be added to it late
+         uint32_t _next = 0;
+   };
+
+   /**
+    * Set of transactions known to the net plugin, keyed by id. T is a struct with the members id, expires and
+    * block_num, the block the transaction was included in or 0.
+    *
+    * The ids are spread over shards, each with its own lock, by their first 8 bytes, which are uniformly distributed
+    * already. Net threads can therefore look ids up while the main thread inserts and expires others. Entries expire
+    * when their expiration time passes, or when the block they were included in becomes irreversible; both are tracked
+    * by a transaction_expiry_wheel, so that expiring costs what was expired rather than a walk of the entries.
+    */
+   template<typename T>
+   class transaction_dedup_table {
+      public:
+         static constexpr size_t shard_count = 16;
+
+         transaction_dedup_table() = default;
+         transaction_dedup_table( const transaction_dedup_table& ) = delete;
+         transaction_dedup_table& operator=( const transaction_dedup_table& ) = delete;
+
+         bool contains( const chain::transaction_id_type& id )const {
+            const auto& s = shard_of( id );
+            std::lock_guard<std::mutex> g( s.mtx );
+            return s.entries.find( id ) != s.entries.end();
+         }
+
+         /// a copy of the entry for id, if there is one
+         fc::optional<T> find( const chain::transaction_id_type& id )const {
+            const auto& s = shard_of( id );
+            std::lock_guard<std::mutex> g( s.mtx );
+            auto itr = s.entries.find( id );
+            if( itr == s.entries.end() ) return {};
+            return itr->second;
+         }
+
+         /// a copy of the entry whose id starts with short_id, if there is exactly one
+         fc::optional<T> find_by_short_id( uint64_t short_id )const {
+            chain::transaction_id_type probe;
+            probe._hash[0] = short_id;
+            const auto& s = shard_of( probe );
+            std::lock_guard<std::mutex> g( s.mtx );
+            // the hash of an id is its short id, so all the candidates are in the bucket of the probe
+            const auto b = s.entries.bucket( probe );
+            fc::optional<T> found;
+            for( auto itr = s.entries.begin( b ); itr != s.entries.end( b ); ++itr ) {
+               if( short_transaction_id( itr->first ) != short_id ) continue;
+               if( found ) return {};
+               found = itr->second;
+            }
+            return found;
+         }
+
+         /// returns false, and leaves the table as it was, when there already is an entry for the id
+         bool insert( T entry ) {
+            const auto id = entry.id;
+            const uint32_t expires = entry.expires.sec_since_epoch();
+            const uint32_t block_num = entry.block_num;
+            {
+               auto& s = shard_of( id );
+               std::lock_guard<std::mutex> g( s.mtx );
+               if( !s.entries.emplace( id, std::move( entry ) ).second )
+                  return false;
+            }
+            ++_size;
+            std::lock_guard<std::mutex> g( _wheel_mtx );
+            _by_expiry.add( expires, id );
+            if( block_num )
+               _by_block_num.add( block_num, id );
+            return true;
+         }
+
+         /// records the block that included the transaction, returns false when there is no entry for it
+         bool set_block_num( const chain::transaction_id_type& id, uint32_t block_num ) {
+            {
+               auto& s = shard_of( id );
+               std::lock_guard<std::mutex> g( s.mtx );
+               auto itr = s.entries.find( id );
+               if( itr == s.entries.end() ) return false;
+               itr->second.block_num = block_num;
+            }
+            if( block_num ) {
+               std::lock_guard<std::mutex> g( _wheel_mtx );
+               _by_block_num.add( block_num, id );
+            }
+            return true;
+         }
+
+         /// calls f with every entry, holding the lock of its shard, so f must not use the table
+         template<typename F>
+         void for_each( F&& f )const {
+            for( const auto& s : _shards ) {
+               std::lock_guard<std::mutex> g( s.mtx );
+               for( const auto& e : s.entries )
+                  f( e.second );
+            }
+         }
+
+         /// removes the entries that expired by now or were included in a block up to lib, returns how many
+         size_t expire( const fc::time_point& now, uint32_t lib ) {
+            std::vector<std::pair<uint32_t, chain::transaction_id_type>> expired, irreversible;
+            {
+               std::lock_guard<std::mutex> g( _wheel_mtx );
+               _by_expiry.expire( fc::time_point_sec( now ).sec_since_epoch(), expired );
+               _by_block_num.expire( lib, irreversible );
+            }
+            // the wheels are not updated when an entry goes away or moves to another block, so check that it still
+            // has the deadline it was filed under
+            size_t removed = 0;
+            for( const auto& e : expired )
+               removed += erase_if( e.second, [&e]( const T& t ) { return t.expires.sec_since_epoch() <= e.first; } );
+            for( const auto& e : irreversible )
+               removed += erase_if( e.second, [&e]( const T& t ) { return t.block_num != 0 && t.block_num <= e.first; } );
+            return removed;
+         }
+
+         void clear() {
+            for( auto& s : _shards ) {
+               std::lock_guard<std::mutex> g( s.mtx );
+               s.entries.clear();
+            }
+            _size = 0;
+            std::lock_guard<std::mutex> g( _wheel_mtx );
+            _by_expiry.clear();
+            _by_block_num.clear();
+         }
+
+         size_t size()const { return _size; }
+
+      private:
+         struct id_hash {
+            size_t operator()( const chain::transaction_id_type& id )const { return short_transaction_id( id ); }
+         };
+
+         struct shard {
+            mutable std::mutex                                          mtx;
+            std::unordered_map<chain::transaction_id_type, T, id_hash>  entries;
+         };
+
+         shard& shard_of( const chain::transaction_id_type& id ) {
+            return _shards[(short_transaction_id( id ) >> 60) % shard_count];
+         }
+         const shard& shard_of( const chain::transaction_id_type& id )const {
+            return _shards[(short_transaction_id( id ) >> 60) % shard_count];
+         }
+
+         template<typename Pred>
+         size_t erase_if( const chain::transaction_id_type& id, Pred&& pred ) {
+            auto& s = shard_of( id );
+            std::lock_guard<std::mutex> g( s.mtx );
+            auto itr = s.entries.find( id );
+            if( itr == s.entries.end() || !pred( itr->second ) ) return 0;
+            s.entries.erase( itr );
+            --_size;
+            return 1;
+         }
+
+         std::array<shard, shard_count>   _shards;
+         std::atomic<size_t>              _size{0};
+         std::mutex                       _wheel_mtx;
+         transaction_expiry_wheel         _by_expiry;
+         transaction_expiry_wheel         _by_block_num;
+   };
+
+} // namespace eosio
@@ -6,6 +6,8 @@
 
 #include <eosio/net_plugin/net_plugin.hpp>
 #include <eosio/net_plugin/protocol.hpp>
+#include <eosio/net_plugin/transaction_dedup.hpp>
+#include <eosio/net_plugin/compact_blocks.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/block.hpp>
@@ -13,6 +15,7 @@
 #include <eosio/chain/thread_utils.hpp>
 #include <eosio/producer_plugin/producer_plugin.hpp>
 #include <eosio/chain/contract_types.hpp>
+#include <eosio/chain/merkle.hpp>
 
 #include <fc/network/message_buffer.hpp>
 #include <fc/network/ip.hpp>
@@ -28,6 +31,9 @@
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include <atomic>
+#include <mutex>
+
 using namespace eosio::chain::plugin_interface::compat;
 
 namespace eosio {
@@ -56,39 +62,42 @@ namespace eosio {
    using socket_ptr = std::shared_ptr<tcp::socket>;
    using io_work_t = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
 
+   /**
+    * A message framed for the wire: the length prefix and the net_message variant. It is built once and never modified,
+    * so that one instance is shared by the write queues of all the connections it is sent to. The frame is head followed
+    * by body, which is the packed block cached by block_state when there is one; both are handed to async_write as they
+    * are, so the block is not copied.
+    */
+   class send_buffer {
+   public:
+      explicit send_buffer( vector<char> head, packed_block_ptr body = packed_block_ptr() )
+      : _head( std::move( head ) ), _body( std::move( body ) ) {}
+
+      size_t size() const { return _head.size() + (_body ? _body->size() : 0); }
+
+      void append_to( std::vector<boost::asio::const_buffer>& bufs ) const {
+         bufs.push_back( boost::asio::buffer( _head ) );
+         if( _body ) bufs.push_back( boost::asio::buffer( *_body ) );
+      }
+
+   private:
+      const vector<char>       _head;
+      const packed_block_ptr   _body;
+   };
+
+   using send_buffer_ptr = std::shared_ptr<const send_buffer>;
+
    struct node_transaction_state {
       transaction_id_type id;
       time_point_sec  expires;  /// time after which this may be purged.
       uint32_t        block_num = 0; /// block transaction was included in
-      std::shared_ptr<vector<char>>   serialized_txn; /// the received raw bundle
+      send_buffer_ptr serialized_txn; /// the received raw bundle
+      packed_transaction_ptr packed_trx; /// to rebuild the compact blocks that refer to it
    };
 
-   struct by_expiry;
    struct by_block_num;
 
-   typedef multi_index_container<
-      node_transaction_state,
-      indexed_by<
-         ordered_unique<
-            tag< by_id >,
-            member < node_transaction_state,
-                     transaction_id_type,
-                     &node_transaction_state::id >,
-            sha256_less >,
-         ordered_non_unique<
-            tag< by_expiry >,
-            member< node_transaction_state,
-                    fc::time_point_sec,
-                    &node_transaction_state::expires >
-            >,
-         ordered_non_unique<
-            tag<by_block_num>,
-            member< node_transaction_state,
-                    uint32_t,
-                    &node_transaction_state::block_num > >
-         >
-      >
-   node_transaction_index;
+   typedef transaction_dedup_table<node_transaction_state> node_transaction_index;
 
    class net_plugin_impl {
    public:
@@ -140,8 +149,13 @@ namespace eosio {
       producer_plugin*              producer_plug = nullptr;
       int                           started_sessions = 0;
 
+      /// written on the main thread, also read by the net threads
       node_transaction_index        local_txns;
 
+      /// ids and numbers of the blocks decoded on a net thread, so that the copies sent by other peers are not decoded again
+      std::map<block_id_type, uint32_t, sha256_less> received_block_ids;
+      std::mutex                    received_block_ids_mtx;
+
       shared_ptr<tcp::resolver>     resolver;
 
       bool                          use_socket_read_watermark = false;
@@ -162,16 +176,25 @@ namespace eosio {
        * Process the next message from the pending_message_buffer.
        * message_length is the already determined length of the data
        * part of the message that will handle the message.
+       * Runs on the strand of the connection: the message is decoded,
+       * and checked against the blocks and transactions already known,
+       * there, and only then posted to the main thread to be handled.
        * Returns true is successful. Returns false if an error was
-       * encountered unpacking or processing the message.
+       * encountered unpacking the message.
        */
       bool process_next_message(const connection_ptr& conn, uint32_t message_length);
+      /// from the strand of c: c sent a block that was already received from another peer
+      void post_received_block(const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num);
+      /// lets the next copy of a block be decoded, after this one was dropped or rejected
+      void forget_received_block(const block_id_type& blk_id);
 
       void close(const connection_ptr& c);
+      /// close c from its strand; the state that names the peer in the log belongs to the main thread, so does closing
+      void close_from_strand(const connection_ptr& c, fc::log_level level, string reason);
       size_t count_open_sockets() const;
 
       template<typename VerifierFunc>
-      void send_transaction_to_all( const std::shared_ptr<std::vector<char>>& send_buffer, VerifierFunc verify );
+      void send_transaction_to_all( const send_buffer_ptr& send_buffer, VerifierFunc verify );
 
       void accepted_block(const block_state_ptr&);
       void transaction_ack(const std::pair<fc::exception_ptr, transaction_metadata_ptr>&);
@@ -199,10 +222,23 @@ namespace eosio {
       void handle_message(const connection_ptr& c, const notice_message& msg);
       void handle_message(const connection_ptr& c, const request_message& msg);
       void handle_message(const connection_ptr& c, const sync_request_message& msg);
+      void handle_message(const connection_ptr& c, const compact_block_message& msg);
+      void handle_message(const connection_ptr& c, const get_block_txns_message& msg);
+      void handle_message(const connection_ptr& c, const block_txns_message& msg);
+      /// checks a block rebuilt from a compact_block_message and handles it as if it was received whole
+      void accept_compact_block(const connection_ptr& c, const signed_block_ptr& block, const block_id_type& blk_id);
+      /// falls back to a request_message for a block that could not be rebuilt from its compact_block_message
+      void request_full_block(const connection_ptr& c, const block_id_type& blk_id);
+      /// requests the compact blocks of c whose missing transactions are overdue whole, when the earliest deadline passes
+      void start_compact_block_timer(const connection_ptr& c);
       void handle_message(const connection_ptr& c, const signed_block& msg) = delete; // signed_block_ptr overload used instead
-      void handle_message(const connection_ptr& c, const signed_block_ptr& msg);
+      void handle_message(const connection_ptr& c, const signed_block_ptr& msg) = delete; // overload with the id used instead
+      void handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id);
+      /// pushes a block received from c to the chain, validated is its header state when that was validated already
+      void process_block(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id, const block_state_ptr& validated);
       void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // packed_transaction_ptr overload used instead
-      void handle_message(const connection_ptr& c, const packed_transaction_ptr& msg);
+      void handle_message(const connection_ptr& c, const packed_transaction_ptr& msg) = delete; // transaction_metadata_ptr overload used instead
+      void handle_message(const connection_ptr& c, const transaction_metadata_ptr& msg);
 
       void start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection);
       void start_txn_timer();
@@ -298,11 +334,14 @@ namespace eosio {
    constexpr auto     def_conn_retry_wait = 30;
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
+   constexpr auto     def_compact_block_wait = std::chrono::seconds(1); ///< for the missing transactions of a compact block
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr auto     def_sync_fetch_peers = 1;
 
    constexpr auto     message_header_size = 4;
    constexpr uint32_t signed_block_which = 7;        // see protocol net_message
    constexpr uint32_t packed_transaction_which = 8;  // see protocol net_message
+   constexpr uint32_t compact_block_which = 9;       // see protocol net_message
 
    /**
     *  For a while, network version was a 16 bit value equal to the second set of 16 bits
@@ -324,8 +363,9 @@ namespace eosio {
     */
    constexpr uint16_t proto_base = 0;
    constexpr uint16_t proto_explicit_sync = 1;
+   constexpr uint16_t proto_compact_blocks = 2;  // compact_block_message, get_block_txns_message and block_txns_message
 
-   constexpr uint16_t net_version = proto_explicit_sync;
+   constexpr uint16_t net_version = proto_compact_blocks;
 
    struct transaction_state {
       transaction_id_type id;
@@ -333,19 +373,7 @@ namespace eosio {
       time_point_sec      expires;
    };
 
-   typedef multi_index_container<
-      transaction_state,
-      indexed_by<
-         ordered_unique< tag<by_id>, member<transaction_state, transaction_id_type, &transaction_state::id >, sha256_less >,
-         ordered_non_unique< tag< by_expiry >, member< transaction_state,fc::time_point_sec,&transaction_state::expires >>,
-         ordered_non_unique<
-            tag<by_block_num>,
-            member< transaction_state,
-                    uint32_t,
-                    &transaction_state::block_num > >
-         >
-
-      > transaction_state_index;
+   typedef transaction_dedup_table<transaction_state> transaction_state_index;
 
    /**
     *
@@ -364,17 +392,6 @@ namespace eosio {
       > peer_block_state_index;
 
 
-   struct update_block_num {
-      uint32_t new_bnum;
-      update_block_num(uint32_t bnum) : new_bnum(bnum) {}
-      void operator() (node_transaction_state& nts) {
-         nts.block_num = new_bnum;
-      }
-      void operator() (transaction_state& ts) {
-         ts.block_num = new_bnum;
-      }
-   };
-
    /**
     * Index by start_block_num
     */
@@ -407,6 +424,7 @@ namespace eosio {
          }
       }
 
+      /// also read on the strand of the connection, to throttle reading
       uint32_t write_queue_size() const { return _write_queue_size; }
 
       bool is_out_queue_empty() const { return _out_queue.empty(); }
@@ -416,7 +434,7 @@ namespace eosio {
          return ((!_sync_write_queue.empty() || !_write_queue.empty()) && _out_queue.empty());
       }
 
-      bool add_write_queue( const std::shared_ptr<vector<char>>& buff,
+      bool add_write_queue( const send_buffer_ptr& buff,
                             std::function<void( boost::system::error_code, std::size_t )> callback,
                             bool to_sync_queue ) {
          if( to_sync_queue ) {
@@ -452,7 +470,7 @@ namespace eosio {
                             deque<queued_write>& w_queue ) {
          while ( w_queue.size() > 0 ) {
             auto& m = w_queue.front();
-            bufs.push_back( boost::asio::buffer( *m.buff ));
+            m.buff->append_to( bufs );
             _write_queue_size -= m.buff->size();
             _out_queue.emplace_back( m );
             w_queue.pop_front();
@@ -461,11 +479,11 @@ namespace eosio {
 
    private:
       struct queued_write {
-         std::shared_ptr<vector<char>> buff;
+         send_buffer_ptr buff;
          std::function<void( boost::system::error_code, std::size_t )> callback;
       };
 
-      uint32_t _write_queue_size = 0;
+      std::atomic<uint32_t> _write_queue_size{0};
       deque<queued_write> _write_queue;
       deque<queued_write> _sync_write_queue; // sync_write_queue will be sent first
       deque<queued_write> _out_queue;
@@ -486,8 +504,15 @@ namespace eosio {
       optional<sync_state>    peer_requested;  // this peer is requesting info from us
       boost::asio::io_context&                  server_ioc;
       boost::asio::io_context::strand           strand;
+      /// operated on strand only: reads, writes, connecting and closing; apart from setting up a session in start_session
       socket_ptr                                socket;
+      /// whether socket is open, as far as the main thread is concerned: cleared by close before socket is closed
+      bool                                      socket_open = false;
+      /// the endpoints of socket, recorded when the session started
+      optional<tcp::endpoint>                   remote_endpoint;
+      optional<tcp::endpoint>                   local_endpoint;
 
+      /// the read loop below runs on strand, on a thread of the net thread pool
       fc::message_buffer<1024*1024>    pending_message_buffer;
       fc::optional<std::size_t>        outstanding_read_bytes;
 
@@ -495,7 +520,7 @@ namespace eosio {
       queued_buffer           buffer_queue;
 
       uint32_t                reads_in_flight = 0;
-      uint32_t                trx_in_progress_size = 0;
+      std::atomic<uint32_t>   trx_in_progress_size{0};
       fc::sha256              node_id;
       handshake_message       last_handshake_recv;
       handshake_message       last_handshake_sent;
@@ -511,6 +536,9 @@ namespace eosio {
       uint32_t               fork_head_num = 0;
       optional<request_message> last_req;
 
+      pending_compact_blocks  pending_compacts;
+      unique_ptr<boost::asio::steady_timer> compact_block_timer;
+
       connection_status get_status()const {
          connection_status stat;
          stat.peer = peer_addr;
@@ -576,7 +604,8 @@ namespace eosio {
 
       void enqueue( const net_message &msg, bool trigger_send = true );
       void enqueue_block( const signed_block_ptr& sb, bool trigger_send = true, bool to_sync_queue = false);
-      void enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
+      void enqueue_block( const block_state_ptr& bs, bool trigger_send = true, bool to_sync_queue = false);
+      void enqueue_buffer( const send_buffer_ptr& send_buffer,
                            bool trigger_send, int priority, go_away_reason close_after_send,
                            bool to_sync_queue = false);
       void cancel_sync(go_away_reason);
@@ -590,7 +619,7 @@ namespace eosio {
       void sync_timeout(boost::system::error_code ec);
       void fetch_timeout(boost::system::error_code ec);
 
-      void queue_write(const std::shared_ptr<vector<char>>& buff,
+      void queue_write(const send_buffer_ptr& buff,
                        bool trigger_send,
                        int priority,
                        std::function<void(boost::system::error_code, std::size_t)> callback,
@@ -603,14 +632,11 @@ namespace eosio {
       fc::optional<fc::variant_object> _logger_variant;
       const fc::variant_object& get_logger_variant()  {
          if (!_logger_variant) {
-            boost::system::error_code ec;
-            auto rep = socket->remote_endpoint(ec);
-            string ip = ec ? "<unknown>" : rep.address().to_string();
-            string port = ec ? "<unknown>" : std::to_string(rep.port());
+            string ip = !remote_endpoint ? "<unknown>" : remote_endpoint->address().to_string();
+            string port = !remote_endpoint ? "<unknown>" : std::to_string(remote_endpoint->port());
 
-            auto lep = socket->local_endpoint(ec);
-            string lip = ec ? "<unknown>" : lep.address().to_string();
-            string lport = ec ? "<unknown>" : std::to_string(lep.port());
+            string lip = !local_endpoint ? "<unknown>" : local_endpoint->address().to_string();
+            string lport = !local_endpoint ? "<unknown>" : std::to_string(local_endpoint->port());
 
             _logger_variant.emplace(fc::mutable_variant_object()
                ("_name", peer_name())
@@ -645,10 +671,10 @@ namespace eosio {
       }
 
       void operator()( signed_block&& msg ) const {
-         impl.handle_message( c, std::make_shared<signed_block>( std::move( msg ) ) );
+         EOS_ASSERT( false, plugin_config_exception, "signed_block is decoded by process_next_message" );
       }
       void operator()( packed_transaction&& msg ) const {
-         impl.handle_message( c, std::make_shared<packed_transaction>( std::move( msg ) ) );
+         EOS_ASSERT( false, plugin_config_exception, "packed_transaction is decoded by process_next_message" );
       }
 
       template <typename T>
@@ -670,16 +696,56 @@ namespace eosio {
       uint32_t       sync_last_requested_num;
       uint32_t       sync_next_expected_num;
       uint32_t       sync_req_span;
+      uint32_t       sync_fetch_peers;
       connection_ptr source;
       stages         state;
 
+      /**
+       * Pipelined lib catchup, used when sync_fetch_peers > 1. Chunks are requested from up to sync_fetch_peers peers
+       * at once, within a window ahead of sync_next_expected_num, the next block to apply. Received blocks wait in
+       * sync_blocks, by number. From there their headers and signatures are validated in order on the chain thread
+       * pool, each on top of the header state of the one before, while the main thread applies the blocks that were
+       * validated already. Block numbers up to sync_last_requested_num that are neither buffered nor outstanding, as
+       * their source went away, are requested again.
+       */
+      struct sync_chunk {
+         uint32_t       next = 0; ///< next block expected from source
+         connection_ptr source;
+      };
+      struct sync_block {
+         connection_ptr    source;
+         signed_block_ptr  block;
+         block_id_type     id;
+         block_state_ptr   state;             ///< null for a block left to be validated when it is applied
+         bool              validated = false;
+      };
+      std::map<uint32_t, sync_chunk>  sync_chunks; ///< outstanding requests, by last block number, unlike the first never shared
+      std::map<uint32_t, sync_block>  sync_blocks;
+      uint32_t       sync_validated_num = 0;      ///< the blocks up to this one are validated
+      bool           sync_validating = false;
+      bool           sync_applying = false;
+      uint32_t       sync_generation = 0;         ///< changes when the pipeline is reset, so that stale results are dropped
+
       chain_plugin* chain_plug = nullptr;
 
       constexpr static auto stage_str(stages s);
 
+      std::map<uint32_t, sync_chunk>::iterator find_sync_chunk(const connection_ptr& c);
+      connection_ptr next_sync_source(const connection_ptr& conn);
+      vector<std::pair<uint32_t, uint32_t>> sync_gaps(uint32_t last)const;
+      void request_sync_chunks(const connection_ptr& conn);
+      void validate_sync_blocks();
+      void sync_block_validated(uint32_t generation, uint32_t blk_num, const block_state_ptr& bsp, const string& error);
+      void apply_sync_blocks();
+      void reset_sync_pipeline();
+
    public:
-      explicit sync_manager(uint32_t span);
+      sync_manager(uint32_t span, uint32_t fetch_peers);
       void set_state(stages s);
+      /// true when blocks are to be passed to recv_sync_block rather than pushed to the chain as they are received
+      bool pipelining()const { return sync_fetch_peers > 1 && state == lib_catchup; }
+      /// a block, or just its id when a copy was decoded already, received during a pipelined lib catchup
+      void recv_sync_block(const connection_ptr& c, const signed_block_ptr& blk, const block_id_type& blk_id, uint32_t blk_num);
       bool sync_required();
       void send_handshakes();
       bool is_active(const connection_ptr& conn);
@@ -719,7 +785,7 @@ namespace eosio {
         trx_state(),
         peer_requested(),
         server_ioc( my_impl->thread_pool->get_executor() ),
-        strand( app().get_io_service() ),
+        strand( my_impl->thread_pool->get_executor() ),
         socket( std::make_shared<tcp::socket>( my_impl->thread_pool->get_executor() ) ),
         node_id(),
         last_handshake_recv(),
@@ -745,8 +811,9 @@ namespace eosio {
         trx_state(),
         peer_requested(),
         server_ioc( my_impl->thread_pool->get_executor() ),
-        strand( app().get_io_service() ),
+        strand( my_impl->thread_pool->get_executor() ),
         socket( s ),
+        socket_open( true ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -773,10 +840,11 @@ namespace eosio {
       rnd[0] = 0;
       response_expected.reset(new boost::asio::steady_timer( my_impl->thread_pool->get_executor() ));
       read_delay_timer.reset(new boost::asio::steady_timer( my_impl->thread_pool->get_executor() ));
+      compact_block_timer.reset(new boost::asio::steady_timer( my_impl->thread_pool->get_executor() ));
    }
 
    bool connection::connected() {
-      return (socket && socket->is_open() && !connecting);
+      return (socket_open && !connecting);
    }
 
    bool connection::current() {
@@ -785,6 +853,7 @@ namespace eosio {
 
    void connection::reset() {
       peer_requested.reset();
+      pending_compacts.clear();
       blk_state.clear();
       trx_state.clear();
    }
@@ -794,12 +863,15 @@ namespace eosio {
    }
 
    void connection::close() {
-      if(socket) {
-         socket->close();
-      }
-      else {
-         fc_wlog( logger, "no socket to close!" );
-      }
+      socket_open = false;
+      // the read loop and the writes use the socket on the strand, close it there after them
+      boost::asio::post( strand, [c = shared_from_this()]() {
+         boost::system::error_code ec;
+         c->socket->close( ec );
+         if( c->read_delay_timer ) {
+            c->read_delay_timer->cancel();
+         }
+      } );
       flush_queues();
       connecting = false;
       syncing = false;
@@ -813,24 +885,27 @@ namespace eosio {
       my_impl->sync_master->reset_lib_num(shared_from_this());
       fc_dlog(logger, "canceling wait on ${p}", ("p",peer_name()));
       cancel_wait();
-      if( read_delay_timer ) read_delay_timer->cancel();
    }
 
    void connection::txn_send_pending(const vector<transaction_id_type>& ids) {
       const std::set<transaction_id_type, sha256_less> known_ids(ids.cbegin(), ids.cend());
       my_impl->expire_local_txns();
-      for(auto tx = my_impl->local_txns.begin(); tx != my_impl->local_txns.end(); ++tx ){
-         const bool found = known_ids.find( tx->id ) != known_ids.cend();
+      vector<send_buffer_ptr> pending;
+      my_impl->local_txns.for_each( [&]( const node_transaction_state& tx ) {
+         const bool found = known_ids.find( tx.id ) != known_ids.cend();
          if( !found ) {
-            queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {} );
+            pending.push_back( tx.serialized_txn );
          }
+      } );
+      for( const auto& buff : pending ) {
+         queue_write( buff, true, priority::low, []( boost::system::error_code ec, std::size_t ) {} );
       }
    }
 
    void connection::txn_send(const vector<transaction_id_type>& ids) {
       for(const auto& t : ids) {
-         auto tx = my_impl->local_txns.get<by_id>().find(t);
-         if( tx != my_impl->local_txns.end() ) {
+         auto tx = my_impl->local_txns.find(t);
+         if( tx ) {
             queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {} );
          }
       }
@@ -938,7 +1013,7 @@ namespace eosio {
       enqueue(xpkt);
    }
 
-   void connection::queue_write(const std::shared_ptr<vector<char>>& buff,
+   void connection::queue_write(const send_buffer_ptr& buff,
                                 bool trigger_send,
                                 int priority,
                                 std::function<void(boost::system::error_code, std::size_t)> callback,
@@ -958,7 +1033,7 @@ namespace eosio {
       if( !buffer_queue.ready_to_send() )
          return;
       connection_wptr c(shared_from_this());
-      if(!socket->is_open()) {
+      if(!socket_open) {
          fc_elog(logger,"socket not open to ${p}",("p",peer_name()));
          my_impl->close(c.lock());
          return;
@@ -966,48 +1041,51 @@ namespace eosio {
       std::vector<boost::asio::const_buffer> bufs;
       buffer_queue.fill_out_buffer( bufs );
 
-      boost::asio::async_write(*socket, bufs,
-            boost::asio::bind_executor(strand, [c, priority]( boost::system::error_code ec, std::size_t w ) {
-         app().post(priority, [c, priority, ec, w]() {
-            try {
-               auto conn = c.lock();
-               if(!conn)
-                  return;
+      // the buffers stay in the out queue until the callback has run on this thread
+      boost::asio::post( strand, [conn = shared_from_this(), c, bufs{std::move( bufs )}, priority]() {
+         boost::asio::async_write(*conn->socket, bufs,
+               boost::asio::bind_executor(conn->strand, [c, priority]( boost::system::error_code ec, std::size_t w ) {
+            app().post(priority, [c, priority, ec, w]() {
+               try {
+                  auto conn = c.lock();
+                  if(!conn)
+                     return;
 
-               conn->buffer_queue.out_callback( ec, w );
+                  conn->buffer_queue.out_callback( ec, w );
 
-               if(ec) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  if( ec.value() != boost::asio::error::eof) {
-                     fc_elog( logger, "Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()) );
-                  }
-                  else {
-                     fc_wlog( logger, "connection closure detected on write to ${p}",("p",pname) );
+                  if(ec) {
+                     string pname = conn ? conn->peer_name() : "no connection name";
+                     if( ec.value() != boost::asio::error::eof) {
+                        fc_elog( logger, "Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()) );
+                     }
+                     else {
+                        fc_wlog( logger, "connection closure detected on write to ${p}",("p",pname) );
+                     }
+                     my_impl->close(conn);
+                     return;
                   }
-                  my_impl->close(conn);
-                  return;
+                  conn->buffer_queue.clear_out_queue();
+                  conn->enqueue_sync_block();
+                  conn->do_queue_write( priority );
                }
-               conn->buffer_queue.clear_out_queue();
-               conn->enqueue_sync_block();
-               conn->do_queue_write( priority );
-            }
-            catch(const std::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()) );
-            }
-            catch(const fc::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()) );
-            }
-            catch(...) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               fc_elog( logger,"Exception in do_queue_write to ${p}", ("p",pname) );
-            }
-         });
-      }));
+               catch(const std::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()) );
+               }
+               catch(const fc::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()) );
+               }
+               catch(...) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  fc_elog( logger,"Exception in do_queue_write to ${p}", ("p",pname) );
+               }
+            });
+         }));
+      } );
    }
 
    void connection::cancel_sync(go_away_reason reason) {
@@ -1038,6 +1116,11 @@ namespace eosio {
       }
       try {
          controller& cc = my_impl->chain_plug->chain();
+         // reversible blocks already have their packed form cached in the block state
+         if( block_state_ptr bs = cc.fetch_block_state_by_number(num) ) {
+            enqueue_block( bs, trigger_send, true);
+            return true;
+         }
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
             enqueue_block( sb, trigger_send, true);
@@ -1049,6 +1132,21 @@ namespace eosio {
       return false;
    }
 
+   /// head of a frame whose payload is payload_size bytes, the first of which are written by pack_front
+   template<typename PackFront>
+   static vector<char> create_frame_head( uint32_t payload_size, uint32_t head_payload_size, PackFront&& pack_front ) {
+      const char* const header = reinterpret_cast<const char* const>(&payload_size); // avoid variable size encoding of uint32_t
+      constexpr size_t header_size = sizeof( payload_size );
+      static_assert( header_size == message_header_size, "invalid message_header_size" );
+      const size_t buffer_size = header_size + head_payload_size;
+
+      vector<char> head( buffer_size );
+      fc::datastream<char*> ds( head.data(), buffer_size );
+      ds.write( header, header_size );
+      pack_front( ds );
+      return head;
+   }
+
    void connection::enqueue( const net_message& m, bool trigger_send ) {
       go_away_reason close_after_send = no_reason;
       if (m.contains<go_away_message>()) {
@@ -1056,47 +1154,62 @@ namespace eosio {
       }
 
       const uint32_t payload_size = fc::raw::pack_size( m );
-
-      const char* const header = reinterpret_cast<const char* const>(&payload_size); // avoid variable size encoding of uint32_t
-      constexpr size_t header_size = sizeof(payload_size);
-      static_assert( header_size == message_header_size, "invalid message_header_size" );
-      const size_t buffer_size = header_size + payload_size;
-
-      auto send_buffer = std::make_shared<vector<char>>(buffer_size);
-      fc::datastream<char*> ds( send_buffer->data(), buffer_size);
-      ds.write( header, header_size );
-      fc::raw::pack( ds, m );
+      auto send_buffer = std::make_shared<const eosio::send_buffer>(
+            create_frame_head( payload_size, payload_size, [&m]( auto& ds ) { fc::raw::pack( ds, m ); } ) );
 
       enqueue_buffer( send_buffer, trigger_send, priority::low, close_after_send );
    }
 
    template< typename T>
-   static std::shared_ptr<std::vector<char>> create_send_buffer( uint32_t which, const T& v ) {
+   static send_buffer_ptr create_send_buffer( uint32_t which, const T& v ) {
       // match net_message static_variant pack
       const uint32_t which_size = fc::raw::pack_size( unsigned_int( which ) );
       const uint32_t payload_size = which_size + fc::raw::pack_size( v );
 
-      const char* const header = reinterpret_cast<const char* const>(&payload_size); // avoid variable size encoding of uint32_t
-      constexpr size_t header_size = sizeof( payload_size );
-      static_assert( header_size == message_header_size, "invalid message_header_size" );
-      const size_t buffer_size = header_size + payload_size;
-
-      auto send_buffer = std::make_shared<vector<char>>( buffer_size );
-      fc::datastream<char*> ds( send_buffer->data(), buffer_size );
-      ds.write( header, header_size );
-      fc::raw::pack( ds, unsigned_int( which ) );
-      fc::raw::pack( ds, v );
-
-      return send_buffer;
+      return std::make_shared<const send_buffer>( create_frame_head( payload_size, payload_size, [which, &v]( auto& ds ) {
+         fc::raw::pack( ds, unsigned_int( which ) );
+         fc::raw::pack( ds, v );
+      } ) );
    }
 
-   static std::shared_ptr<std::vector<char>> create_send_buffer( const signed_block_ptr& sb ) {
+   static send_buffer_ptr create_send_buffer( const signed_block_ptr& sb ) {
       // this implementation is to avoid copy of signed_block to net_message
       // matches which of net_message for signed_block
       return create_send_buffer( signed_block_which, *sb );
    }
 
-   static std::shared_ptr<std::vector<char>> create_send_buffer( const packed_transaction& trx ) {
+   static send_buffer_ptr create_send_buffer( const block_state_ptr& bs ) {
+      // the bytes block_state packed once for all consumers are sent as they are, after a head with the length and which
+      // matches which of net_message for signed_block
+      packed_block_ptr packed = bs->packed_block();
+      const uint32_t which_size = fc::raw::pack_size( unsigned_int( signed_block_which ) );
+      const uint32_t payload_size = which_size + packed->size();
+
+      return std::make_shared<const send_buffer>( create_frame_head( payload_size, which_size, []( auto& ds ) {
+         fc::raw::pack( ds, unsigned_int( signed_block_which ) );
+      } ), std::move( packed ) );
+   }
+
+   static send_buffer_ptr create_compact_send_buffer( const block_state_ptr& bs ) {
+      const signed_block& b = *bs->block;
+      compact_block_message msg;
+      msg.header = static_cast<const signed_block_header&>( b );
+      msg.transactions.reserve( b.transactions.size() );
+      for( const auto& r : b.transactions ) {
+         compact_transaction_receipt cr;
+         static_cast<transaction_receipt_header&>( cr ) = r;
+         if( r.trx.contains<transaction_id_type>() ) {
+            cr.trx = r.trx.get<transaction_id_type>();
+         } else {
+            cr.trx = short_transaction_id( r.trx.get<packed_transaction>().id() );
+         }
+         msg.transactions.emplace_back( std::move( cr ) );
+      }
+      msg.block_extensions = b.block_extensions;
+      return create_send_buffer( compact_block_which, msg );
+   }
+
+   static send_buffer_ptr create_send_buffer( const packed_transaction& trx ) {
       // this implementation is to avoid copy of packed_transaction to net_message
       // matches which of net_message for packed_transaction
       return create_send_buffer( packed_transaction_which, trx );
@@ -1106,7 +1219,11 @@ namespace eosio {
       enqueue_buffer( create_send_buffer( sb ), trigger_send, priority::low, no_reason, to_sync_queue);
    }
 
-   void connection::enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
+   void connection::enqueue_block( const block_state_ptr& bs, bool trigger_send, bool to_sync_queue) {
+      enqueue_buffer( create_send_buffer( bs ), trigger_send, priority::low, no_reason, to_sync_queue);
+   }
+
+   void connection::enqueue_buffer( const send_buffer_ptr& send_buffer,
                                     bool trigger_send, int priority, go_away_reason close_after_send,
                                     bool to_sync_queue)
    {
@@ -1183,12 +1300,8 @@ namespace eosio {
       if( !peer_addr.empty() ) {
          return peer_addr;
       }
-      if( socket != nullptr ) {
-         boost::system::error_code ec;
-         auto rep = socket->remote_endpoint(ec);
-         if( !ec ) {
-            return rep.address().to_string() + ':' + std::to_string( rep.port() );
-         }
+      if( remote_endpoint ) {
+         return remote_endpoint->address().to_string() + ':' + std::to_string( remote_endpoint->port() );
       }
       return "connecting client";
    }
@@ -1229,11 +1342,12 @@ namespace eosio {
 
    //-----------------------------------------------------------
 
-    sync_manager::sync_manager( uint32_t req_span )
+    sync_manager::sync_manager( uint32_t req_span, uint32_t fetch_peers )
       :sync_known_lib_num( 0 )
       ,sync_last_requested_num( 0 )
       ,sync_next_expected_num( 1 )
       ,sync_req_span( req_span )
+      ,sync_fetch_peers( fetch_peers )
       ,source()
       ,state(in_sync)
    {
@@ -1255,6 +1369,9 @@ namespace eosio {
          return;
       }
       fc_dlog(logger, "old state ${os} becoming ${ns}",("os",stage_str(state))("ns",stage_str(newstate)));
+      if (state == lib_catchup) {
+         reset_sync_pipeline();
+      }
       state = newstate;
    }
 
@@ -1276,6 +1393,12 @@ namespace eosio {
          if( c->last_handshake_recv.last_irreversible_block_num > sync_known_lib_num) {
             sync_known_lib_num =c->last_handshake_recv.last_irreversible_block_num;
          }
+      } else if( pipelining() ) {
+         auto chunk = find_sync_chunk( c );
+         if( chunk != sync_chunks.end() ) {
+            sync_chunks.erase( chunk );
+            request_next_chunk();
+         }
       } else if( c == source ) {
          sync_last_requested_num = 0;
          request_next_chunk();
@@ -1291,6 +1414,11 @@ namespace eosio {
    }
 
    void sync_manager::request_next_chunk( const connection_ptr& conn ) {
+      if( pipelining() ) {
+         request_sync_chunks( conn );
+         return;
+      }
+
       uint32_t head_block = chain_plug->chain().fork_db_pending_head_block_num();
 
       if (head_block < sync_last_requested_num && source && source->current()) {
@@ -1413,6 +1541,16 @@ namespace eosio {
       fc_ilog(logger, "reassign_fetch, our last req is ${cc}, next expected is ${ne} peer ${p}",
               ( "cc",sync_last_requested_num)("ne",sync_next_expected_num)("p",c->peer_name()));
 
+      if( pipelining() ) {
+         auto chunk = find_sync_chunk( c );
+         if( chunk != sync_chunks.end() ) {
+            c->cancel_sync(reason);
+            sync_chunks.erase( chunk );
+            request_next_chunk();
+         }
+         return;
+      }
+
       if (c == source) {
          c->cancel_sync(reason);
          sync_last_requested_num = 0;
@@ -1548,13 +1686,32 @@ namespace eosio {
          fc_wlog( logger, "block ${bn} not accepted from ${p}, closing connection", ("bn",blk_num)("p",c->peer_name()) );
          sync_last_requested_num = 0;
          source.reset();
-         my_impl->close(c);
+         // before the close, so that the chunk of c is not requested again
          set_state(in_sync);
+         my_impl->close(c);
          send_handshakes();
       }
    }
    void sync_manager::recv_block(const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num) {
       fc_dlog(logger, "got block ${bn} from ${p}",("bn",blk_num)("p",c->peer_name()));
+      if( pipelining() ) {
+         // blocks are applied in order by apply_sync_blocks, any other block leaves the reorder buffer as it is
+         if( blk_num != sync_next_expected_num ) {
+            fc_dlog( logger, "block ${bn} is not the next one to apply, ${ne}", ("bn",blk_num)("ne",sync_next_expected_num) );
+            return;
+         }
+         sync_next_expected_num = blk_num + 1;
+         if( blk_num >= sync_known_lib_num ) {
+            fc_dlog( logger, "All caught up with last known last irreversible block resending handshake");
+            set_state(in_sync);
+            send_handshakes();
+            return;
+         }
+         validate_sync_blocks();
+         apply_sync_blocks();
+         request_sync_chunks( connection_ptr() );
+         return;
+      }
       if (state == lib_catchup) {
          if (blk_num != sync_next_expected_num) {
             fc_wlog( logger, "expected block ${ne} but got ${bn}, closing connection: ${p}",
@@ -1603,6 +1760,253 @@ namespace eosio {
       }
    }
 
+   void sync_manager::recv_sync_block(const connection_ptr& c, const signed_block_ptr& blk, const block_id_type& blk_id, uint32_t blk_num) {
+      fc_dlog(logger, "got block ${bn} from ${p}",("bn",blk_num)("p",c->peer_name()));
+      bool chunk_done = false;
+      auto chunk = find_sync_chunk( c );
+      if( chunk != sync_chunks.end() && blk_num >= chunk->second.next && blk_num <= chunk->first ) {
+         // blocks the peer skipped are found by sync_gaps and requested again
+         if( blk_num == chunk->first ) {
+            sync_chunks.erase( chunk );
+            chunk_done = true;
+         } else {
+            chunk->second.next = blk_num + 1;
+            c->sync_wait();
+         }
+      }
+      if( blk ) {
+         // blocks from other than the source of the chunk, e.g. still in flight when it was reassigned, are kept too
+         bool keep = blk_num >= sync_next_expected_num && blk_num <= sync_known_lib_num;
+         if( keep ) {
+            auto res = sync_blocks.emplace( blk_num, sync_block{ c, blk, blk_id } );
+            keep = res.first->second.id == blk_id;
+         }
+         if( !keep ) {
+            fc_dlog( logger, "dropping block ${bn} from ${p}, not needed", ("bn",blk_num)("p",c->peer_name()) );
+            my_impl->forget_received_block( blk_id );
+         }
+      }
+      validate_sync_blocks();
+      apply_sync_blocks();
+      if( chunk_done ) {
+         request_sync_chunks( connection_ptr() );
+      }
+   }
+
+   std::map<uint32_t, sync_manager::sync_chunk>::iterator sync_manager::find_sync_chunk(const connection_ptr& c) {
+      return std::find_if( sync_chunks.begin(), sync_chunks.end(),
+                           [&c]( const auto& chunk ) { return chunk.second.source == c; } );
+   }
+
+   connection_ptr sync_manager::next_sync_source(const connection_ptr& conn) {
+      auto available = [this]( const connection_ptr& c ) {
+         return c->current() && find_sync_chunk( c ) == sync_chunks.end();
+      };
+      if( conn && available( conn ) ) {
+         source = conn;
+         return source;
+      }
+      // round-robin, starting after the last source chosen
+      const auto& conns = my_impl->connections;
+      auto itr = source ? conns.find( source ) : conns.end();
+      itr = (itr == conns.end()) ? conns.begin() : std::next( itr );
+      for( size_t i = 0; i < conns.size(); ++i, ++itr ) {
+         if( itr == conns.end() )
+            itr = conns.begin();
+         if( available( *itr ) ) {
+            source = *itr;
+            return source;
+         }
+      }
+      return connection_ptr();
+   }
+
+   vector<std::pair<uint32_t, uint32_t>> sync_manager::sync_gaps(uint32_t last)const {
+      vector<std::pair<uint32_t, uint32_t>> gaps;
+      for( uint32_t n = sync_next_expected_num; n <= last; ++n ) {
+         if( sync_blocks.count( n ) )
+            continue;
+         auto chunk = sync_chunks.lower_bound( n );
+         if( chunk != sync_chunks.end() && chunk->second.next <= n ) {
+            n = chunk->first;
+            continue;
+         }
+         if( !gaps.empty() && gaps.back().second + 1 == n && n - gaps.back().first < sync_req_span )
+            gaps.back().second = n;
+         else
+            gaps.emplace_back( n, n );
+      }
+      return gaps;
+   }
+
+   void sync_manager::request_sync_chunks(const connection_ptr& conn) {
+      if( !pipelining() )
+         return; // the pipeline was given up meanwhile
+      if( sync_last_requested_num + 1 < sync_next_expected_num )
+         sync_last_requested_num = sync_next_expected_num - 1;
+      // no further ahead of the block being applied than the chunks in flight and as many again waiting
+      const uint32_t window_end = sync_next_expected_num + sync_req_span * sync_fetch_peers * 2;
+      const auto gaps = sync_gaps( std::min( sync_last_requested_num, window_end ) );
+      auto gap = gaps.begin();
+      bool no_source = false;
+      while( sync_chunks.size() < sync_fetch_peers ) {
+         uint32_t start = sync_last_requested_num + 1;
+         uint32_t end = 0;
+         if( gap != gaps.end() ) {
+            start = gap->first;
+            end = gap->second;
+         } else if( start <= sync_known_lib_num && start <= window_end ) {
+            end = std::min( start + sync_req_span - 1, sync_known_lib_num );
+         } else {
+            break;
+         }
+         connection_ptr c = next_sync_source( conn );
+         if( !c ) {
+            no_source = true;
+            break;
+         }
+         if( gap != gaps.end() )
+            ++gap;
+         else
+            sync_last_requested_num = end;
+         fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
+                 ("n",c->peer_name())("s",start)("e",end));
+         sync_chunks[end] = sync_chunk{ start, c };
+         c->request_sync_blocks(start, end);
+      }
+      if( no_source && sync_chunks.empty() ) {
+         fc_elog( logger, "Unable to continue syncing at this time");
+         sync_known_lib_num = chain_plug->chain().last_irreversible_block_num();
+         sync_last_requested_num = 0;
+         set_state(in_sync); // probably not, but we can't do anything else
+      }
+   }
+
+   void sync_manager::validate_sync_blocks() {
+      if( sync_validating || !pipelining() )
+         return;
+      controller& cc = chain_plug->chain();
+      sync_validated_num = std::max( sync_validated_num, sync_next_expected_num - 1 );
+      for( auto itr = sync_blocks.find( sync_validated_num + 1 ); itr != sync_blocks.end();
+           itr = sync_blocks.find( sync_validated_num + 1 ) ) {
+         sync_block& b = itr->second;
+         if( cc.fetch_block_by_id( b.id ) ) {
+            // nothing to push, the block was received before
+            b.state = cc.fetch_block_state_by_id( b.id );
+            b.validated = true;
+            ++sync_validated_num;
+            continue;
+         }
+
+         block_header_state_ptr prev;
+         auto prev_itr = sync_blocks.find( itr->first - 1 );
+         if( prev_itr != sync_blocks.end() ) {
+            if( !prev_itr->second.state )
+               return; // the previous block is validated as it is applied, this one can be after that
+            prev = prev_itr->second.state;
+         } else {
+            prev = (cc.head_block_id() == b.block->previous) ? cc.head_block_state()
+                                                             : cc.fetch_block_state_by_id( b.block->previous );
+            if( !prev ) {
+               // e.g. the previous block is the root of the fork database, leave the block to the controller
+               b.validated = true;
+               ++sync_validated_num;
+               continue;
+            }
+         }
+
+         const uint32_t blk_num = itr->first;
+         // the validation posts its own result back, so it is handled as soon as it is ready
+         auto done = [this, generation = sync_generation, blk_num]( const block_state_ptr& bsp, const std::exception_ptr& eptr ) {
+            string error;
+            if( eptr ) {
+               try {
+                  std::rethrow_exception( eptr );
+               } catch( const fc::exception& e ) {
+                  error = e.to_string();
+               } catch( const std::exception& e ) {
+                  error = e.what();
+               } catch( ... ) {
+                  error = "unknown exception";
+               }
+            }
+            app().post( priority::medium, [this, generation, blk_num, bsp, error{std::move( error )}]() {
+               sync_block_validated( generation, blk_num, bsp, error );
+            } );
+         };
+         try {
+            cc.create_block_state_async( b.block, prev, std::move( done ) );
+         } catch( const fc::exception& e ) {
+            sync_block_validated( sync_generation, blk_num, block_state_ptr(), e.to_string() );
+            return;
+         }
+         sync_validating = true;
+         return;
+      }
+   }
+
+   void sync_manager::sync_block_validated(uint32_t generation, uint32_t blk_num, const block_state_ptr& bsp, const string& error) {
+      if( generation != sync_generation )
+         return;
+      sync_validating = false;
+      auto itr = sync_blocks.find( blk_num );
+      if( itr == sync_blocks.end() )
+         return;
+      if( bsp ) {
+         itr->second.state = bsp;
+         itr->second.validated = true;
+         sync_validated_num = blk_num;
+         apply_sync_blocks();
+      } else {
+         connection_ptr c = itr->second.source;
+         fc_wlog( logger, "block ${bn} not valid: ${e}, closing connection: ${p}", ("bn",blk_num)("e",error)("p",c->peer_name()) );
+         // what else c sent from this block on goes too, the blocks from other peers are validated again later
+         for( auto b = itr; b != sync_blocks.end(); ) {
+            if( b->second.source == c ) {
+               my_impl->forget_received_block( b->second.id );
+               b = sync_blocks.erase( b );
+            } else {
+               ++b;
+            }
+         }
+         my_impl->close( c );
+         request_sync_chunks( connection_ptr() );
+      }
+      validate_sync_blocks();
+   }
+
+   void sync_manager::apply_sync_blocks() {
+      if( sync_applying )
+         return;
+      auto itr = sync_blocks.find( sync_next_expected_num );
+      if( itr == sync_blocks.end() || !itr->second.validated )
+         return;
+      sync_applying = true;
+      // one block per post, so that the messages and validation results received meanwhile are not held up
+      app().post( priority::medium, [this, generation = sync_generation]() {
+         if( generation != sync_generation )
+            return;
+         sync_applying = false;
+         auto itr = sync_blocks.find( sync_next_expected_num );
+         if( itr == sync_blocks.end() || !itr->second.validated )
+            return;
+         sync_block b = std::move( itr->second );
+         sync_blocks.erase( itr );
+         my_impl->process_block( b.source, b.block, b.id, b.state );
+      } );
+   }
+
+   void sync_manager::reset_sync_pipeline() {
+      for( const auto& b : sync_blocks )
+         my_impl->forget_received_block( b.second.id );
+      sync_blocks.clear();
+      sync_chunks.clear();
+      sync_validated_num = 0;
+      sync_validating = false;
+      sync_applying = false;
+      ++sync_generation;
+   }
+
    //------------------------------------------------------------------------
 
    void dispatch_manager::bcast_block(const block_state_ptr& bs) {
@@ -1616,7 +2020,8 @@ namespace eosio {
       uint32_t bnum = bs->block_num;
       peer_block_state pbstate{bs->id, bnum};
 
-      std::shared_ptr<std::vector<char>> send_buffer;
+      send_buffer_ptr send_buffer;
+      send_buffer_ptr compact_send_buffer;
       for( auto& cp : my_impl->connections ) {
          if( skips.find( cp ) != skips.end() || !cp->current() ) {
             continue;
@@ -1626,8 +2031,16 @@ namespace eosio {
             if( !cp->add_peer_block( pbstate ) ) {
                continue;
             }
+            if( cp->protocol_version >= proto_compact_blocks ) {
+               if( !compact_send_buffer ) {
+                  compact_send_buffer = create_compact_send_buffer( bs );
+               }
+               fc_dlog(logger, "bcast compact block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()));
+               cp->enqueue_buffer( compact_send_buffer, true, priority::high, no_reason );
+               continue;
+            }
             if( !send_buffer ) {
-               send_buffer = create_send_buffer( bs->block );
+               send_buffer = create_send_buffer( bs );
             }
             fc_dlog(logger, "bcast block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()));
             cp->enqueue_buffer( send_buffer, true, priority::high, no_reason );
@@ -1678,7 +2091,7 @@ namespace eosio {
       }
       received_transactions.erase(range.first, range.second);
 
-      if( my_impl->local_txns.get<by_id>().find( id ) != my_impl->local_txns.end() ) { //found
+      if( my_impl->local_txns.contains( id ) ) { //found
          fc_dlog(logger, "found trxid in local_trxs" );
          return;
       }
@@ -1688,17 +2101,15 @@ namespace eosio {
 
       auto buff = create_send_buffer( trx );
 
-      node_transaction_state nts = {id, trx_expiration, 0, buff};
+      node_transaction_state nts = {id, trx_expiration, 0, buff, ptrx->packed_trx};
       my_impl->local_txns.insert(std::move(nts));
 
       my_impl->send_transaction_to_all( buff, [&id, &skips, trx_expiration](const connection_ptr& c) -> bool {
          if( skips.find(c) != skips.end() || c->syncing ) {
             return false;
           }
-          const auto& bs = c->trx_state.find(id);
-          bool unknown = bs == c->trx_state.end();
+          bool unknown = c->trx_state.insert(transaction_state({id,0,trx_expiration}));
           if( unknown ) {
-             c->trx_state.insert(transaction_state({id,0,trx_expiration}));
              fc_dlog(logger, "sending trx to ${n}", ("n",c->peer_name() ) );
           }
           return unknown;
@@ -1802,8 +2213,7 @@ namespace eosio {
          }
          bool sendit = false;
          if (is_txn) {
-            auto trx = conn->trx_state.get<by_id>().find(tid);
-            sendit = trx != conn->trx_state.end();
+            sendit = conn->trx_state.contains(tid);
          }
          else {
             sendit = conn->peer_has_block(bid);
@@ -1876,35 +2286,45 @@ namespace eosio {
       auto current_endpoint = *endpoint_itr;
       ++endpoint_itr;
       c->connecting = true;
-      c->pending_message_buffer.reset();
       connection_wptr weak_conn = c;
-      c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
-            [weak_conn, endpoint_itr, this]( const boost::system::error_code& err ) {
-         app().post( priority::low, [weak_conn, endpoint_itr, this, err]() {
-            auto c = weak_conn.lock();
-            if( !c ) return;
-            if( !err && c->socket->is_open()) {
-               if( start_session( c )) {
-                  c->send_handshake();
-               }
-            } else {
-               if( endpoint_itr != tcp::resolver::iterator()) {
-                  close( c );
-                  connect( c, endpoint_itr );
+      // on the strand, behind the close of the previous session
+      boost::asio::post( c->strand, [c, current_endpoint, endpoint_itr, weak_conn, this]() {
+         c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
+               [weak_conn, endpoint_itr, this]( const boost::system::error_code& err ) {
+            app().post( priority::low, [weak_conn, endpoint_itr, this, err]() {
+               auto c = weak_conn.lock();
+               if( !c ) return;
+               if( !err && c->connecting ) {
+                  c->socket_open = true;
+                  if( start_session( c )) {
+                     c->send_handshake();
+                  }
                } else {
-                  fc_elog( logger, "connection failed to ${peer}: ${error}", ("peer", c->peer_name())( "error", err.message()));
-                  c->connecting = false;
-                  my_impl->close( c );
+                  if( endpoint_itr != tcp::resolver::iterator()) {
+                     close( c );
+                     connect( c, endpoint_itr );
+                  } else {
+                     fc_elog( logger, "connection failed to ${peer}: ${error}", ("peer", c->peer_name())( "error", err.message()));
+                     c->connecting = false;
+                     my_impl->close( c );
+                  }
                }
-            }
-         } );
-      } ) );
+            } );
+         } ) );
+      } );
    }
 
    bool net_plugin_impl::start_session(const connection_ptr& con) {
       boost::asio::ip::tcp::no_delay nodelay( true );
       boost::system::error_code ec;
+      // nothing else uses the socket yet: the previous session was closed on the strand before the connect was started
       con->socket->set_option( nodelay, ec );
+      if (!ec) {
+         con->remote_endpoint = con->socket->remote_endpoint( ec );
+      }
+      if (!ec) {
+         con->local_endpoint = con->socket->local_endpoint( ec );
+      }
       if (ec) {
          fc_elog( logger, "connection failed to ${peer}: ${error}", ( "peer", con->peer_name())("error",ec.message()) );
          con->connecting = false;
@@ -1912,7 +2332,12 @@ namespace eosio {
          return false;
       }
       else {
-         start_read_message( con );
+         boost::asio::post( con->strand, [this, con]() {
+            con->pending_message_buffer.reset();
+            con->outstanding_read_bytes.reset();
+            con->reads_in_flight = 0;
+            start_read_message( con );
+         } );
          ++started_sessions;
          return true;
          // for now, we can just use the application main loop.
@@ -1936,11 +2361,10 @@ namespace eosio {
                }
                else {
                   for (auto &conn : connections) {
-                     if(conn->socket->is_open()) {
+                     if(conn->socket_open) {
                         if (conn->peer_addr.empty()) {
                            visitors++;
-                           boost::system::error_code ec;
-                           if (paddr == conn->socket->remote_endpoint(ec).address()) {
+                           if (conn->remote_endpoint && paddr == conn->remote_endpoint->address()) {
                               from_addr++;
                            }
                         }
@@ -2014,35 +2438,42 @@ namespace eosio {
             }
          };
 
-         if( conn->buffer_queue.write_queue_size() > def_max_write_queue_size ||
+         uint32_t write_queue_size = conn->buffer_queue.write_queue_size();
+         uint32_t trx_in_progress_size = conn->trx_in_progress_size;
+         if( write_queue_size > def_max_write_queue_size ||
              conn->reads_in_flight > def_max_reads_in_flight   ||
-             conn->trx_in_progress_size > def_max_trx_in_progress_size )
+             trx_in_progress_size > def_max_trx_in_progress_size )
          {
             // too much queued up, reschedule
-            if( conn->buffer_queue.write_queue_size() > def_max_write_queue_size ) {
-               peer_wlog( conn, "write_queue full ${s} bytes", ("s", conn->buffer_queue.write_queue_size()) );
+            // logged on the main thread, which owns what names the peer
+            if( write_queue_size > def_max_write_queue_size ) {
+               app().post( priority::low, [conn, write_queue_size]() {
+                  peer_wlog( conn, "write_queue full ${s} bytes", ("s", write_queue_size) );
+               } );
             } else if( conn->reads_in_flight > def_max_reads_in_flight ) {
-               peer_wlog( conn, "max reads in flight ${s}", ("s", conn->reads_in_flight) );
+               app().post( priority::low, [conn, reads_in_flight = conn->reads_in_flight]() {
+                  peer_wlog( conn, "max reads in flight ${s}", ("s", reads_in_flight) );
+               } );
             } else {
-               peer_wlog( conn, "max trx in progress ${s} bytes", ("s", conn->trx_in_progress_size) );
+               app().post( priority::low, [conn, trx_in_progress_size]() {
+                  peer_wlog( conn, "max trx in progress ${s} bytes", ("s", trx_in_progress_size) );
+               } );
             }
-            if( conn->buffer_queue.write_queue_size() > 2*def_max_write_queue_size ||
+            if( write_queue_size > 2*def_max_write_queue_size ||
                 conn->reads_in_flight > 2*def_max_reads_in_flight   ||
-                conn->trx_in_progress_size > 2*def_max_trx_in_progress_size )
+                trx_in_progress_size > 2*def_max_trx_in_progress_size )
             {
-               fc_wlog( logger, "queues over full, giving up on connection ${p}", ("p", conn->peer_name()) );
-               my_impl->close( conn );
+               close_from_strand( conn, fc::log_level::warn, "queues over full, giving up on connection" );
                return;
             }
             if( !conn->read_delay_timer ) return;
             conn->read_delay_timer->expires_from_now( def_read_delay_for_full_write_queue );
-            conn->read_delay_timer->async_wait( [this, weak_conn]( boost::system::error_code ec ) {
-               app().post( priority::low, [this, weak_conn]() {
-                  auto conn = weak_conn.lock();
-                  if( !conn ) return;
-                  start_read_message( conn );
-               } );
-            } );
+            conn->read_delay_timer->async_wait( boost::asio::bind_executor( conn->strand,
+                  [this, weak_conn]( boost::system::error_code ec ) {
+               auto conn = weak_conn.lock();
+               if( !conn ) return;
+               start_read_message( conn );
+            } ) );
             return;
          }
 
@@ -2051,97 +2482,88 @@ namespace eosio {
             conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
             boost::asio::bind_executor( conn->strand,
             [this,weak_conn]( boost::system::error_code ec, std::size_t bytes_transferred ) {
-            app().post( priority::medium, [this,weak_conn, ec, bytes_transferred]() {
-               auto conn = weak_conn.lock();
-               if (!conn || !conn->socket || !conn->socket->is_open()) {
-                  return;
-               }
+            auto conn = weak_conn.lock();
+            // an aborted read belongs to a session that was closed, the socket may be open again for the next one
+            if (!conn || !conn->socket || !conn->socket->is_open() || ec == boost::asio::error::operation_aborted) {
+               return;
+            }
 
-               --conn->reads_in_flight;
-               conn->outstanding_read_bytes.reset();
+            --conn->reads_in_flight;
+            conn->outstanding_read_bytes.reset();
 
-               try {
-                  if( !ec ) {
-                     if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
-                        fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
-                                 ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
-                     }
-                     EOS_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
-                     conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
-                     while (conn->pending_message_buffer.bytes_to_read() > 0) {
-                        uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
+            try {
+               if( !ec ) {
+                  if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
+                     fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
+                              ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
+                  }
+                  EOS_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
+                  conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
+                  while (conn->pending_message_buffer.bytes_to_read() > 0) {
+                     uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
+
+                     if (bytes_in_buffer < message_header_size) {
+                        conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
+                        break;
+                     } else {
+                        uint32_t message_length;
+                        auto index = conn->pending_message_buffer.read_index();
+                        conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
+                        if(message_length > def_send_buffer_size*2 || message_length == 0) {
+                           boost::system::error_code ec;
+                           fc_elog( logger,"incoming message length unexpected (${i}), from ${p}",
+                                    ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))) );
+                           close_from_strand( conn, fc::log_level::error, "incoming message length unexpected" );
+                           return;
+                        }
 
-                        if (bytes_in_buffer < message_header_size) {
-                           conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
-                           break;
-                        } else {
-                           uint32_t message_length;
-                           auto index = conn->pending_message_buffer.read_index();
-                           conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
-                           if(message_length > def_send_buffer_size*2 || message_length == 0) {
-                              boost::system::error_code ec;
-                              fc_elog( logger,"incoming message length unexpected (${i}), from ${p}",
-                                       ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))) );
-                              close(conn);
+                        auto total_message_bytes = message_length + message_header_size;
+
+                        if (bytes_in_buffer >= total_message_bytes) {
+                           conn->pending_message_buffer.advance_read_ptr(message_header_size);
+                           if (!process_next_message(conn, message_length)) {
                               return;
                            }
-
-                           auto total_message_bytes = message_length + message_header_size;
-
-                           if (bytes_in_buffer >= total_message_bytes) {
-                              conn->pending_message_buffer.advance_read_ptr(message_header_size);
-                              if (!process_next_message(conn, message_length)) {
-                                 return;
-                              }
-                           } else {
-                              auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
-                              auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
-                              if (outstanding_message_bytes > available_buffer_bytes) {
-                                 conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
-                              }
-
-                              conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
-                              break;
+                        } else {
+                           auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
+                           auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
+                           if (outstanding_message_bytes > available_buffer_bytes) {
+                              conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
                            }
+
+                           conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
+                           break;
                         }
                      }
-                     start_read_message(conn);
+                  }
+                  start_read_message(conn);
+               } else {
+                  if (ec.value() != boost::asio::error::eof) {
+                     close_from_strand( conn, fc::log_level::error, "Error reading message: " + ec.message() );
                   } else {
-                     auto pname = conn->peer_name();
-                     if (ec.value() != boost::asio::error::eof) {
-                        fc_elog( logger, "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
-                     } else {
-                        fc_ilog( logger, "Peer ${p} closed connection",("p",pname) );
-                     }
-                     close( conn );
+                     close_from_strand( conn, fc::log_level::info, "Peer closed connection" );
                   }
                }
-               catch(const std::exception &ex) {
-                  fc_elog( logger, "Exception in handling read data from ${p}: ${s}",
-                           ("p",conn->peer_name())("s",ex.what()) );
-                  close( conn );
-               }
-               catch(const fc::exception &ex) {
-                  fc_elog( logger, "Exception in handling read data from ${p}: ${s}",
-                           ("p",conn->peer_name())("s",ex.to_string()) );
-                  close( conn );
-               }
-               catch (...) {
-                  fc_elog( logger, "Undefined exception handling the read data from ${p}",( "p",conn->peer_name()) );
-                  close( conn );
-               }
-            });
+            }
+            catch(const std::exception &ex) {
+               close_from_strand( conn, fc::log_level::error, string("Exception in handling read data: ") + ex.what() );
+            }
+            catch(const fc::exception &ex) {
+               close_from_strand( conn, fc::log_level::error, "Exception in handling read data: " + ex.to_string() );
+            }
+            catch (...) {
+               close_from_strand( conn, fc::log_level::error, "Undefined exception handling the read data" );
+            }
          }));
       } catch (...) {
-         string pname = conn ? conn->peer_name() : "no connection name";
-         fc_elog( logger, "Undefined exception handling reading ${p}",("p",pname) );
-         close( conn );
+         close_from_strand( conn, fc::log_level::error, "Undefined exception handling reading" );
       }
    }
 
    bool net_plugin_impl::process_next_message(const connection_ptr& conn, uint32_t message_length) {
+      optional<block_id_type> peeked_blk_id;
       try {
-         // if next message is a block we already have, exit early
+         // if next message is a block already decoded from another peer, only tell the main thread that this peer has it
          auto peek_ds = conn->pending_message_buffer.create_peek_datastream();
          unsigned_int which{};
          fc::raw::unpack( peek_ds, which );
@@ -2149,12 +2571,33 @@ namespace eosio {
             block_header bh;
             fc::raw::unpack( peek_ds, bh );
 
-            controller& cc = chain_plug->chain();
             block_id_type blk_id = bh.id();
             uint32_t blk_num = bh.block_num();
-            if( cc.fetch_block_by_id( blk_id ) ) {
-               sync_master->recv_block( conn, blk_id, blk_num );
+            bool received = false;
+            {
+               std::lock_guard<std::mutex> g( received_block_ids_mtx );
+               received = !received_block_ids.emplace( blk_id, blk_num ).second;
+            }
+            if( received ) {
+               conn->pending_message_buffer.advance_read_ptr( message_length );
+               post_received_block( conn, blk_id, blk_num );
+               return true;
+            }
+            peeked_blk_id = blk_id;
+         } else if( which == compact_block_which ) {
+            // a compact block is not recorded as received, as it may not be complete; full copies are still decoded
+            block_header bh;
+            fc::raw::unpack( peek_ds, bh );
+
+            block_id_type blk_id = bh.id();
+            bool received = false;
+            {
+               std::lock_guard<std::mutex> g( received_block_ids_mtx );
+               received = received_block_ids.find( blk_id ) != received_block_ids.end();
+            }
+            if( received ) {
                conn->pending_message_buffer.advance_read_ptr( message_length );
+               post_received_block( conn, blk_id, bh.block_num() );
                return true;
             }
          }
@@ -2162,28 +2605,75 @@ namespace eosio {
          auto ds = conn->pending_message_buffer.create_datastream();
          net_message msg;
          fc::raw::unpack( ds, msg );
-         msg_handler m( *this, conn );
          if( msg.contains<signed_block>() ) {
-            m( std::move( msg.get<signed_block>() ) );
+            auto ptr = std::make_shared<signed_block>( std::move( msg.get<signed_block>() ) );
+            app().post( priority::medium, [this, conn, ptr, blk_id = *peeked_blk_id]() {
+               handle_message( conn, ptr, blk_id );
+            } );
          } else if( msg.contains<packed_transaction>() ) {
-            m( std::move( msg.get<packed_transaction>() ) );
+            // computes the id, and the digest of the signed transaction
+            auto ptrx = std::make_shared<transaction_metadata>(
+                  std::make_shared<packed_transaction>( std::move( msg.get<packed_transaction>() ) ) );
+            if( local_txns.contains( ptrx->id ) ) {
+               fc_dlog( logger, "got a duplicate transaction - dropping" );
+               return true;
+            }
+            app().post( priority::medium, [this, conn, ptrx]() {
+               handle_message( conn, ptrx );
+            } );
          } else {
-            msg.visit( m );
+            app().post( priority::medium, [this, conn, msg{std::move( msg )}]() {
+               msg_handler m( *this, conn );
+               msg.visit( m );
+            } );
          }
       } catch( const fc::exception& e ) {
-         fc_elog( logger, "Exception in handling message from ${p}: ${s}",
-                  ("p", conn->peer_name())("s", e.to_detail_string()) );
-         close( conn );
+         if( peeked_blk_id ) {
+            std::lock_guard<std::mutex> g( received_block_ids_mtx );
+            received_block_ids.erase( *peeked_blk_id );
+         }
+         close_from_strand( conn, fc::log_level::error, "Exception in handling message: " + e.to_detail_string() );
          return false;
       }
       return true;
    }
 
+   void net_plugin_impl::post_received_block(const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num) {
+      app().post( priority::medium, [this, c, blk_id, blk_num]() {
+         if( sync_master->pipelining() ) {
+            sync_master->recv_sync_block( c, signed_block_ptr(), blk_id, blk_num );
+            return;
+         }
+         // the first copy was handled before this one, and is in the chain unless it was rejected
+         if( chain_plug->chain().fetch_block_by_id( blk_id ) ) {
+            sync_master->recv_block( c, blk_id, blk_num );
+         }
+      } );
+   }
+
+   void net_plugin_impl::forget_received_block(const block_id_type& blk_id) {
+      std::lock_guard<std::mutex> g( received_block_ids_mtx );
+      received_block_ids.erase( blk_id );
+   }
+
+   void net_plugin_impl::close_from_strand(const connection_ptr& c, fc::log_level level, string reason) {
+      app().post( priority::medium, [this, c, level, reason{std::move( reason )}]() {
+         if( level == fc::log_level::info ) {
+            fc_ilog( logger, "${r}: ${p}", ("r", reason)("p", c->peer_name()) );
+         } else if( level == fc::log_level::warn ) {
+            fc_wlog( logger, "${r}: ${p}", ("r", reason)("p", c->peer_name()) );
+         } else {
+            fc_elog( logger, "${r}: ${p}", ("r", reason)("p", c->peer_name()) );
+         }
+         close( c );
+      } );
+   }
+
    size_t net_plugin_impl::count_open_sockets() const
    {
       size_t count = 0;
       for( auto &c : connections) {
-         if(c->socket->is_open())
+         if(c->socket_open)
             ++count;
       }
       return count;
@@ -2191,7 +2681,7 @@ namespace eosio {
 
 
    template<typename VerifierFunc>
-   void net_plugin_impl::send_transaction_to_all(const std::shared_ptr<std::vector<char>>& send_buffer, VerifierFunc verify) {
+   void net_plugin_impl::send_transaction_to_all(const send_buffer_ptr& send_buffer, VerifierFunc verify) {
       for( auto &c : connections) {
          if( c->current() && verify( c )) {
             c->enqueue_buffer( send_buffer, true, priority::low, no_reason );
@@ -2404,9 +2894,10 @@ namespace eosio {
             send_req = true;
             size_t known_sum = local_txns.size();
             if( known_sum ) {
-               for( const auto& t : local_txns.get<by_id>() ) {
+               req.req_trx.ids.reserve( known_sum );
+               local_txns.for_each( [&req]( const node_transaction_state& t ) {
                   req.req_trx.ids.push_back( t.id );
-               }
+               } );
             }
          }
          break;
@@ -2491,6 +2982,127 @@ namespace eosio {
       }
    }
 
+   void net_plugin_impl::handle_message(const connection_ptr& c, const compact_block_message& msg) {
+      const block_id_type blk_id = msg.header.id();
+      const uint32_t blk_num = msg.header.block_num();
+      peer_dlog(c, "received compact_block_message #${n} with ${t} transactions", ("n", blk_num)("t", msg.transactions.size()));
+      try {
+         if( chain_plug->chain().fetch_block_by_id( blk_id ) ) {
+            c->cancel_wait();
+            sync_master->recv_block( c, blk_id, blk_num );
+            return;
+         }
+      } catch( ... ) {
+         fc_elog( logger, "Caught an unknown exception trying to recall blockID" );
+      }
+
+      auto pending = reconstruct_compact_block( msg, [this]( uint64_t short_id ) {
+         auto tx = local_txns.find_by_short_id( short_id );
+         return tx ? tx->packed_trx : packed_transaction_ptr();
+      } );
+      if( pending.missing.empty() ) {
+         accept_compact_block( c, pending.block, pending.id );
+         return;
+      }
+
+      const auto num_missing = pending.missing.size();
+      get_block_txns_message req{ blk_id, pending.missing };
+      pending.deadline = fc::time_point::now() + fc::microseconds( std::chrono::duration_cast<std::chrono::microseconds>( def_compact_block_wait ).count() );
+      vector<block_id_type> evicted;
+      if( !c->pending_compacts.add( std::move( pending ), evicted ) ) {
+         peer_dlog(c, "compact block #${n} is already waiting for its transactions", ("n", blk_num));
+         return;
+      }
+      for( const auto& id : evicted ) {
+         peer_dlog(c, "too many compact blocks waiting for transactions, requesting block ${id} whole", ("id", id));
+         request_full_block( c, id );
+      }
+      peer_dlog(c, "requesting ${m} of ${t} transactions of compact block #${n}",
+                ("m", num_missing)("t", msg.transactions.size())("n", blk_num));
+      c->enqueue( req );
+      start_compact_block_timer( c );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const get_block_txns_message& msg) {
+      block_txns_message reply;
+      reply.id = msg.id;
+      signed_block_ptr b;
+      try {
+         b = chain_plug->chain().fetch_block_by_id( msg.id );
+      } catch( ... ) {
+         fc_elog( logger, "Caught an unknown exception trying to recall blockID" );
+      }
+      if( b && msg.indexes.size() <= b->transactions.size() ) {
+         reply.transactions.reserve( msg.indexes.size() );
+         for( uint32_t i : msg.indexes ) {
+            if( i >= b->transactions.size() || !b->transactions[i].trx.contains<packed_transaction>() ) {
+               reply.transactions.clear();
+               break;
+            }
+            reply.transactions.push_back( b->transactions[i].trx.get<packed_transaction>() );
+         }
+      }
+      c->enqueue( reply );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const block_txns_message& msg) {
+      auto pending = c->pending_compacts.take( msg.id );
+      if( !pending ) {
+         peer_dlog(c, "received block_txns_message for a block not waiting for transactions");
+         return;
+      }
+      if( !fill_compact_block( *pending, msg ) ) {
+         peer_wlog(c, "block_txns_message does not have the requested transactions, requesting the full block");
+         request_full_block( c, pending->id );
+         return;
+      }
+      accept_compact_block( c, pending->block, pending->id );
+   }
+
+   void net_plugin_impl::accept_compact_block(const connection_ptr& c, const signed_block_ptr& block, const block_id_type& blk_id) {
+      // a short id may match another transaction, which would make the block fail validation
+      if( !compact_block_matches_mroot( *block ) ) {
+         peer_wlog(c, "compact block #${n} does not match its transaction_mroot, requesting the full block", ("n", block->block_num()));
+         request_full_block( c, blk_id );
+         return;
+      }
+      {
+         std::lock_guard<std::mutex> g( received_block_ids_mtx );
+         received_block_ids.emplace( blk_id, block->block_num() );
+      }
+      handle_message( c, block, blk_id );
+   }
+
+   void net_plugin_impl::request_full_block(const connection_ptr& c, const block_id_type& blk_id) {
+      request_message req;
+      req.req_blocks.mode = normal;
+      req.req_blocks.ids.push_back( blk_id );
+      c->enqueue( req );
+   }
+
+   void net_plugin_impl::start_compact_block_timer(const connection_ptr& c) {
+      const auto next = c->pending_compacts.next_deadline();
+      if( next == fc::time_point::maximum() )
+         return;
+      const auto wait = std::max<int64_t>( (next - fc::time_point::now()).count(), 0 ) + 1;
+      c->compact_block_timer->expires_from_now( std::chrono::microseconds( wait ) );
+      std::weak_ptr<connection> weak_conn = c;
+      c->compact_block_timer->async_wait( [this, weak_conn]( boost::system::error_code ec ) {
+         if( ec )
+            return; // restarted for an earlier deadline
+         app().post( priority::high, [this, weak_conn]() {
+            connection_ptr c = weak_conn.lock();
+            if( !c )
+               return;
+            for( const auto& id : c->pending_compacts.expire( fc::time_point::now() ) ) {
+               peer_wlog(c, "transactions of compact block ${id} not received in time, requesting the full block", ("id", id));
+               request_full_block( c, id );
+            }
+            start_compact_block_timer( c );
+         } );
+      } );
+   }
+
    size_t calc_trx_size( const packed_transaction_ptr& trx ) {
       // transaction is stored packed and unpacked, double packed_size and size of signed as an approximation of use
       return (trx->get_packed_transaction().size() * 2 + sizeof(trx->get_signed_transaction())) * 2 +
@@ -2498,7 +3110,7 @@ namespace eosio {
              trx->get_signatures().size() * sizeof(signature_type);
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const packed_transaction_ptr& trx) {
+   void net_plugin_impl::handle_message(const connection_ptr& c, const transaction_metadata_ptr& ptrx) {
       fc_dlog(logger, "got a packed transaction, cancel wait");
       peer_ilog(c, "received packed_transaction");
       controller& cc = my_impl->chain_plug->chain();
@@ -2511,10 +3123,10 @@ namespace eosio {
          return;
       }
 
-      auto ptrx = std::make_shared<transaction_metadata>( trx );
       const auto& tid = ptrx->id;
 
-      if(local_txns.get<by_id>().find(tid) != local_txns.end()) {
+      // also checked on the net thread, but another peer may have sent it in the meantime
+      if(local_txns.contains(tid)) {
          fc_dlog(logger, "got a duplicate transaction - dropping");
          return;
       }
@@ -2539,13 +3151,21 @@ namespace eosio {
       });
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg) {
-      controller &cc = chain_plug->chain();
-      block_id_type blk_id = msg->id();
-      uint32_t blk_num = msg->block_num();
+   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id) {
       fc_dlog(logger, "canceling wait on ${p}", ("p",c->peer_name()));
       c->cancel_wait();
 
+      if( sync_master->pipelining() ) {
+         sync_master->recv_sync_block( c, msg, blk_id, msg->block_num() );
+         return;
+      }
+      process_block( c, msg, blk_id, block_state_ptr() );
+   }
+
+   void net_plugin_impl::process_block(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id, const block_state_ptr& validated) {
+      controller &cc = chain_plug->chain();
+      uint32_t blk_num = msg->block_num();
+
       try {
          if( cc.fetch_block_by_id(blk_id)) {
             sync_master->recv_block(c, blk_id, blk_num);
@@ -2563,7 +3183,7 @@ namespace eosio {
 
       go_away_reason reason = fatal_other;
       try {
-         chain_plug->accept_block(msg); //, sync_master->is_active(c));
+         chain_plug->accept_block(msg, validated); //, sync_master->is_active(c));
          reason = no_reason;
       } catch( const unlinkable_block_exception &ex) {
          peer_elog(c, "bad signed_block : ${m}", ("m",ex.what()));
@@ -2584,22 +3204,17 @@ namespace eosio {
          fc_elog( logger, "handle sync block caught something else from ${p}",("num",blk_num)("p",c->peer_name()));
       }
 
-      update_block_num ubn(blk_num);
       if( reason == no_reason ) {
          for (const auto &recpt : msg->transactions) {
             auto id = (recpt.trx.which() == 0) ? recpt.trx.get<transaction_id_type>() : recpt.trx.get<packed_transaction>().id();
-            auto ltx = local_txns.get<by_id>().find(id);
-            if( ltx != local_txns.end()) {
-               local_txns.modify( ltx, ubn );
-            }
-            auto ctx = c->trx_state.get<by_id>().find(id);
-            if( ctx != c->trx_state.end()) {
-               c->trx_state.modify( ctx, ubn );
-            }
+            local_txns.set_block_num( id, blk_num );
+            c->trx_state.set_block_num( id, blk_num );
          }
          sync_master->recv_block(c, blk_id, blk_num);
       }
       else {
+         // so that the copies sent by other peers are decoded and tried again
+         forget_received_block( blk_id );
          sync_master->rejected_block(c, blk_num);
          dispatcher->rejected_block( blk_id );
       }
@@ -2644,7 +3259,7 @@ namespace eosio {
                fc_wlog( logger, "Peer keepalive ticked sooner than expected: ${m}", ("m", ec.message()) );
             }
             for( auto& c : connections ) {
-               if( c->socket->is_open()) {
+               if( c->socket_open ) {
                   c->send_time();
                }
             }
@@ -2670,11 +3285,17 @@ namespace eosio {
       controller& cc = chain_plug->chain();
       uint32_t lib = cc.last_irreversible_block_num();
       dispatcher->expire_blocks( lib );
+      {
+         std::lock_guard<std::mutex> g( received_block_ids_mtx );
+         for( auto itr = received_block_ids.begin(); itr != received_block_ids.end(); ) {
+            if( itr->second <= lib )
+               itr = received_block_ids.erase( itr );
+            else
+               ++itr;
+         }
+      }
       for ( auto &c : connections ) {
-         auto &stale_txn = c->trx_state.get<by_block_num>();
-         stale_txn.erase( stale_txn.lower_bound(1), stale_txn.upper_bound(lib) );
-         auto &stale_txn_e = c->trx_state.get<by_expiry>();
-         stale_txn_e.erase(stale_txn_e.lower_bound(time_point_sec()), stale_txn_e.upper_bound(time_point::now()));
+         c->trx_state.expire( now, lib );
          auto &stale_blk = c->blk_state.get<by_block_num>();
          stale_blk.erase( stale_blk.lower_bound(1), stale_blk.upper_bound(lib) );
       }
@@ -2683,15 +3304,9 @@ namespace eosio {
    }
 
    void net_plugin_impl::expire_local_txns() {
-      auto& old = local_txns.get<by_expiry>();
-      auto ex_lo = old.lower_bound( fc::time_point_sec(0) );
-      auto ex_up = old.upper_bound( time_point::now() );
-      old.erase( ex_lo, ex_up );
-
-      auto& stale = local_txns.get<by_block_num>();
       controller& cc = chain_plug->chain();
       uint32_t lib = cc.last_irreversible_block_num();
-      stale.erase( stale.lower_bound(1), stale.upper_bound(lib) );
+      local_txns.expire( time_point::now(), lib );
    }
 
    void net_plugin_impl::connection_monitor(std::weak_ptr<connection> from_connection) {
@@ -2705,7 +3320,7 @@ namespace eosio {
             start_conn_timer(std::chrono::milliseconds(1), *it); // avoid exhausting
             return;
          }
-         if( !(*it)->socket->is_open() && !(*it)->connecting) {
+         if( !(*it)->socket_open && !(*it)->connecting) {
             if( (*it)->peer_addr.length() > 0) {
                connect(*it);
             }
@@ -2720,7 +3335,7 @@ namespace eosio {
    }
 
    void net_plugin_impl::close(const connection_ptr& c) {
-      if( c->peer_addr.empty() && c->socket->is_open() ) {
+      if( c->peer_addr.empty() && c->socket_open ) {
          if (num_clients == 0) {
             fc_wlog( logger, "num_clients already at 0");
          }
@@ -2898,6 +3513,9 @@ namespace eosio {
          ( "net-threads", bpo::value<uint16_t>()->default_value(my->thread_pool_size),
            "Number of worker threads in net_plugin thread pool" )
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
+         ( "sync-fetch-peers", bpo::value<uint32_t>()->default_value(def_sync_fetch_peers),
+           "number of peers to retrieve chunks from at the same time while catching up to the last irreversible block. "
+           "With more than 1 the blocks are validated ahead of the one being applied.")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
@@ -2924,7 +3542,10 @@ namespace eosio {
 
          my->network_version_match = options.at( "network-version-match" ).as<bool>();
 
-         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>()));
+         const uint32_t sync_fetch_span = options.at( "sync-fetch-span" ).as<uint32_t>();
+         const uint32_t sync_fetch_peers = options.at( "sync-fetch-peers" ).as<uint32_t>();
+         EOS_ASSERT( sync_fetch_peers > 0, chain::plugin_config_exception, "sync-fetch-peers must be greater than 0" );
+         my->sync_master.reset( new sync_manager( sync_fetch_span, sync_fetch_peers ));
          my->dispatcher.reset( new dispatch_manager );
 
          my->connector_period = std::chrono::seconds( options.at( "connection-cleanup-period" ).as<int>());
@@ -364,7 +364,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
       };
 
-      void on_incoming_block(const signed_block_ptr& block) {
+      void on_incoming_block(const signed_block_ptr& block, const block_state_ptr& validated) {
          auto id = block->id();
 
          fc_dlog(_log, "received incoming block ${id}", ("id", id));
@@ -378,8 +378,15 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          auto existing = chain.fetch_block_by_id( id );
          if( existing ) { return; }
 
-         // start processing of block
-         auto bsf = chain.create_block_state_future( block );
+         // start processing of block, unless its header was validated already
+         std::future<block_state_ptr> bsf;
+         if( validated ) {
+            std::promise<block_state_ptr> p;
+            p.set_value( validated );
+            bsf = p.get_future();
+         } else {
+            bsf = chain.create_block_state_future( block );
+         }
 
          // abort the pending block
          chain.abort_block();
@@ -784,7 +791,7 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_incoming_block_subscription = app().get_channel<incoming::channels::block>().subscribe([this](const signed_block_ptr& block){
       try {
-         my->on_incoming_block(block);
+         my->on_incoming_block(block, block_state_ptr());
       } FC_LOG_AND_DROP();
    });
 
@@ -794,8 +801,8 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
       } FC_LOG_AND_DROP();
    });
 
-   my->_incoming_block_sync_provider = app().get_method<incoming::methods::block_sync>().register_provider([this](const signed_block_ptr& block){
-      my->on_incoming_block(block);
+   my->_incoming_block_sync_provider = app().get_method<incoming::methods::block_sync>().register_provider([this](const signed_block_ptr& block, const block_state_ptr& validated){
+      my->on_incoming_block(block, validated);
    });
 
    my->_incoming_transaction_async_provider = app().get_method<incoming::methods::transaction_async>().register_provider([this](const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) -> void {
@@ -143,13 +143,19 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    }
 
    void get_block(uint32_t block_num, fc::optional<bytes>& result) {
-      chain::signed_block_ptr p;
+      chain::block_state_ptr   bs;
+      chain::signed_block_ptr  p;
       try {
-         p = chain_plug->chain().fetch_block_by_number(block_num);
+         // reversible blocks already have their packed form cached in the block state
+         bs = chain_plug->chain().fetch_block_state_by_number(block_num);
+         if (!bs)
+            p = chain_plug->chain().fetch_block_by_number(block_num);
       } catch (...) {
          return;
       }
-      if (p)
+      if (bs)
+         result = *bs->packed_block();
+      else if (p)
          result = fc::raw::pack(*p);
    }
 
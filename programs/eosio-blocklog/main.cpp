@@ -27,6 +27,7 @@ struct blocklog {
    {}
 
    void read_log();
+   void convert_log();
    void set_program_options(options_description& cli);
    void initialize(const variables_map& options);
 
@@ -36,6 +37,9 @@ struct blocklog {
    uint32_t                         last_block;
    bool                             no_pretty_print;
    bool                             as_json_array;
+   bfs::path                        convert_dir;
+   bool                             compress = false;
+   bool                             decompress = false;
 };
 
 void blocklog::read_log() {
@@ -130,6 +134,39 @@ void blocklog::read_log() {
       *out << "]";
 }
 
+void blocklog::convert_log() {
+   block_log source(blocks_dir);
+   const auto head = source.head();
+   EOS_ASSERT( head, block_log_exception, "No blocks found in block log" );
+   EOS_ASSERT( !fc::exists(convert_dir / "blocks.log"), block_log_exception,
+               "Block log already exists in output directory ${d}", ("d", convert_dir.generic_string()) );
+
+   const uint32_t first = std::max( source.first_block_num(), first_block );
+   const uint32_t last  = std::min( head->block_num(), last_block );
+   EOS_ASSERT( first <= last, block_log_exception, "No blocks in the requested range ${f} to ${l}", ("f", first)("l", last) );
+
+   block_log_config cfg;
+   cfg.compress_blocks = compress;
+   block_log dest(convert_dir, cfg);
+   dest.reset( block_log::extract_genesis_state(blocks_dir), source.read_block_by_num(first), first );
+
+   ilog( "writing ${c} block log with blocks ${f} through ${l} to ${d}",
+         ("c", compress ? "compressed" : "uncompressed")("f", first)("l", last)("d", convert_dir.generic_string()) );
+   const auto start = fc::time_point::now();
+   for( uint32_t n = first + 1; n <= last; ++n ) {
+      auto b = source.read_block_by_num(n);
+      EOS_ASSERT( b, block_log_exception, "Block ${n} missing from source block log", ("n", n) );
+      dest.append(b);
+      if( n % 100000 == 0 )
+         ilog( "converted block ${n}", ("n", n) );
+   }
+   dest.flush();
+   const auto duration = fc::time_point::now() - start;
+   ilog( "converted ${c} blocks in ${s} seconds, block log file size went from ${a} to ${b} bytes",
+         ("c", last - first + 1)("s", duration.count() / 1000000.0)
+         ("a", fc::file_size(blocks_dir / "blocks.log"))("b", fc::file_size(convert_dir / "blocks.log")) );
+}
+
 void blocklog::set_program_options(options_description& cli)
 {
    cli.add_options()
@@ -145,6 +182,12 @@ void blocklog::set_program_options(options_description& cli)
           "Do not pretty print the output.  Useful if piping to jq to improve performance.")
          ("as-json-array", bpo::bool_switch(&as_json_array)->default_value(false),
           "Print out json blocks wrapped in json array (otherwise the output is free-standing json objects).")
+         ("convert-dir", bpo::value<bfs::path>(),
+          "write blocks first through last into a new block log in this directory instead of printing them, combining any block log segments into a single blocks.log")
+         ("compress", bpo::bool_switch(&compress)->default_value(false),
+          "with --convert-dir, write the new block log with compressed blocks")
+         ("decompress", bpo::bool_switch(&decompress)->default_value(false),
+          "with --convert-dir, write the new block log with uncompressed blocks (the default)")
          ("help", "Print this help message and exit.")
          ;
 
@@ -165,6 +208,17 @@ void blocklog::initialize(const variables_map& options) {
          else
             output_file = bld;
       }
+
+      if (options.count( "convert-dir" )) {
+         bld = options.at( "convert-dir" ).as<bfs::path>();
+         if( bld.is_relative())
+            convert_dir = bfs::current_path() / bld;
+         else
+            convert_dir = bld;
+      }
+      EOS_ASSERT( !(compress && decompress), block_log_exception, "--compress and --decompress are mutually exclusive" );
+      EOS_ASSERT( !convert_dir.empty() || !(compress || decompress), block_log_exception,
+                  "--compress and --decompress require --convert-dir" );
    } FC_LOG_AND_RETHROW()
 
 }
@@ -185,7 +239,10 @@ int main(int argc, char** argv)
         return 0;
       }
       blog.initialize(vmap);
-      blog.read_log();
+      if (!blog.convert_dir.empty())
+         blog.convert_log();
+      else
+         blog.read_log();
    } catch( const fc::exception& e ) {
       elog( "${e}", ("e", e.to_detail_string()));
       return -1;
@@ -0,0 +1,147 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/net_plugin/compact_blocks.hpp>
+#include <eosio/net_plugin/transaction_dedup.hpp>
+
+#include <map>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+   packed_transaction_ptr make_trx( uint16_t n ) {
+      signed_transaction trx;
+      trx.expiration = fc::time_point_sec( 1000000 );
+      trx.ref_block_num = n; // only there to give every transaction its own id
+      return std::make_shared<packed_transaction>( trx );
+   }
+
+   /// a block of the transactions followed by a deferred transaction receipt, and the compact_block_message of it
+   std::pair<signed_block_ptr, compact_block_message> make_block( const vector<packed_transaction_ptr>& trxs ) {
+      auto b = std::make_shared<signed_block>();
+      b->producer = N(producer);
+      for( const auto& ptrx : trxs )
+         b->transactions.emplace_back( *ptrx );
+      b->transactions.emplace_back( transaction_id_type( digest_type::hash( std::string( "deferred" ) ) ) );
+      vector<digest_type> digests;
+      for( const auto& r : b->transactions )
+         digests.emplace_back( r.digest() );
+      b->transaction_mroot = merkle( std::move( digests ) );
+
+      compact_block_message msg;
+      msg.header = static_cast<const signed_block_header&>( *b );
+      for( const auto& r : b->transactions ) {
+         compact_transaction_receipt cr;
+         static_cast<transaction_receipt_header&>( cr ) = r;
+         if( r.trx.contains<packed_transaction>() )
+            cr.trx = short_transaction_id( r.trx.get<packed_transaction>().id() );
+         else
+            cr.trx = r.trx.get<transaction_id_type>();
+         msg.transactions.push_back( cr );
+      }
+      return { b, msg };
+   }
+
+   pending_compact_block make_pending( uint16_t n, const fc::time_point& deadline ) {
+      pending_compact_block p;
+      p.block = std::make_shared<signed_block>();
+      p.block->timestamp = block_timestamp_type( n );
+      p.id = p.block->id();
+      p.deadline = deadline;
+      return p;
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(compact_block_tests)
+
+BOOST_AUTO_TEST_CASE(reconstruct_with_missing_transactions) try {
+   vector<packed_transaction_ptr> trxs{ make_trx( 1 ), make_trx( 2 ), make_trx( 3 ) };
+   auto blk = make_block( trxs );
+
+   // the second transaction is not known locally
+   std::map<uint64_t, packed_transaction_ptr> known;
+   known[short_transaction_id( trxs[0]->id() )] = trxs[0];
+   known[short_transaction_id( trxs[2]->id() )] = trxs[2];
+   auto find_trx = [&known]( uint64_t short_id ) {
+      auto itr = known.find( short_id );
+      return itr == known.end() ? packed_transaction_ptr() : itr->second;
+   };
+
+   auto pending = reconstruct_compact_block( blk.second, find_trx );
+   BOOST_REQUIRE( pending.id == blk.first->id() );
+   BOOST_REQUIRE( pending.missing == vector<uint32_t>{ 1 } );
+   BOOST_REQUIRE_EQUAL( pending.block->transactions.size(), 4u );
+   BOOST_CHECK( pending.block->transactions[3].trx.contains<transaction_id_type>() );
+
+   // an answer for another block, or with the wrong number of transactions, is rejected
+   block_txns_message reply;
+   reply.id = blk.first->previous;
+   reply.transactions.emplace_back( *trxs[1] );
+   BOOST_CHECK( !fill_compact_block( pending, reply ) );
+   reply.id = pending.id;
+   reply.transactions.emplace_back( *trxs[2] );
+   BOOST_CHECK( !fill_compact_block( pending, reply ) );
+
+   reply.transactions.pop_back();
+   BOOST_REQUIRE( fill_compact_block( pending, reply ) );
+   BOOST_CHECK( pending.missing.empty() );
+   BOOST_CHECK( compact_block_matches_mroot( *pending.block ) );
+   for( size_t i = 0; i < blk.first->transactions.size(); ++i ) {
+      BOOST_CHECK( pending.block->transactions[i].digest() == blk.first->transactions[i].digest() );
+   }
+   BOOST_CHECK( pending.block->id() == blk.first->id() );
+
+   // a short id that resolves to another transaction is caught by the transaction_mroot
+   known[short_transaction_id( trxs[1]->id() )] = trxs[0];
+   auto wrong = reconstruct_compact_block( blk.second, find_trx );
+   BOOST_CHECK( wrong.missing.empty() );
+   BOOST_CHECK( !compact_block_matches_mroot( *wrong.block ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(pending_compact_blocks_fall_back) try {
+   pending_compact_blocks pending;
+   vector<block_id_type> evicted;
+   const fc::time_point start = fc::time_point::now();
+
+   auto first = make_pending( 1, start + fc::milliseconds( 100 ) );
+   auto first_id = first.id;
+   BOOST_REQUIRE( pending.add( std::move( first ), evicted ) );
+   // the same block again does not replace the one waiting
+   BOOST_CHECK( !pending.add( make_pending( 1, start + fc::milliseconds( 500 ) ), evicted ) );
+   BOOST_CHECK_EQUAL( pending.size(), 1u );
+   BOOST_CHECK( pending.next_deadline() == start + fc::milliseconds( 100 ) );
+
+   // blocks are kept apart by id, answering one leaves the others waiting
+   auto second = make_pending( 2, start + fc::milliseconds( 200 ) );
+   auto second_id = second.id;
+   BOOST_REQUIRE( pending.add( std::move( second ), evicted ) );
+   BOOST_REQUIRE( pending.take( second_id ) );
+   BOOST_CHECK( !pending.take( second_id ) );
+   BOOST_CHECK_EQUAL( pending.size(), 1u );
+
+   // not answered in time
+   BOOST_CHECK( pending.expire( start + fc::milliseconds( 50 ) ).empty() );
+   auto expired = pending.expire( start + fc::milliseconds( 150 ) );
+   BOOST_REQUIRE_EQUAL( expired.size(), 1u );
+   BOOST_CHECK( expired[0] == first_id );
+   BOOST_CHECK( pending.empty() );
+   BOOST_CHECK( pending.next_deadline() == fc::time_point::maximum() );
+
+   // pushed out by newer blocks, oldest deadline first
+   vector<block_id_type> ids;
+   for( uint16_t n = 0; n < pending_compact_blocks::max_pending + 2; ++n ) {
+      auto p = make_pending( 10 + n, start + fc::milliseconds( 10 * n ) );
+      ids.push_back( p.id );
+      BOOST_REQUIRE( pending.add( std::move( p ), evicted ) );
+   }
+   BOOST_CHECK_EQUAL( pending.size(), pending_compact_blocks::max_pending );
+   BOOST_REQUIRE_EQUAL( evicted.size(), 2u );
+   BOOST_CHECK( evicted[0] == ids[0] );
+   BOOST_CHECK( evicted[1] == ids[1] );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -924,6 +924,29 @@ BOOST_AUTO_TEST_CASE(checktime_fail_tests) { try {
 } FC_LOG_AND_RETHROW() }
 
 
+BOOST_AUTO_TEST_CASE(checktime_inline_tests) { try {
+   auto cfg = validating_tester::default_config();
+   cfg.wasm_inline_checktime = true;
+   TESTER t( cfg );
+   t.produce_blocks(2);
+   t.create_account( N(testapi) );
+   t.set_code( N(testapi), contracts::test_api_wasm() );
+   t.produce_blocks(1);
+
+   // the loops only call checktime once the deadline timer has raised the injected global
+   call_test( t, test_api_action<TEST_METHOD("test_checktime", "checktime_pass")>{}, 0 );
+
+   BOOST_CHECK_EXCEPTION( call_test( t, test_api_action<TEST_METHOD("test_checktime", "checktime_failure")>{},
+                                     5000, 200, fc::raw::pack(10000000000000000000ULL) ),
+                          deadline_exception, is_deadline_exception );
+
+   BOOST_CHECK_EXCEPTION( call_test( t, test_api_action<TEST_METHOD("test_checktime", "checktime_failure")>{},
+                                     0, 200, fc::raw::pack(10000000000000000000ULL) ),
+                          tx_cpu_usage_exceeded, is_tx_cpu_usage_exceeded );
+
+   BOOST_REQUIRE_EQUAL( t.validate(), true );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_FIXTURE_TEST_CASE(checktime_intrinsic, TESTER) { try {
 	produce_blocks(2);
 	create_account( N(testapi) );
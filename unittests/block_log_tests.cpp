@@ -0,0 +1,283 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE
+ */
+#include <boost/test/unit_test.hpp>
+#include <eosio/testing/tester.hpp>
+#include <eosio/chain/block_log.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/fstream.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+using namespace eosio;
+using namespace testing;
+using namespace chain;
+
+namespace {
+
+   /// produce blocks on a tester and return them in order, starting with the genesis block
+   vector<signed_block_ptr> produce_test_blocks( tester& chain, uint32_t count ) {
+      vector<signed_block_ptr> blocks;
+      blocks.push_back( chain.control->fetch_block_by_number( 1 ) );
+      for( uint32_t i = 0; i < count; ++i ) {
+         blocks.push_back( chain.produce_block() );
+      }
+      return blocks;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(block_log_tests)
+
+BOOST_AUTO_TEST_CASE(concurrent_read_while_appending)
+{
+   tester chain;
+   auto blocks = produce_test_blocks( chain, 200 );
+
+   fc::temp_directory tempdir;
+   block_log blog( tempdir.path() );
+   blog.reset( chain.get_config().genesis, blocks.front() );
+
+   const size_t initial = 50;
+   for( size_t i = 1; i < initial; ++i ) {
+      blog.append( blocks[i] );
+   }
+
+   std::atomic<bool> done{false};
+   std::atomic<uint32_t> mismatches{0};
+   vector<std::thread> readers;
+   for( size_t t = 0; t < 4; ++t ) {
+      readers.emplace_back( [&, t]() {
+         uint32_t n = 1 + t;
+         while( !done.load() ) {
+            auto b = blog.read_block_by_num( n );
+            if( b && b->id() != blocks[n - 1]->id() )
+               ++mismatches;
+            n = (n % blocks.size()) + 1;
+         }
+      } );
+   }
+
+   for( size_t i = initial; i < blocks.size(); ++i ) {
+      blog.append( blocks[i] );
+   }
+   done = true;
+   for( auto& r : readers ) r.join();
+
+   BOOST_REQUIRE_EQUAL( mismatches.load(), 0u );
+   for( size_t i = 0; i < blocks.size(); ++i ) {
+      auto b = blog.read_block_by_num( i + 1 );
+      BOOST_REQUIRE( b );
+      BOOST_REQUIRE_EQUAL( b->id(), blocks[i]->id() );
+   }
+   BOOST_REQUIRE( !blog.read_block_by_num( blocks.size() + 1 ) );
+}
+
+BOOST_AUTO_TEST_CASE(reconstruct_index)
+{
+   tester chain;
+   auto blocks = produce_test_blocks( chain, 100 );
+
+   fc::temp_directory tempdir;
+   {
+      block_log blog( tempdir.path() );
+      blog.reset( chain.get_config().genesis, blocks.front() );
+      for( size_t i = 1; i < blocks.size(); ++i ) {
+         blog.append( blocks[i] );
+      }
+   }
+
+   const auto index_file = tempdir.path() / "blocks.index";
+   const auto index_size = fc::file_size( index_file );
+   BOOST_REQUIRE_EQUAL( index_size, blocks.size() * sizeof(uint64_t) );
+
+   // a missing index and a truncated index are both rebuilt from the trailer chain
+   for( uint64_t truncated_size : { uint64_t(0), index_size / 2 } ) {
+      fc::remove_all( index_file );
+      if( truncated_size > 0 ) {
+         std::ofstream( index_file.generic_string(), std::ios::binary ).write( std::string( truncated_size, 0 ).data(), truncated_size );
+      }
+
+      block_log blog( tempdir.path() );
+      BOOST_REQUIRE_EQUAL( fc::file_size( index_file ), index_size );
+      for( size_t i = 0; i < blocks.size(); ++i ) {
+         auto b = blog.read_block_by_num( i + 1 );
+         BOOST_REQUIRE( b );
+         BOOST_REQUIRE_EQUAL( b->id(), blocks[i]->id() );
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(incremental_backup)
+{
+   tester chain;
+   auto blocks = produce_test_blocks( chain, 60 );
+
+   fc::temp_directory tempdir;
+   const auto blocks_dir = tempdir.path() / "data" / "blocks";
+   const auto backup_file = tempdir.path() / "blocks_backup.log";
+
+   auto read_file = []( const fc::path& p ) {
+      std::string content;
+      fc::read_file_contents( p, content );
+      return content;
+   };
+
+   block_log blog( blocks_dir );
+   blog.reset( chain.get_config().genesis, blocks.front() );
+   for( size_t i = 1; i < 20; ++i ) {
+      blog.append( blocks[i] );
+   }
+
+   block_log::backup_log( blocks_dir );
+   BOOST_REQUIRE( read_file( backup_file ) == read_file( blocks_dir / "blocks.log" ) );
+
+   for( size_t i = 20; i < blocks.size(); ++i ) {
+      blog.append( blocks[i] );
+   }
+
+   // only the tail is appended, the existing backup must still match the log afterwards
+   block_log::backup_log( blocks_dir );
+   BOOST_REQUIRE( read_file( backup_file ) == read_file( blocks_dir / "blocks.log" ) );
+
+   // a backup that is not a prefix of the log is recreated
+   {
+      std::ofstream corrupt( backup_file.generic_string(), std::ios::binary | std::ios::app );
+      corrupt << "garbage";
+   }
+   block_log::backup_log( blocks_dir );
+   BOOST_REQUIRE( read_file( backup_file ) == read_file( blocks_dir / "blocks.log" ) );
+}
+
+BOOST_AUTO_TEST_CASE(split_log)
+{
+   tester chain;
+   auto blocks = produce_test_blocks( chain, 64 );
+
+   fc::temp_directory tempdir;
+   block_log_config cfg;
+   cfg.stride = 10;
+   {
+      block_log blog( tempdir.path(), cfg );
+      blog.reset( chain.get_config().genesis, blocks.front() );
+      for( size_t i = 1; i < blocks.size(); ++i ) {
+         blog.append( blocks[i] );
+      }
+      BOOST_REQUIRE( fc::exists( tempdir.path() / "blocks-1-10.log" ) );
+      BOOST_REQUIRE( fc::exists( tempdir.path() / "blocks-51-60.index" ) );
+      BOOST_REQUIRE_EQUAL( blog.first_block_num(), 1u );
+      for( size_t i = 0; i < blocks.size(); ++i ) {
+         BOOST_REQUIRE_EQUAL( blog.read_block_by_num( i + 1 )->id(), blocks[i]->id() );
+      }
+   }
+
+   // segments are found again on reopen, and the oldest are archived once more than two are kept
+   cfg.max_retained_segments = 2;
+   cfg.archive_dir = tempdir.path() / "archive";
+   block_log blog( tempdir.path(), cfg );
+   BOOST_REQUIRE_EQUAL( blog.head()->id(), blocks.back()->id() );
+   BOOST_REQUIRE_EQUAL( blog.read_block_by_num( 5 )->id(), blocks[4]->id() );
+
+   for( uint32_t n = blocks.size() + 1; n <= 70; ++n ) {
+      auto b = chain.produce_block();
+      blocks.push_back( b );
+      blog.append( b );
+   }
+   BOOST_REQUIRE_EQUAL( blog.first_block_num(), 51u );
+   BOOST_REQUIRE( !blog.read_block_by_num( 50 ) );
+   BOOST_REQUIRE( fc::exists( cfg.archive_dir / "blocks-1-10.log" ) );
+   for( uint32_t n = 51; n <= 70; ++n ) {
+      BOOST_REQUIRE_EQUAL( blog.read_block_by_num( n )->id(), blocks[n - 1]->id() );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(compressed_log)
+{
+   tester chain;
+   auto blocks = produce_test_blocks( chain, 40 );
+
+   fc::temp_directory tempdir;
+   block_log_config cfg;
+   cfg.compress_blocks = true;
+   cfg.stride = 25;
+   {
+      block_log blog( tempdir.path(), cfg );
+      blog.reset( chain.get_config().genesis, blocks.front() );
+      for( size_t i = 1; i < blocks.size(); ++i ) {
+         blog.append( blocks[i] );
+      }
+      for( size_t i = 0; i < blocks.size(); ++i ) {
+         BOOST_REQUIRE_EQUAL( blog.read_block_by_num( i + 1 )->id(), blocks[i]->id() );
+      }
+   }
+
+   uint32_t version = 0;
+   std::ifstream( (tempdir.path() / "blocks.log").generic_string(), std::ios::binary ).read( (char*)&version, sizeof(version) );
+   BOOST_REQUIRE_EQUAL( version, 3u );
+
+   // the index of a compressed log is rebuilt from the trailers, and a reopen without the compression option
+   // still reads the existing compressed files
+   fc::remove_all( tempdir.path() / "blocks.index" );
+   block_log blog( tempdir.path() );
+   BOOST_REQUIRE_EQUAL( blog.head()->id(), blocks.back()->id() );
+   for( size_t i = 0; i < blocks.size(); ++i ) {
+      BOOST_REQUIRE_EQUAL( blog.read_block_by_num( i + 1 )->id(), blocks[i]->id() );
+   }
+   BOOST_REQUIRE( block_log::extract_genesis_state( tempdir.path() ) == chain.get_config().genesis );
+
+   auto b = chain.produce_block();
+   blog.append( b );
+   BOOST_REQUIRE_EQUAL( blog.read_block_by_num( b->block_num() )->id(), b->id() );
+}
+
+BOOST_AUTO_TEST_CASE(async_append)
+{
+   tester chain;
+   auto blocks = produce_test_blocks( chain, 120 );
+
+   fc::temp_directory tempdir;
+   block_log_config cfg;
+   cfg.write_interval_ms = 20;
+   cfg.stride = 50;
+   {
+      block_log blog( tempdir.path(), cfg );
+      blog.reset( chain.get_config().genesis, blocks.front() );
+
+      std::atomic<bool> done{false};
+      std::atomic<uint32_t> mismatches{0};
+      std::thread reader( [&]() {
+         uint32_t n = 1;
+         while( !done.load() ) {
+            auto b = blog.read_block_by_num( n );
+            if( b && b->id() != blocks[n - 1]->id() )
+               ++mismatches;
+            n = (n % blocks.size()) + 1;
+         }
+      } );
+
+      // queued blocks are readable before the writer thread gets to them
+      for( size_t i = 1; i < blocks.size(); ++i ) {
+         BOOST_REQUIRE_EQUAL( blog.append( blocks[i] ), block_log::npos );
+         BOOST_REQUIRE_EQUAL( blog.read_block_by_num( i + 1 )->id(), blocks[i]->id() );
+      }
+      done = true;
+      reader.join();
+      BOOST_REQUIRE_EQUAL( mismatches.load(), 0u );
+
+      blog.flush();
+      BOOST_REQUIRE( fc::exists( tempdir.path() / "blocks-51-100.log" ) );
+      BOOST_REQUIRE( blog.get_block_pos( blocks.size() ) != block_log::npos );
+   }
+
+   block_log blog( tempdir.path() );
+   BOOST_REQUIRE_EQUAL( blog.head()->id(), blocks.back()->id() );
+   for( size_t i = 0; i < blocks.size(); ++i ) {
+      BOOST_REQUIRE_EQUAL( blog.read_block_by_num( i + 1 )->id(), blocks[i]->id() );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -191,4 +191,79 @@ BOOST_AUTO_TEST_CASE(broadcasted_block_test)
 
 }
 
+/**
+ * Ensure key recovery for the transactions of a received block is started before the block is applied
+ */
+BOOST_AUTO_TEST_CASE(received_block_recovers_keys_test)
+{
+   validating_tester chain;
+
+   block_state_ptr received;
+   chain.validating_node->accepted_block_header.connect( [&](const block_state_ptr& bs) {
+      received = bs;
+   });
+
+   chain.create_account( N(newacc) );
+   auto b = chain.produce_block();
+   BOOST_REQUIRE( received );
+   BOOST_REQUIRE_EQUAL( received->id, b->id() );
+
+   BOOST_REQUIRE_EQUAL( received->trxs.size(), 1u );
+   const auto& mtrx = received->trxs.front();
+   BOOST_REQUIRE( mtrx->signing_keys_future.valid() );
+   const auto& keys = std::get<2>( mtrx->signing_keys_future.get() );
+   BOOST_CHECK( keys.count( chain.get_public_key( config::system_account_name, "active" ) ) == 1 );
+}
+
+/**
+ * Ensure the packed block cached in block_state matches the block and is only serialized once
+ */
+BOOST_AUTO_TEST_CASE(packed_block_cache_test)
+{
+   tester chain;
+   block_state_ptr accepted;
+   chain.control->accepted_block.connect( [&](const block_state_ptr& bs) {
+      accepted = bs;
+   });
+
+   auto b = chain.produce_block();
+   BOOST_REQUIRE( accepted );
+   BOOST_REQUIRE_EQUAL( accepted->block->id(), b->id() );
+
+   auto packed = accepted->packed_block();
+   BOOST_CHECK( *packed == fc::raw::pack( *b ) );
+   BOOST_CHECK( accepted->packed_block() == packed );
+
+   // the reversible blocks database stores the cached bytes
+   auto stored = chain.control->fetch_block_by_number( b->block_num() );
+   BOOST_CHECK( fc::raw::pack( *stored ) == *packed );
+}
+
+/**
+ * Ensure a block can be validated on top of the header state of a block that is not pushed yet, as a syncing node does
+ */
+BOOST_AUTO_TEST_CASE(block_state_future_ahead_of_head_test)
+{
+   tester producer_node;
+   auto b1 = producer_node.produce_block();
+   auto b2 = producer_node.produce_block();
+
+   tester receiving_node;
+   auto head = receiving_node.control->head_block_state();
+   BOOST_REQUIRE_EQUAL( head->id, b1->previous );
+
+   BOOST_REQUIRE_THROW( receiving_node.control->create_block_state_future( b2, head ), unlinkable_block_exception );
+
+   auto bs1 = receiving_node.control->create_block_state_future( b1, head ).get();
+   auto bs2 = receiving_node.control->create_block_state_future( b2, bs1 );
+
+   std::promise<block_state_ptr> validated;
+   validated.set_value( bs1 );
+   auto bs1_future = validated.get_future();
+   receiving_node.control->abort_block();
+   receiving_node.control->push_block( bs1_future );
+   receiving_node.control->push_block( bs2 );
+   BOOST_CHECK_EQUAL( receiving_node.control->head_block_id(), b2->id() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
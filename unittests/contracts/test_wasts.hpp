@@ -634,6 +634,114 @@ static const char memory_growth_memset_test[] = R"=====(
 )
 )=====";
 
+static const char memory_image_reset_wast[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory $0 2)
+ (data (i32.const 8) "\2a\00\00\00")
+ (data (i32.const 70000) "\07\00\00\00")
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+   (call $eosio_assert (i32.eq (i32.load offset=8 (i32.const 0)) (i32.const 42)) (i32.const 0))
+   (call $eosio_assert (i32.eq (i32.load offset=70000 (i32.const 0)) (i32.const 7)) (i32.const 0))
+   (call $eosio_assert (i32.eq (i32.load offset=100000 (i32.const 0)) (i32.const 0)) (i32.const 0))
+   (call $eosio_assert (i32.eq (grow_memory (i32.const 1)) (i32.const 2)) (i32.const 0))
+   (call $eosio_assert (i32.eq (i32.load offset=140000 (i32.const 0)) (i32.const 0)) (i32.const 0))
+   (i32.store offset=8 (i32.const 0) (i32.const 99))
+   (i32.store offset=70000 (i32.const 0) (i32.const 99))
+   (i32.store offset=100000 (i32.const 0) (i32.const 99))
+   (i32.store offset=140000 (i32.const 0) (i32.const 99))
+ )
+)
+)=====";
+
+// calls memcpy, memmove, memset or memcmp, picked by the action name 0 to 3, count times on ranges of size bytes;
+// the action data is the size and the count as two i32
+static const char memory_intrinsics_benchmark_wast[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (import "env" "read_action_data" (func $read_action_data (param i32 i32) (result i32)))
+ (import "env" "memcpy" (func $memcpy (param i32 i32 i32) (result i32)))
+ (import "env" "memmove" (func $memmove (param i32 i32 i32) (result i32)))
+ (import "env" "memset" (func $memset (param i32 i32 i32) (result i32)))
+ (import "env" "memcmp" (func $memcmp (param i32 i32 i32) (result i32)))
+ (memory $0 1)
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+  (local $size i32) (local $count i32) (local $i i32)
+  (drop (call $read_action_data (i32.const 0) (i32.const 8)))
+  (set_local $size (i32.load (i32.const 0)))
+  (set_local $count (i32.load (i32.const 4)))
+  (block $done
+   (loop $next
+    (br_if $done (i32.ge_u (get_local $i) (get_local $count)))
+    (if (i64.eq (get_local $2) (i64.const 0)) (then
+      (drop (call $memcpy (i32.const 1024) (i32.const 16384) (get_local $size)))
+    ))
+    (if (i64.eq (get_local $2) (i64.const 1)) (then
+      (drop (call $memmove (i32.const 1040) (i32.const 1024) (get_local $size)))
+    ))
+    (if (i64.eq (get_local $2) (i64.const 2)) (then
+      (drop (call $memset (i32.const 1024) (get_local $i) (get_local $size)))
+    ))
+    (if (i64.eq (get_local $2) (i64.const 3)) (then
+      (drop (call $memcmp (i32.const 16384) (i32.const 32768) (get_local $size)))
+    ))
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br $next)
+   )
+  )
+ )
+)
+)=====";
+
+// action 0 stores rows 1 to 5 with values "a" to "abcde", action 1 reads them back in batches with db_get_rows_i64
+static const char db_get_rows_wast[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_lowerbound_i64" (func $db_lowerbound_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "db_get_rows_i64" (func $db_get_rows_i64 (param i32 i32 i32 i32 i32) (result i32)))
+ (memory $0 1)
+ (data (i32.const 0) "abcde")
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+  (if (i64.eq (get_local $2) (i64.const 0)) (then
+    (drop (call $db_store_i64 (i64.const 0) (i64.const 0) (get_local $0) (i64.const 1) (i32.const 0) (i32.const 1)))
+    (drop (call $db_store_i64 (i64.const 0) (i64.const 0) (get_local $0) (i64.const 2) (i32.const 0) (i32.const 2)))
+    (drop (call $db_store_i64 (i64.const 0) (i64.const 0) (get_local $0) (i64.const 3) (i32.const 0) (i32.const 3)))
+    (drop (call $db_store_i64 (i64.const 0) (i64.const 0) (get_local $0) (i64.const 4) (i32.const 0) (i32.const 4)))
+    (drop (call $db_store_i64 (i64.const 0) (i64.const 0) (get_local $0) (i64.const 5) (i32.const 0) (i32.const 5)))
+    (return)
+  ))
+  ;; the first three rows take 13, 14 and 15 bytes
+  (call $eosio_assert (i32.eq (call $db_get_rows_i64 (call $db_lowerbound_i64 (get_local $0) (i64.const 0) (i64.const 0) (i64.const 0))
+                                                     (i32.const 1024) (i32.const 64) (i32.const 3) (i32.const 2048))
+                              (i32.const 3)) (i32.const 0))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 1024)) (i64.const 1)) (i32.const 0))
+  (call $eosio_assert (i32.eq (i32.load (i32.const 1032)) (i32.const 1)) (i32.const 0))
+  (call $eosio_assert (i32.eq (i32.load8_u (i32.const 1036)) (i32.const 97)) (i32.const 0))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 1037)) (i64.const 2)) (i32.const 0))
+  (call $eosio_assert (i32.eq (i32.load (i32.const 1045)) (i32.const 2)) (i32.const 0))
+  (call $eosio_assert (i32.eq (i32.load8_u (i32.const 1050)) (i32.const 98)) (i32.const 0))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 1051)) (i64.const 3)) (i32.const 0))
+  (call $eosio_assert (i32.eq (i32.load8_u (i32.const 1065)) (i32.const 99)) (i32.const 0))
+  ;; row 4 takes 16 bytes, row 5 no longer fits
+  (call $eosio_assert (i32.eq (call $db_get_rows_i64 (i32.load (i32.const 2048)) (i32.const 1024) (i32.const 20) (i32.const 10) (i32.const 2048))
+                              (i32.const 1)) (i32.const 0))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 1024)) (i64.const 4)) (i32.const 0))
+  (call $eosio_assert (i32.eq (i32.load (i32.const 1032)) (i32.const 4)) (i32.const 0))
+  (call $eosio_assert (i32.eq (call $db_get_rows_i64 (i32.load (i32.const 2048)) (i32.const 1024) (i32.const 64) (i32.const 10) (i32.const 2048))
+                              (i32.const 1)) (i32.const 0))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 1024)) (i64.const 5)) (i32.const 0))
+  (call $eosio_assert (i32.eq (i32.load8_u (i32.const 1040)) (i32.const 101)) (i32.const 0))
+  ;; the last batch ended the table
+  (call $eosio_assert (i32.lt_s (i32.load (i32.const 2048)) (i32.const -1)) (i32.const 0))
+  (call $eosio_assert (i32.eqz (call $db_get_rows_i64 (i32.load (i32.const 2048)) (i32.const 1024) (i32.const 64) (i32.const 10) (i32.const 2048)))
+                      (i32.const 0))
+ )
+)
+)=====";
+
 static const char large_maligned_host_ptr[] = R"=====(
 (module
  (export "apply" (func $$apply))
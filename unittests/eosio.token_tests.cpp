@@ -269,4 +269,45 @@ BOOST_FIXTURE_TEST_CASE( transfer_tests, eosio_token_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( native_transfer_tests, eosio_token_tester ) try {
+   auto& wasmif = control->get_wasm_interface();
+   const auto& code_hash = control->db().get<account_metadata_object,by_name>( N(eosio.token) ).code_hash;
+   wasmif.register_native_contract( code_hash, native_contracts::find( "eosio.token" ) );
+
+   // both run, the wasm result is kept and every difference is counted
+   wasmif.set_native_contract_mode( wasm_interface::native_contract_mode::differential );
+
+   create( N(alice), asset::from_string("1000 CERO") );
+   // issuing to another account is an inline transfer from the issuer
+   BOOST_REQUIRE_EQUAL( success(), issue( N(alice), N(bob), asset::from_string("1000 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(bob), N(carol), asset::from_string("300 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(carol), N(bob), asset::from_string("100 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "overdrawn balance" ),
+                        transfer( N(carol), N(bob), asset::from_string("201 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "cannot transfer to self" ),
+                        transfer( N(bob), N(bob), asset::from_string("1 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "to account does not exist" ),
+                        transfer( N(bob), N(dave), asset::from_string("1 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "symbol precision mismatch" ),
+                        transfer( N(bob), N(carol), asset::from_string("1.0 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "unable to find key" ),
+                        transfer( N(bob), N(carol), asset::from_string("1 NOPE"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "memo has more than 256 bytes" ),
+                        transfer( N(bob), N(carol), asset::from_string("1 CERO"), string(257, 'x') ) );
+   BOOST_REQUIRE_EQUAL( wasmif.native_contract_mismatches(), 0u );
+
+   // only the native implementation runs, with the same results
+   wasmif.set_native_contract_mode( wasm_interface::native_contract_mode::enabled );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(bob), N(carol), asset::from_string("50 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(bob), N(alice), asset::from_string("50 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "must transfer positive quantity" ),
+                        transfer( N(bob), N(carol), asset::from_string("-1 CERO"), "hola" ) );
+   produce_blocks(1);
+
+   REQUIRE_MATCHING_OBJECT( get_account(N(alice), "0,CERO"), mvo()("balance", "50 CERO") );
+   REQUIRE_MATCHING_OBJECT( get_account(N(bob), "0,CERO"), mvo()("balance", "700 CERO") );
+   REQUIRE_MATCHING_OBJECT( get_account(N(carol), "0,CERO"), mvo()("balance", "250 CERO") );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,8 +6,10 @@
 #include <eosio/chain/authority.hpp>
 #include <eosio/chain/authority_checker.hpp>
 #include <eosio/chain/chain_config.hpp>
+#include <eosio/chain/iterator_cache_arena.hpp>
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/transaction_access_set.hpp>
 #include <eosio/testing/tester.hpp>
 
 #include <fc/io/json.hpp>
@@ -695,6 +697,7 @@ BOOST_AUTO_TEST_CASE(transaction_test) { try {
    BOOST_CHECK_EQUAL(pkt.get_signed_transaction().id(), pkt2.id());
 
    flat_set<public_key_type> keys;
+   const auto stats_before = get_signature_recovery_cache_stats();
    auto cpu_time1 = pkt.get_signed_transaction().get_signature_keys(test.control->get_chain_id(), fc::time_point::maximum(), keys);
    BOOST_CHECK_EQUAL(1u, keys.size());
    BOOST_CHECK_EQUAL(public_key, *keys.begin());
@@ -703,6 +706,18 @@ BOOST_AUTO_TEST_CASE(transaction_test) { try {
    BOOST_CHECK_EQUAL(1u, keys.size());
    BOOST_CHECK_EQUAL(public_key, *keys.begin());
 
+   // the signature was recovered once, the second call was served by the cache
+   const auto stats_after = get_signature_recovery_cache_stats();
+   BOOST_CHECK_EQUAL(stats_before.misses + 1, stats_after.misses);
+   BOOST_CHECK_EQUAL(stats_before.hits + 1, stats_after.hits);
+
+   // the same signature over a different digest is not served from the cache
+   keys.clear();
+   pkt.get_signed_transaction().get_signature_keys(chain_id_type(fc::sha256::hash("other chain").str()), fc::time_point::maximum(), keys);
+   BOOST_CHECK_EQUAL(1u, keys.size());
+   BOOST_CHECK(public_key != *keys.begin());
+   BOOST_CHECK_EQUAL(stats_after.misses + 1, get_signature_recovery_cache_stats().misses);
+
    BOOST_CHECK(cpu_time1 > fc::microseconds(0));
    BOOST_CHECK(cpu_time2 > fc::microseconds(0));
 
@@ -1125,6 +1140,93 @@ BOOST_AUTO_TEST_CASE(stable_priority_queue_test) {
 }
 
 
+BOOST_AUTO_TEST_CASE(transaction_access_set_waves_test) { try {
+   auto tbl = []( const char* code, const char* scope ) {
+      return std::make_tuple( name(code), name(scope), name("accounts") );
+   };
+   vector<transaction_access_set> sets(5);
+   // 0 and 1 only read the same table, 2 writes it
+   sets[0].table_reads.insert( tbl("token", "alice") );
+   sets[1].table_reads.insert( tbl("token", "alice") );
+   sets[2].table_writes.insert( tbl("token", "alice") );
+   // 3 touches a different scope, but is billed to the same account as 2
+   sets[2].write_account( name("alice") );
+   sets[3].table_writes.insert( tbl("token", "bob") );
+   sets[3].write_account( name("alice") );
+   // 4 is independent of everything before it
+   sets[4].table_writes.insert( tbl("token", "carol") );
+
+   BOOST_CHECK( !sets[0].conflicts_with( sets[1] ) );
+   BOOST_CHECK( sets[0].conflicts_with( sets[2] ) );
+   BOOST_CHECK( sets[2].conflicts_with( sets[3] ) );
+   BOOST_CHECK( !sets[3].conflicts_with( sets[4] ) );
+
+   auto waves = conflict_free_waves( sets );
+   BOOST_CHECK( waves == vector<uint32_t>({0, 0, 1, 2, 0}) );
+
+   // a global write conflicts with every transaction
+   sets[4].global_write = true;
+   waves = conflict_free_waves( sets );
+   BOOST_CHECK( waves == vector<uint32_t>({0, 0, 1, 2, 3}) );
+
+   // reading an account conflicts with writing it, reading a permission only with a global write
+   transaction_access_set reader, writer;
+   reader.read_account( name("dave") );
+   reader.read_permission( permission_level{ name("dave"), config::active_name } );
+   writer.read_permission( permission_level{ name("dave"), config::active_name } );
+   BOOST_CHECK( !reader.conflicts_with( writer ) );
+   writer.write_account( name("dave") );
+   BOOST_CHECK( reader.conflicts_with( writer ) );
+   BOOST_CHECK( writer.conflicts_with( reader ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(iterator_cache_arena_test) { try {
+   // random inserts and erases against std::map, with clears in between as when the storage moves to the next action
+   flat_iterator_map fm;
+   std::map<uint64_t, int> expected;
+   boost::random::mt19937 gen;
+   boost::random::uniform_int_distribution<uint64_t> key_dist( 0, 300 );
+   boost::random::uniform_int_distribution<int> op_dist( 0, 9 );
+   for( int round = 0; round < 4; ++round ) {
+      for( int i = 0; i < 5000; ++i ) {
+         const uint64_t key = key_dist( gen ) * 4096;
+         const auto itr = expected.find( key );
+         if( op_dist( gen ) < 6 ) {
+            if( itr == expected.end() ) {
+               fm.insert( key, i );
+               expected[key] = i;
+            }
+         } else {
+            fm.erase( key );
+            if( itr != expected.end() ) expected.erase( itr );
+         }
+         BOOST_REQUIRE_EQUAL( fm.size(), expected.size() );
+      }
+      for( uint64_t k = 0; k <= 300; ++k ) {
+         const auto itr = expected.find( k * 4096 );
+         BOOST_REQUIRE_EQUAL( fm.find( k * 4096 ), itr == expected.end() ? flat_iterator_map::npos : itr->second );
+      }
+      fm.clear();
+      expected.clear();
+      BOOST_REQUIRE_EQUAL( fm.find( 0 ), flat_iterator_map::npos );
+   }
+
+   // released storage comes back cleared and is handed out again instead of allocating more
+   iterator_cache_arena arena;
+   auto& a = arena.acquire();
+   auto& b = arena.acquire();
+   a.iterator_to_object.push_back( &a );
+   a.object_to_iterator.insert( 1, 0 );
+   arena.release( a );
+   auto& c = arena.acquire();
+   BOOST_CHECK_EQUAL( &a, &c );
+   BOOST_CHECK( c.iterator_to_object.empty() );
+   BOOST_CHECK_EQUAL( c.object_to_iterator.find( 1 ), flat_iterator_map::npos );
+   arena.release( b );
+   arena.release( c );
+   BOOST_CHECK_EQUAL( arena.allocated(), 2u );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace eosio
@@ -16,6 +16,7 @@
 #include <contracts.hpp>
 
 #include "fork_test_utilities.hpp"
+#include "test_wasts.hpp"
 
 using namespace eosio::chain;
 using namespace eosio::testing;
@@ -1062,6 +1063,44 @@ BOOST_AUTO_TEST_CASE( get_sender_test ) { try {
    );
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( batch_db_reads_test ) { try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+
+   const auto& tester1_account = account_name("tester1");
+   c.create_accounts( {tester1_account} );
+   c.produce_block();
+
+   BOOST_CHECK_EXCEPTION(  c.set_code( tester1_account, db_get_rows_wast ),
+                           wasm_exception,
+                           fc_exception_message_is( "env.db_get_rows_i64 unresolveable" ) );
+
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   const auto& d = pfm.get_builtin_digest( builtin_protocol_feature_t::batch_db_reads );
+   BOOST_REQUIRE( d );
+
+   c.preactivate_protocol_features( {*d} );
+   c.produce_block();
+
+   c.set_code( tester1_account, db_get_rows_wast );
+   c.produce_block();
+
+   auto run = [&]( uint64_t action_num ) {
+      signed_transaction trx;
+      action act;
+      act.account = tester1_account;
+      act.name = action_name( action_num );
+      act.authorization = vector<permission_level>{{tester1_account, config::active_name}};
+      trx.actions.push_back( act );
+      c.set_transaction_headers( trx );
+      trx.sign( c.get_private_key( tester1_account, "active" ), c.control->get_chain_id() );
+      c.push_transaction( trx );
+   };
+
+   run( 0 );
+   run( 1 );
+   c.produce_block();
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( ram_restrictions_test ) { try {
    tester c( setup_policy::preactivate_feature_and_new_bios );
 
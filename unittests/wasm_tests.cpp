@@ -3,12 +3,18 @@
  *  @copyright defined in eos/LICENSE.txt
  */
 #include <array>
+#include <atomic>
+#include <ctime>
+#include <fstream>
+#include <thread>
 #include <utility>
 
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/memory_ops.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/wasm_eosio_constraints.hpp>
+#include <eosio/chain/wasm_eosio_injection.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
 #include <eosio/testing/tester.hpp>
 
@@ -17,8 +23,10 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <fc/filesystem.hpp>
 #include <fc/io/fstream.hpp>
 #include <fc/io/json.hpp>
+#include <fc/scoped_exit.hpp>
 #include <fc/variant_object.hpp>
 
 #include "incbin.h"
@@ -1525,6 +1533,215 @@ BOOST_FIXTURE_TEST_CASE( mem_growth_memset, TESTER ) try {
    }
 } FC_LOG_AND_RETHROW()
 
+/**
+ * Prove data segments are restored, and memory past them zeroed, on every run, including when runs of
+ * contracts with other initial memory are interleaved
+ */
+BOOST_FIXTURE_TEST_CASE( memory_image_reset, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts( {N(imager), N(grower), N(asserter)} );
+   produce_block();
+
+   set_code(N(imager), memory_image_reset_wast);
+   set_code(N(grower), memory_growth_memset_store);
+   set_code(N(asserter), contracts::asserter_wasm());
+   produce_block();
+
+   auto run = [&]( account_name account ) {
+      signed_transaction trx;
+      action act;
+      act.account = account;
+      act.name = N();
+      act.authorization = vector<permission_level>{{account,config::active_name}};
+      trx.actions.push_back(act);
+      set_transaction_headers(trx);
+      trx.sign(get_private_key( account, "active" ), control->get_chain_id());
+      push_transaction(trx);
+   };
+
+   for( int i = 0; i < 3; ++i ) {
+      run(N(imager));
+      run(N(imager));
+      run(N(grower));
+      run(N(imager));
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{N(asserter),config::active_name}}, provereset {} );
+      set_transaction_headers(trx);
+      trx.sign( get_private_key( N(asserter), "active" ), control->get_chain_id() );
+      push_transaction( trx );
+      produce_block();
+   }
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Injecting modules on several threads at once gives the same code as injecting them one at a time
+ */
+BOOST_AUTO_TEST_CASE( concurrent_injection ) try {
+   auto inject = []( const vector<uint8_t>& code ) {
+      IR::Module module;
+      Serialization::MemoryInputStream stream( code.data(), code.size() );
+      WASM::serialize( stream, module );
+      wasm_injections::wasm_binary_injection injector( module );
+      injector.inject();
+      Serialization::ArrayOutputStream outstream;
+      WASM::serialize( outstream, module );
+      return outstream.getBytes();
+   };
+
+   const vector<vector<uint8_t>> codes = { contracts::test_api_wasm(), contracts::eosio_token_wasm(),
+                                           contracts::asserter_wasm(), contracts::test_api_multi_index_wasm() };
+   vector<vector<uint8_t>> expected;
+   for( const auto& code : codes )
+      expected.push_back( inject( code ) );
+
+   std::atomic<uint32_t> mismatches{0};
+   vector<std::thread> threads;
+   for( size_t t = 0; t < 8; ++t ) {
+      threads.emplace_back( [&, t]() {
+         for( size_t i = 0; i < 4 * codes.size(); ++i ) {
+            const size_t c = (t + i) % codes.size();
+            if( inject( codes[c] ) != expected[c] )
+               ++mismatches;
+         }
+      } );
+   }
+   for( auto& t : threads ) t.join();
+   BOOST_REQUIRE_EQUAL( mismatches.load(), 0u );
+} FC_LOG_AND_RETHROW()
+
+namespace {
+   // byte at a time references for the memory kernels
+   void scalar_move( char* dest, const char* src, size_t length ) {
+      if( dest <= src ) {
+         for( size_t i = 0; i < length; ++i ) dest[i] = src[i];
+      } else {
+         for( size_t i = length; i > 0; --i ) dest[i - 1] = src[i - 1];
+      }
+   }
+
+   void scalar_set( char* dest, char value, size_t length ) {
+      for( size_t i = 0; i < length; ++i ) dest[i] = value;
+   }
+
+   int scalar_compare( const char* a, const char* b, size_t length ) {
+      for( size_t i = 0; i < length; ++i ) {
+         if( a[i] != b[i] ) return uint8_t(a[i]) < uint8_t(b[i]) ? -1 : 1;
+      }
+      return 0;
+   }
+}
+
+/**
+ * The inline and vector memory kernels agree with byte at a time copies, fills and comparisons around every size
+ * boundary, at every alignment and in both directions of overlap. On a cpu with AVX2 both the AVX2 and the SSE2
+ * kernels are checked.
+ */
+BOOST_AUTO_TEST_CASE( memory_ops_kernels ) try {
+   vector<char> a(640), b, expected;
+   for( size_t i = 0; i < a.size(); ++i )
+      a[i] = char(i * 7 + 3);
+
+   const bool avx2_was_disabled = memory_ops::disable_avx2( false );
+   auto restore = fc::make_scoped_exit( [avx2_was_disabled]() { memory_ops::disable_avx2( avx2_was_disabled ); } );
+
+   for( bool sse2_only : { false, true } ) {
+      memory_ops::disable_avx2( sse2_only );
+      BOOST_TEST_MESSAGE( "memory kernels for long ranges: " << memory_ops::large_kernels() );
+
+      for( size_t length = 0; length <= 260; length += (length < 70 ? 1 : 13) ) {
+         for( size_t src = 0; src < 36; ++src ) {
+            // memcpy into a separate buffer, at every alignment of the destination
+            for( size_t dest = 0; dest < 36; dest += 5 ) {
+               b = expected = vector<char>( a.size() );
+               memory_ops::copy( b.data() + dest, a.data() + src, length );
+               scalar_move( expected.data() + dest, a.data() + src, length );
+               BOOST_REQUIRE( b == expected );
+            }
+
+            // memmove within one buffer, with the destination before, on and after the source
+            for( size_t dest = 0; dest < 72; dest += 3 ) {
+               b = expected = a;
+               memory_ops::move( b.data() + dest, b.data() + src, length );
+               scalar_move( expected.data() + dest, expected.data() + src, length );
+               BOOST_REQUIRE( b == expected );
+            }
+
+            b = expected = a;
+            memory_ops::set( b.data() + src, char(length), length );
+            scalar_set( expected.data() + src, char(length), length );
+            BOOST_REQUIRE( b == expected );
+
+            b = a;
+            BOOST_REQUIRE_EQUAL( memory_ops::compare( a.data() + src, b.data() + src, length ), 0 );
+            if( length == 0 )
+               continue;
+            // a single difference at the first, a middle and the last byte, in the high bit so that a signed
+            // comparison would get it wrong
+            for( size_t at : { size_t(0), length / 2, length - 1 } ) {
+               b = a;
+               b[src + at] ^= 0x80;
+               BOOST_REQUIRE_EQUAL( memory_ops::compare( a.data() + src, b.data() + src, length ),
+                                    scalar_compare( a.data() + src, b.data() + src, length ) );
+               BOOST_REQUIRE_EQUAL( memory_ops::compare( b.data() + src, a.data() + src, length ),
+                                    scalar_compare( b.data() + src, a.data() + src, length ) );
+            }
+         }
+      }
+   }
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Times the memory intrinsics called from a contract through each runtime. The results are logged, not checked, so
+ * it only runs when EOS_TESTING_BENCHMARKS is set
+ */
+BOOST_AUTO_TEST_CASE( memory_intrinsics_benchmark ) try {
+   if( !getenv( "EOS_TESTING_BENCHMARKS" ) ) {
+      BOOST_TEST_MESSAGE( "set EOS_TESTING_BENCHMARKS to run memory_intrinsics_benchmark" );
+      return;
+   }
+   ilog( "memory kernels for long ranges: ${k}", ("k", memory_ops::large_kernels()) );
+   const char* const op_names[] = { "memcpy", "memmove", "memset", "memcmp" };
+   const uint32_t count = 2000;
+
+   for( auto vm : { wasm_interface::vm_type::wavm, wasm_interface::vm_type::wabt } ) {
+      auto cfg = validating_tester::default_config();
+      cfg.wasm_runtime = vm;
+      tester chain( cfg );
+      chain.create_accounts( {N(bench)} );
+      chain.set_code( N(bench), memory_intrinsics_benchmark_wast );
+      chain.produce_block();
+
+      auto run = [&]( uint64_t op, uint32_t size, uint32_t calls ) {
+         const uint32_t data[] = { size, calls };
+         signed_transaction trx;
+         action act;
+         act.account = N(bench);
+         act.name = action_name( op );
+         act.authorization = vector<permission_level>{{N(bench),config::active_name}};
+         act.data.assign( (const char*)data, (const char*)data + sizeof(data) );
+         trx.actions.push_back( act );
+         chain.set_transaction_headers( trx );
+         trx.sign( chain.get_private_key( N(bench), "active" ), chain.control->get_chain_id() );
+         const auto start = fc::time_point::now();
+         chain.push_transaction( trx );
+         return fc::time_point::now() - start;
+      };
+
+      for( uint64_t op = 0; op < 4; ++op ) {
+         for( uint32_t size : { 8, 64, 512, 4096 } ) {
+            // the run without calls measures the transaction itself, and compiles the contract the first time
+            const auto base = run( op, size, 0 );
+            const auto elapsed = run( op, size, count );
+            ilog( "${vm} ${op} of ${size} bytes: ${ns} ns per call",
+                  ("vm", vm == wasm_interface::vm_type::wavm ? "wavm" : "wabt")("op", op_names[op])("size", size)
+                  ("ns", std::max<int64_t>( elapsed.count() - base.count(), 0 ) * 1000 / count) );
+         }
+      }
+      chain.produce_block();
+   }
+} FC_LOG_AND_RETHROW()
+
 INCBIN(fuzz1, "fuzz1.wasm");
 INCBIN(fuzz2, "fuzz2.wasm");
 INCBIN(fuzz3, "fuzz3.wasm");
@@ -1852,4 +2069,96 @@ BOOST_FIXTURE_TEST_CASE(weighted_net_usage_tests, tester ) try {
 } FC_LOG_AND_RETHROW()
 #endif
 
+/**
+ * Prove that wavm caches compiled code on disk, loads it instead of compiling again after a restart,
+ * and compiles again if the cached object is not valid
+ */
+BOOST_AUTO_TEST_CASE( wavm_code_cache ) try {
+   if( validating_tester::default_config().wasm_runtime != wasm_interface::vm_type::wavm )
+      return;
+
+   fc::temp_directory cache_dir;
+   auto cached_objects = [&]() {
+      vector<fc::path> objects;
+      for( fc::directory_iterator itr( cache_dir.path() ); itr != fc::directory_iterator(); ++itr )
+         objects.push_back( *itr );
+      return objects;
+   };
+
+   auto run_asserter = [&]() {
+      auto cfg = validating_tester::default_config();
+      cfg.wasm_code_cache_dir = cache_dir.path();
+      cfg.wasm_code_cache_build_id = "wavm_code_cache";
+      tester chain( cfg );
+      chain.create_accounts( {N(asserter)} );
+      chain.set_code( N(asserter), contracts::asserter_wasm() );
+      chain.produce_block();
+
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{N(asserter),config::active_name}},
+                                assertdef {1, "Should Not Assert!"} );
+      chain.set_transaction_headers( trx );
+      trx.sign( chain.get_private_key( N(asserter), "active" ), chain.control->get_chain_id() );
+      BOOST_CHECK_EQUAL( chain.push_transaction( trx )->receipt->status, transaction_receipt::executed );
+   };
+
+   run_asserter();
+   auto objects = cached_objects();
+   BOOST_REQUIRE_EQUAL( objects.size(), 1u );
+
+   // a cache hit does not write the object again
+   const std::time_t old_time = std::time(nullptr) - 3600;
+   boost::filesystem::last_write_time( objects[0], old_time );
+   run_asserter();
+   BOOST_REQUIRE_EQUAL( cached_objects().size(), 1u );
+   BOOST_REQUIRE_EQUAL( boost::filesystem::last_write_time( objects[0] ), old_time );
+
+   // an invalid object is compiled and written again
+   {
+      std::ofstream corrupt( objects[0].generic_string(), std::ios::binary | std::ios::trunc );
+      corrupt << "garbage";
+   }
+   run_asserter();
+   BOOST_REQUIRE_EQUAL( cached_objects().size(), 1u );
+   BOOST_REQUIRE_GT( fc::file_size( objects[0] ), 7u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( background_compile ) try {
+   auto cfg = validating_tester::default_config();
+   cfg.wasm_background_compile = true;
+   tester producer( cfg );
+   cfg = validating_tester::default_config();
+   cfg.wasm_background_compile = true;
+   tester receiver( cfg );
+
+   producer.create_accounts( {N(asserter)} );
+   producer.set_code( N(asserter), contracts::asserter_wasm() );
+   // the receiver starts compiling the code as soon as it sees the block, the producer when setcode is applied
+   receiver.push_block( producer.produce_block() );
+
+   auto push_assert = [&]( tester& chain, int8_t condition ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{N(asserter),config::active_name}},
+                                assertdef {condition, "background"} );
+      chain.set_transaction_headers( trx );
+      trx.sign( chain.get_private_key( N(asserter), "active" ), chain.control->get_chain_id() );
+      return chain.push_transaction( trx );
+   };
+
+   BOOST_CHECK_EQUAL( push_assert( producer, 1 )->receipt->status, transaction_receipt::executed );
+   BOOST_CHECK_EXCEPTION( push_assert( receiver, 0 ), eosio_assert_message_exception,
+                          eosio_assert_message_is( "background" ) );
+   BOOST_CHECK_EQUAL( push_assert( receiver, 1 )->receipt->status, transaction_receipt::executed );
+
+   // replacing the code once it is irreversible still runs the new code
+   for( int i = 0; i < 3; ++i )
+      receiver.push_block( producer.produce_block() );
+   producer.set_code( N(asserter), contracts::payloadless_wasm() );
+   receiver.push_block( producer.produce_block() );
+   for( int i = 0; i < 3; ++i )
+      receiver.push_block( producer.produce_block() );
+   // payloadless ignores the assert action, so a false condition no longer fails
+   BOOST_CHECK_EQUAL( push_assert( receiver, 0 )->receipt->status, transaction_receipt::executed );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()